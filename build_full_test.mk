@@ -25,7 +25,8 @@ $(TEST)_SRC= \
 	tests/test_common/matrix.c \
 	tests/test_common/test_driver.cpp \
 	tests/test_common/keyboard_report_util.cpp \
-	tests/test_common/test_fixture.cpp
+	tests/test_common/test_fixture.cpp \
+	tests/test_common/scan_benchmark.cpp
 $(TEST)_SRC += $(patsubst $(ROOTDIR)/%,%,$(wildcard $(TEST_PATH)/*.cpp))
 
 $(TEST)_DEFS=$(TMK_COMMON_DEFS) $(OPT_DEFS)
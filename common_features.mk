@@ -109,6 +109,9 @@ ifeq ($(strip $(RGBLIGHT_ENABLE)), yes)
     LED_BREATHING_TABLE = yes
     ifeq ($(strip $(RGBLIGHT_CUSTOM_DRIVER)), yes)
         OPT_DEFS += -DRGBLIGHT_CUSTOM_DRIVER
+    else ifeq ($(strip $(WS2812_DRIVER)), usart)
+        OPT_DEFS += -DWS2812_DRIVER_USART
+        SRC += ws2812_usart.c
     else
 	    SRC += ws2812.c
     endif
@@ -198,6 +201,11 @@ ifeq ($(strip $(USB_HID_ENABLE)), yes)
 endif
 
 
+ifeq ($(strip $(SEND_STRING_ASYNC_ENABLE)), yes)
+    OPT_DEFS += -DSEND_STRING_ASYNC_ENABLE
+    SRC += $(QUANTUM_DIR)/send_string_async.c
+endif
+
 ifeq ($(strip $(HD44780_ENABLE)), yes)
     SRC += drivers/avr/hd44780.c
 	OPT_DEFS += -DHD44780_ENABLE
@@ -217,10 +225,21 @@ ifndef CUSTOM_MATRIX
     endif
 endif
 
+DEBOUNCE_DIR := $(QUANTUM_DIR)/debounce
+DEBOUNCE_TYPE ?= sym_g
+VALID_DEBOUNCE_TYPES := sym_g sym_pr eager_pk custom
+ifeq ($(filter $(strip $(DEBOUNCE_TYPE)),$(VALID_DEBOUNCE_TYPES)),)
+    $(error DEBOUNCE_TYPE="$(DEBOUNCE_TYPE)" is not a valid debounce algorithm)
+endif
+ifneq ($(strip $(DEBOUNCE_TYPE)), custom)
+    QUANTUM_SRC += $(DEBOUNCE_DIR)/$(strip $(DEBOUNCE_TYPE)).c
+endif
+
 ifeq ($(strip $(SPLIT_KEYBOARD)), yes)
     OPT_DEFS += -DSPLIT_KEYBOARD
-    QUANTUM_SRC += $(QUANTUM_DIR)/split_common/split_flags.c \
+    QUANTUM_SRC += $(QUANTUM_DIR)/split_common/split_sync.c \
                 $(QUANTUM_DIR)/split_common/split_util.c \
                 $(QUANTUM_DIR)/split_common/i2c.c \
-                $(QUANTUM_DIR)/split_common/serial.c  
+                $(QUANTUM_DIR)/split_common/serial.c \
+                $(QUANTUM_DIR)/split_common/serial_usart.c
 endif
@@ -3,6 +3,8 @@
  */
 
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
 #include <util/twi.h>
 
 #include "i2c_master.h"
@@ -18,22 +20,186 @@ void i2c_init(void)
   TWBR = (uint8_t)TWBR_val;
 }
 
+typedef struct {
+  uint8_t address;
+  uint8_t reg;
+  uint8_t *data;
+  uint16_t length;
+} i2c_transaction_t;
+
+// The queued writes, the first one is being sent by the interrupt
+static i2c_transaction_t queue[I2C_QUEUE_SIZE];
+static volatile uint8_t queue_head = 0;
+static volatile uint8_t queue_count = 0;
+// The next byte of the first write, the register is byte 0
+static volatile uint16_t queue_pos = 0;
+static volatile i2c_status_t queue_status = I2C_STATUS_SUCCESS;
+// True while the interrupt is sending a queued write
+static volatile bool queue_active = false;
+// True from i2c_start to i2c_stop, the queue then waits after its current write
+static volatile bool bus_claimed = false;
+
+static inline void i2c_async_start(void)
+{
+  queue_active = true;
+  queue_pos = 0;
+  TWCR = (1<<TWINT) | (1<<TWSTA) | (1<<TWEN) | (1<<TWIE);
+}
+
+// Ends the first write with a stop, and starts the next one right after it,
+// unless a blocking transfer is waiting for the bus
+static inline void i2c_async_next(void)
+{
+  queue_head = (queue_head + 1) % I2C_QUEUE_SIZE;
+  queue_count--;
+  if (queue_count && !bus_claimed) {
+    queue_pos = 0;
+    TWCR = (1<<TWINT) | (1<<TWSTO) | (1<<TWSTA) | (1<<TWEN) | (1<<TWIE);
+  } else {
+    queue_active = false;
+    TWCR = (1<<TWINT) | (1<<TWSTO) | (1<<TWEN);
+  }
+}
+
+// Gives the bus back to the queued writes at the end of a blocking transfer
+static void i2c_release(void)
+{
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    bus_claimed = false;
+    if (queue_count && !queue_active) {
+      while (TWCR & (1<<TWSTO));
+      i2c_async_start();
+    }
+  }
+}
+
+// Resets the TWI after a blocking transfer failed, and releases the bus.
+// The caller may still call i2c_stop, which then does nothing.
+static i2c_status_t i2c_abort(i2c_status_t status)
+{
+  TWCR = 0;
+  i2c_release();
+  return status;
+}
+
+ISR(TWI_vect)
+{
+  i2c_transaction_t *t = &queue[queue_head];
+
+  switch (TW_STATUS & 0xF8) {
+    case TW_START:
+    case TW_REP_START:
+      TWDR = t->address | I2C_WRITE;
+      TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWIE);
+      break;
+    case TW_MT_SLA_ACK:
+    case TW_MT_DATA_ACK:
+      if (queue_pos <= t->length) {
+        TWDR = queue_pos == 0 ? t->reg : t->data[queue_pos - 1];
+        queue_pos++;
+        TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWIE);
+      } else {
+        i2c_async_next();
+      }
+      break;
+    default:
+      // not acknowledged, or the bus was lost, drop the write
+      queue_status = I2C_STATUS_ERROR;
+      i2c_async_next();
+      break;
+  }
+}
+
+i2c_status_t i2c_writeReg_async(uint8_t devaddr, uint8_t regaddr, uint8_t* data, uint16_t length)
+{
+  i2c_status_t status = I2C_STATUS_SUCCESS;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (queue_count == I2C_QUEUE_SIZE) {
+      status = I2C_STATUS_BUSY;
+    } else {
+      i2c_transaction_t *t = &queue[(queue_head + queue_count) % I2C_QUEUE_SIZE];
+      t->address = devaddr;
+      t->reg = regaddr;
+      t->data = data;
+      t->length = length;
+      queue_count++;
+      if (!queue_active && !bus_claimed) {
+        // wait for the stop of the previous write
+        while (TWCR & (1<<TWSTO));
+        i2c_async_start();
+      }
+    }
+  }
+  return status;
+}
+
+bool i2c_async_busy(void)
+{
+  return queue_count;
+}
+
+i2c_status_t i2c_async_status(void)
+{
+  i2c_status_t status;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    status = queue_status;
+    queue_status = I2C_STATUS_SUCCESS;
+  }
+  return status;
+}
+
+i2c_status_t i2c_async_wait(uint16_t timeout)
+{
+  uint16_t timeout_timer = timer_read();
+  while (queue_count || (TWCR & (1<<TWSTO))) {
+    if (timeout == I2C_TIMEOUT_IMMEDIATE) {
+      return I2C_STATUS_BUSY;
+    }
+    if ((timeout != I2C_TIMEOUT_INFINITE) && ((timer_read() - timeout_timer) >= timeout)) {
+      ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        TWCR = 0;
+        queue_count = 0;
+        queue_active = false;
+        queue_status = I2C_STATUS_TIMEOUT;
+      }
+      return I2C_STATUS_TIMEOUT;
+    }
+  }
+  return I2C_STATUS_SUCCESS;
+}
+
 i2c_status_t i2c_start(uint8_t address, uint16_t timeout)
 {
+  uint16_t timeout_timer;
+
+  // Unless this is a repeated start, wait for the queued write being sent,
+  // the rest of the queue is sent after i2c_stop
+  if (!bus_claimed) {
+    bus_claimed = true;
+    timeout_timer = timer_read();
+    while (queue_active || (TWCR & (1<<TWSTO))) {
+      if ((timeout != I2C_TIMEOUT_INFINITE) && ((timer_read() - timeout_timer) >= timeout)) {
+        i2c_release();
+        return I2C_STATUS_TIMEOUT;
+      }
+    }
+  }
+
   // reset TWI control register
   TWCR = 0;
   // transmit START condition
   TWCR = (1<<TWINT) | (1<<TWSTA) | (1<<TWEN);
 
-  uint16_t timeout_timer = timer_read();
+  timeout_timer = timer_read();
   while( !(TWCR & (1<<TWINT)) ) {
     if ((timeout != I2C_TIMEOUT_INFINITE) && ((timer_read() - timeout_timer) >= timeout)) {
-      return I2C_STATUS_TIMEOUT;
+      return i2c_abort(I2C_STATUS_TIMEOUT);
     }
   }
 
   // check if the start condition was successfully transmitted
-  if(((TW_STATUS & 0xF8) != TW_START) && ((TW_STATUS & 0xF8) != TW_REP_START)){ return I2C_STATUS_ERROR; }
+  if(((TW_STATUS & 0xF8) != TW_START) && ((TW_STATUS & 0xF8) != TW_REP_START)){ return i2c_abort(I2C_STATUS_ERROR); }
 
   // load slave address into data register
   TWDR = address;
@@ -43,13 +209,13 @@ i2c_status_t i2c_start(uint8_t address, uint16_t timeout)
   timeout_timer = timer_read();
   while( !(TWCR & (1<<TWINT)) ) {
     if ((timeout != I2C_TIMEOUT_INFINITE) && ((timer_read() - timeout_timer) >= timeout)) {
-      return I2C_STATUS_TIMEOUT;
+      return i2c_abort(I2C_STATUS_TIMEOUT);
     }
   }
 
   // check if the device has acknowledged the READ / WRITE mode
   uint8_t twst = TW_STATUS & 0xF8;
-  if ( (twst != TW_MT_SLA_ACK) && (twst != TW_MR_SLA_ACK) ) return I2C_STATUS_ERROR;
+  if ( (twst != TW_MT_SLA_ACK) && (twst != TW_MR_SLA_ACK) ) return i2c_abort(I2C_STATUS_ERROR);
 
   return I2C_STATUS_SUCCESS;
 }
@@ -64,11 +230,11 @@ i2c_status_t i2c_write(uint8_t data, uint16_t timeout)
   uint16_t timeout_timer = timer_read();
   while( !(TWCR & (1<<TWINT)) ) {
     if ((timeout != I2C_TIMEOUT_INFINITE) && ((timer_read() - timeout_timer) >= timeout)) {
-      return I2C_STATUS_TIMEOUT;
+      return i2c_abort(I2C_STATUS_TIMEOUT);
     }
   }
 
-  if( (TW_STATUS & 0xF8) != TW_MT_DATA_ACK ){ return I2C_STATUS_ERROR; }
+  if( (TW_STATUS & 0xF8) != TW_MT_DATA_ACK ){ return i2c_abort(I2C_STATUS_ERROR); }
 
   return I2C_STATUS_SUCCESS;
 }
@@ -82,7 +248,7 @@ int16_t i2c_read_ack(uint16_t timeout)
   uint16_t timeout_timer = timer_read();
   while( !(TWCR & (1<<TWINT)) ) {
     if ((timeout != I2C_TIMEOUT_INFINITE) && ((timer_read() - timeout_timer) >= timeout)) {
-      return I2C_STATUS_TIMEOUT;
+      return i2c_abort(I2C_STATUS_TIMEOUT);
     }
   }
 
@@ -99,7 +265,7 @@ int16_t i2c_read_nack(uint16_t timeout)
   uint16_t timeout_timer = timer_read();
   while( !(TWCR & (1<<TWINT)) ) {
     if ((timeout != I2C_TIMEOUT_INFINITE) && ((timer_read() - timeout_timer) >= timeout)) {
-      return I2C_STATUS_TIMEOUT;
+      return i2c_abort(I2C_STATUS_TIMEOUT);
     }
   }
 
@@ -204,15 +370,20 @@ i2c_status_t i2c_readReg(uint8_t devaddr, uint8_t regaddr, uint8_t* data, uint16
 
 i2c_status_t i2c_stop(uint16_t timeout)
 {
+  // the transfer failed and was already ended, the queued writes may be
+  // using the TWI again
+  if (!bus_claimed) return I2C_STATUS_SUCCESS;
+
   // transmit STOP condition
   TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWSTO);
 
   uint16_t timeout_timer = timer_read();
   while(TWCR & (1<<TWSTO)) {
     if ((timeout != I2C_TIMEOUT_INFINITE) && ((timer_read() - timeout_timer) >= timeout)) {
-      return I2C_STATUS_TIMEOUT;
+      return i2c_abort(I2C_STATUS_TIMEOUT);
     }
   }
 
+  i2c_release();
   return I2C_STATUS_SUCCESS;
 }
\ No newline at end of file
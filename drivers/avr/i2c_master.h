@@ -8,11 +8,15 @@
 #define I2C_READ 0x01
 #define I2C_WRITE 0x00
 
+#include <stdint.h>
+#include <stdbool.h>
+
 typedef int16_t i2c_status_t;
 
 #define I2C_STATUS_SUCCESS (0)
 #define I2C_STATUS_ERROR   (-1)
 #define I2C_STATUS_TIMEOUT (-2)
+#define I2C_STATUS_BUSY    (-3)
 
 #define I2C_TIMEOUT_IMMEDIATE (0)
 #define I2C_TIMEOUT_INFINITE (0xFFFF)
@@ -28,4 +32,27 @@ i2c_status_t i2c_writeReg(uint8_t devaddr, uint8_t regaddr, uint8_t* data, uint1
 i2c_status_t i2c_readReg(uint8_t devaddr, uint8_t regaddr, uint8_t* data, uint16_t length, uint16_t timeout);
 i2c_status_t i2c_stop(uint16_t timeout);
 
+// Asynchronous register writes. They are queued, and sent from the TWI
+// interrupt while the matrix scanning goes on, so the data must stay valid
+// until i2c_async_busy() returns false. A blocking transfer only waits for
+// the queued write being sent, the rest of the queue goes on after its
+// i2c_stop, or after it fails. A failed transfer is ended by the function
+// that returned the error, calling i2c_stop after it is harmless, it does
+// nothing until the next i2c_start.
+#ifndef I2C_QUEUE_SIZE
+#define I2C_QUEUE_SIZE 8
+#endif
+
+// Returns I2C_STATUS_BUSY when the queue is full
+i2c_status_t i2c_writeReg_async(uint8_t devaddr, uint8_t regaddr, uint8_t* data, uint16_t length);
+// Returns true while queued writes are being sent
+bool i2c_async_busy(void);
+// Returns the error of the last queued write that failed since the last call,
+// or I2C_STATUS_SUCCESS, and clears it
+i2c_status_t i2c_async_status(void);
+// Waits until the queue is sent, and drops it on timeout. With
+// I2C_TIMEOUT_IMMEDIATE, returns I2C_STATUS_BUSY instead and keeps the queue.
+// Not to be called during a blocking transfer, the queue waits for it.
+i2c_status_t i2c_async_wait(uint16_t timeout);
+
 #endif // I2C_MASTER_H
\ No newline at end of file
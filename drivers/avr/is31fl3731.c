@@ -68,8 +68,17 @@ uint8_t g_twi_transfer_buffer[20];
 uint8_t g_pwm_buffer[DRIVER_COUNT][144];
 bool g_pwm_buffer_update_required = false;
 
+// The PWM buffers are sent in chunks of 16 bytes, bit n is set when the
+// bytes from n * 16 changed since they were last sent
+#define ISSI_PWM_CHUNK_SIZE 16
+#define ISSI_PWM_CHUNK_COUNT (144 / ISSI_PWM_CHUNK_SIZE)
+static uint16_t g_pwm_buffer_dirty[DRIVER_COUNT];
+// The chunks queued by the last update
+static uint16_t g_pwm_buffer_sending[DRIVER_COUNT];
+
 uint8_t g_led_control_registers[DRIVER_COUNT][18] = { { 0 }, { 0 } };
 bool g_led_control_registers_update_required = false;
+static bool g_led_control_registers_dirty[DRIVER_COUNT];
 
 // This is the bit pattern in the LED control registers
 // (for matrix A, add one to register for matrix B)
@@ -101,6 +110,49 @@ void IS31FL3731_write_register( uint8_t addr, uint8_t reg, uint8_t data )
   #endif
 }
 
+// Writes consecutive registers in one transfer, the device auto-increments
+// the register after each byte
+static bool IS31FL3731_write_burst( uint8_t addr, uint8_t reg, uint8_t *data, uint8_t length )
+{
+  #if ISSI_PERSISTENCE > 0
+    for (uint8_t i = 0; i < ISSI_PERSISTENCE; i++) {
+      if (i2c_writeReg(addr << 1, reg, data, length, ISSI_TIMEOUT) == 0)
+        return true;
+    }
+    return false;
+  #else
+    return i2c_writeReg(addr << 1, reg, data, length, ISSI_TIMEOUT) == 0;
+  #endif
+}
+
+// Queues the dirty chunks of a PWM buffer, neighbouring chunks in one
+// transfer. They are sent while the keyboard keeps scanning, and the chunks
+// that fail are marked dirty again by the next update.
+static void IS31FL3731_write_pwm_buffer_dirty( uint8_t addr, uint8_t driver )
+{
+	uint16_t dirty = g_pwm_buffer_dirty[driver];
+	uint8_t chunk = 0;
+
+	while ( chunk < ISSI_PWM_CHUNK_COUNT ) {
+		if ( !(dirty & (1 << chunk)) ) {
+			chunk++;
+			continue;
+		}
+		uint8_t first = chunk;
+		uint16_t span = 0;
+		while ( chunk < ISSI_PWM_CHUNK_COUNT && (dirty & (1 << chunk)) ) {
+			span |= 1 << chunk;
+			chunk++;
+		}
+		uint8_t offset = first * ISSI_PWM_CHUNK_SIZE;
+		if ( i2c_writeReg_async( addr << 1, 0x24 + offset, &g_pwm_buffer[driver][offset], (chunk - first) * ISSI_PWM_CHUNK_SIZE ) == 0 ) {
+			// Changes from now on mark the chunks dirty again
+			g_pwm_buffer_dirty[driver] &= ~span;
+			g_pwm_buffer_sending[driver] |= span;
+		}
+	}
+}
+
 void IS31FL3731_write_pwm_buffer( uint8_t addr, uint8_t *pwm_buffer )
 {
 	// assumes bank is already selected
@@ -186,16 +238,25 @@ void IS31FL3731_init( uint8_t addr )
 
 }
 
+// Only a change marks the chunk of the register dirty
+static inline void IS31FL3731_set_pwm( uint8_t driver, uint8_t index, uint8_t value )
+{
+	if ( g_pwm_buffer[driver][index] != value ) {
+		g_pwm_buffer[driver][index] = value;
+		g_pwm_buffer_dirty[driver] |= 1 << (index / ISSI_PWM_CHUNK_SIZE);
+		g_pwm_buffer_update_required = true;
+	}
+}
+
 void IS31FL3731_set_color( int index, uint8_t red, uint8_t green, uint8_t blue )
 {
 	if ( index >= 0 && index < DRIVER_LED_TOTAL ) {
 		is31_led led = g_is31_leds[index];
 
 		// Subtract 0x24 to get the second index of g_pwm_buffer
-		g_pwm_buffer[led.driver][led.r - 0x24] = red;
-		g_pwm_buffer[led.driver][led.g - 0x24] = green;
-		g_pwm_buffer[led.driver][led.b - 0x24] = blue;
-		g_pwm_buffer_update_required = true;
+		IS31FL3731_set_pwm( led.driver, led.r - 0x24, red );
+		IS31FL3731_set_pwm( led.driver, led.g - 0x24, green );
+		IS31FL3731_set_pwm( led.driver, led.b - 0x24, blue );
 	}
 }
 
@@ -234,29 +295,46 @@ void IS31FL3731_set_led_control_register( uint8_t index, bool red, bool green, b
 		g_led_control_registers[led.driver][control_register_b] &= ~(1 << bit_b);
 	}
 
+	g_led_control_registers_dirty[led.driver] = true;
 	g_led_control_registers_update_required = true;
 
 }
 
 void IS31FL3731_update_pwm_buffers( uint8_t addr1, uint8_t addr2 )
 {
+	// The previous update is still being sent, the chunks stay dirty
+	if ( i2c_async_busy() ) {
+		return;
+	}
+	if ( i2c_async_status() != 0 ) {
+		g_pwm_buffer_dirty[0] |= g_pwm_buffer_sending[0];
+		g_pwm_buffer_dirty[1] |= g_pwm_buffer_sending[1];
+		g_pwm_buffer_update_required = true;
+	}
+	g_pwm_buffer_sending[0] = 0;
+	g_pwm_buffer_sending[1] = 0;
+
 	if ( g_pwm_buffer_update_required )
 	{
-		IS31FL3731_write_pwm_buffer( addr1, g_pwm_buffer[0] );
-		IS31FL3731_write_pwm_buffer( addr2, g_pwm_buffer[1] );
+		IS31FL3731_write_pwm_buffer_dirty( addr1, 0 );
+		IS31FL3731_write_pwm_buffer_dirty( addr2, 1 );
+		g_pwm_buffer_update_required = g_pwm_buffer_dirty[0] || g_pwm_buffer_dirty[1];
 	}
-	g_pwm_buffer_update_required = false;
 }
 
 void IS31FL3731_update_led_control_registers( uint8_t addr1, uint8_t addr2 )
 {
 	if ( g_led_control_registers_update_required )
 	{
-		for ( int i=0; i<18; i++ )
-		{
-			IS31FL3731_write_register(addr1, i, g_led_control_registers[0][i] );
-			IS31FL3731_write_register(addr2, i, g_led_control_registers[1][i] );
+		// All 18 registers in one transfer
+		if ( g_led_control_registers_dirty[0] &&
+				IS31FL3731_write_burst( addr1, 0x00, g_led_control_registers[0], 18 ) ) {
+			g_led_control_registers_dirty[0] = false;
+		}
+		if ( g_led_control_registers_dirty[1] &&
+				IS31FL3731_write_burst( addr2, 0x00, g_led_control_registers[1], 18 ) ) {
+			g_led_control_registers_dirty[1] = false;
 		}
+		g_led_control_registers_update_required = g_led_control_registers_dirty[0] || g_led_control_registers_dirty[1];
 	}
 }
-
@@ -44,6 +44,7 @@ void IS31FL3731_set_led_control_register( uint8_t index, bool red, bool green, b
 // (eg. from a timer interrupt).
 // Call this while idle (in between matrix scans).
 // If the buffer is dirty, it will update the driver with the buffer.
+// The changed parts are queued, and sent while the keyboard keeps scanning.
 void IS31FL3731_update_pwm_buffers( uint8_t addr1, uint8_t addr2 );
 void IS31FL3731_update_led_control_registers( uint8_t addr1, uint8_t addr2 );
 
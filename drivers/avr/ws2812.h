@@ -23,6 +23,7 @@
 #ifndef LIGHT_WS2812_H_
 #define LIGHT_WS2812_H_
 
+#include <stdbool.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
 //#include "ws2812_config.h"
@@ -58,6 +59,15 @@ void ws2812_setleds_rgbw(LED_TYPE *ledarray, uint16_t number_of_leds);
 void ws2812_sendarray     (uint8_t *array,uint16_t length);
 void ws2812_sendarray_mask(uint8_t *array,uint16_t length, uint8_t pinmask);
 
+#ifdef WS2812_DRIVER_USART
+/*
+ * The USART driver returns before the data is sent, it's sent from an
+ * interrupt. Returns true until the last bit has left the USART, the strip
+ * still needs 50 us of low after that to latch the colors.
+ */
+bool ws2812_busy(void);
+#endif
+
 
 /*
  * Internal defines
@@ -0,0 +1,149 @@
+/*
+* WS2812 driver using the USART in SPI master mode
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  The LED data is encoded in a buffer, and the USART shifts it out from its
+  data register empty interrupt, so the keyboard keeps running, and USB keeps
+  being served, while the strip is updated. Only works on the TXD1 pin (D3
+  on the ATmega32U4).
+
+  Each bit of the LEDs takes three bits of the USART at 2.67 MHz, 375 ns
+  each: 100 for a zero and 110 for a one.
+*/
+
+#include "ws2812.h"
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <util/delay.h>
+
+#if F_CPU != 16000000
+  #error "The USART WS2812 driver needs a 16 MHz clock"
+#endif
+
+// 16 MHz / (2 * (2 + 1)) = 2.67 MHz
+#define WS2812_USART_UBRR 2
+
+#ifndef WS2812_USART_MAX_LEDS
+  #define WS2812_USART_MAX_LEDS RGBLED_NUM
+#endif
+
+#ifdef RGBW
+  #define WS2812_BYTES_PER_LED 4
+#else
+  #define WS2812_BYTES_PER_LED 3
+#endif
+
+// Three bytes of encoded data for each byte of LED data
+static uint8_t buffer[WS2812_USART_MAX_LEDS * WS2812_BYTES_PER_LED * 3];
+static volatile uint16_t buffer_pos = 0;
+static volatile uint16_t buffer_length = 0;
+static bool initialized = false;
+// A transfer was started and its latch wasn't waited for yet
+static bool sent = false;
+
+static void ws2812_usart_init(void)
+{
+  DDRD |= _BV(PD3) | _BV(PD5);  // TXD1 and XCK1
+  PORTD &= ~_BV(PD3);
+  UBRR1 = 0;
+  // SPI master mode, MSB first, data sampled on the rising edge
+  UCSR1C = _BV(UMSEL11) | _BV(UMSEL10);
+  UCSR1B = _BV(TXEN1);
+  UBRR1 = WS2812_USART_UBRR;
+  initialized = true;
+}
+
+// Spreads the 8 bits of a byte over 24, three for each
+static void encode_byte(uint8_t *out, uint8_t value)
+{
+  uint32_t bits = 0;
+  for (uint8_t i = 0; i < 8; i++) {
+    bits = (bits << 3) | ((value & 0x80) ? 0x6 : 0x4);
+    value <<= 1;
+  }
+  out[0] = bits >> 16;
+  out[1] = bits >> 8;
+  out[2] = bits;
+}
+
+ISR(USART1_UDRE_vect)
+{
+  UDR1 = buffer[buffer_pos++];
+  if (buffer_pos == buffer_length) {
+    UCSR1B &= ~_BV(UDRIE1);
+    buffer_length = 0;
+  }
+}
+
+// The interrupt is done when the last byte is in the data register, the
+// transfer when TXC1 is set after that byte is shifted out
+bool ws2812_busy(void)
+{
+  return sent && !(UCSR1A & _BV(TXC1));
+}
+
+void ws2812_sendarray_mask(uint8_t *data, uint16_t datlen, uint8_t maskhi)
+{
+  if (!initialized) {
+    ws2812_usart_init();
+  }
+  // The previous transfer may still be sent, and the strip needs a low
+  // pulse of 50 us after it to latch the colors. When it ended is unknown,
+  // so the whole 50 us are waited every time.
+  if (sent) {
+    while (ws2812_busy());
+    _delay_us(50);
+    sent = false;
+  }
+
+  if (datlen > sizeof(buffer) / 3) {
+    datlen = sizeof(buffer) / 3;
+  }
+  if (!datlen) {
+    return;
+  }
+  for (uint16_t i = 0; i < datlen; i++) {
+    encode_byte(&buffer[i * 3], data[i]);
+  }
+
+  buffer_pos = 0;
+  buffer_length = datlen * 3;
+  UCSR1A |= _BV(TXC1);  // cleared by writing a one
+  sent = true;
+  UCSR1B |= _BV(UDRIE1);
+}
+
+void ws2812_sendarray(uint8_t *data, uint16_t datlen)
+{
+  ws2812_sendarray_mask(data, datlen, 0);
+}
+
+void ws2812_setleds(LED_TYPE *ledarray, uint16_t leds)
+{
+  ws2812_sendarray((uint8_t*)ledarray, leds * sizeof(LED_TYPE));
+}
+
+// The USART has a single pin, the pin mask is ignored
+void ws2812_setleds_pin(LED_TYPE *ledarray, uint16_t leds, uint8_t pinmask)
+{
+  ws2812_setleds(ledarray, leds);
+}
+
+void ws2812_setleds_rgbw(LED_TYPE *ledarray, uint16_t leds)
+{
+  ws2812_setleds(ledarray, leds);
+}
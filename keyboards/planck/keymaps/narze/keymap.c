@@ -83,7 +83,7 @@ combo_t key_combos[COMBO_COUNT] = {
 
 volatile bool superduper_enabled = true;
 
-const uint16_t empty_combo[] = {COMBO_END};
+const uint16_t PROGMEM empty_combo[] = {COMBO_END};
 
 void set_superduper_key_combos(void);
 void clear_superduper_key_combos(void);
@@ -274,7 +274,7 @@ bool process_record_user(uint16_t keycode, keyrecord_t *record) {
         #endif
         persistant_default_layer_set(1UL<<_QWERTY);
 
-        key_combos[CB_SUPERDUPER].keys = superduper_combos[_QWERTY];
+        combo_set_keys(CB_SUPERDUPER, superduper_combos[_QWERTY]);
         eeprom_update_byte(EECONFIG_SUPERDUPER_INDEX, _QWERTY);
       }
       return false;
@@ -286,7 +286,7 @@ bool process_record_user(uint16_t keycode, keyrecord_t *record) {
         #endif
         persistant_default_layer_set(1UL<<_COLEMAK);
 
-        key_combos[CB_SUPERDUPER].keys = superduper_combos[_COLEMAK];
+        combo_set_keys(CB_SUPERDUPER, superduper_combos[_COLEMAK]);
         eeprom_update_byte(EECONFIG_SUPERDUPER_INDEX, _COLEMAK);
       }
       return false;
@@ -298,7 +298,7 @@ bool process_record_user(uint16_t keycode, keyrecord_t *record) {
         #endif
         persistant_default_layer_set(1UL<<_QWOC);
 
-        key_combos[CB_SUPERDUPER].keys = superduper_combos[_QWOC];
+        combo_set_keys(CB_SUPERDUPER, superduper_combos[_QWOC]);
         eeprom_update_byte(EECONFIG_SUPERDUPER_INDEX, _QWOC);
       }
       return false;
@@ -403,13 +403,13 @@ void set_superduper_key_combos(void) {
     case _QWERTY:
     case _COLEMAK:
     case _QWOC:
-      key_combos[CB_SUPERDUPER].keys = superduper_combos[layer];
+      combo_set_keys(CB_SUPERDUPER, superduper_combos[layer]);
       break;
   }
 }
 
 void clear_superduper_key_combos(void) {
-  key_combos[CB_SUPERDUPER].keys = empty_combo;
+  combo_set_keys(CB_SUPERDUPER, empty_combo);
 }
 
 void matrix_scan_user(void) {
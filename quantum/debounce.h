@@ -0,0 +1,52 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "matrix.h"
+
+/* Debouncing of the switch matrix
+ *
+ * The algorithm is selected with DEBOUNCE_TYPE in rules.mk, see
+ * docs/feature_debounce_type.md. DEBOUNCING_DELAY sets the debounce time in ms.
+ */
+
+#ifndef DEBOUNCING_DELAY
+#   define DEBOUNCING_DELAY 5
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void debounce_init(uint8_t num_rows);
+
+/* Updates the debounced matrix from the raw one.
+ * `changed` tells if any of the raw rows changed during this scan.
+ */
+void debounce(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows, bool changed);
+
+/* Returns true while a change is waiting to be debounced */
+bool debounce_active(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
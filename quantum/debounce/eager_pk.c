@@ -0,0 +1,107 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Eager on press, deferred on release, per key debouncing.
+ *
+ * A press is reported as soon as it's seen, after which the key ignores any
+ * bouncing for DEBOUNCING_DELAY ms. A release is only reported once the key
+ * has stayed released for DEBOUNCING_DELAY ms, so bouncing while the key is
+ * held down can't cause an extra release and press. Each key has its own
+ * counter, so a chattering switch doesn't delay any other key.
+ */
+
+#include "debounce.h"
+#include "timer.h"
+
+#if (DEBOUNCING_DELAY > 127)
+#   error "DEBOUNCING_DELAY has to be 127 or less for the eager_pk debounce type"
+#endif
+
+/* The counters hold the ms left for each key, 0 when the key is not
+ * debouncing. The top bit tells that a release is waiting to be reported.
+ */
+#define COUNTER_RELEASE 0x80
+#define COUNTER_TIME 0x7F
+
+static uint8_t counters[MATRIX_ROWS * MATRIX_COLS];
+static uint16_t last_time;
+static bool counters_active = false;
+
+void debounce_init(uint8_t num_rows)
+{
+    for (uint16_t i = 0; i < num_rows * MATRIX_COLS; i++) {
+        counters[i] = 0;
+    }
+    counters_active = false;
+    last_time = timer_read();
+}
+
+void debounce(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows, bool changed)
+{
+    uint16_t now = timer_read();
+    uint16_t elapsed = TIMER_DIFF_16(now, last_time);
+    last_time = now;
+
+    if (!changed && !counters_active) {
+        return;
+    }
+
+    counters_active = false;
+    uint8_t *counter = counters;
+    for (uint8_t row = 0; row < num_rows; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++, counter++) {
+            matrix_row_t mask = (matrix_row_t)1 << col;
+            if (*counter) {
+                if ((*counter & COUNTER_RELEASE) && !((raw[row] ^ cooked[row]) & mask)) {
+                    // Pressed again before the release was reported
+                    *counter = 0;
+                } else if ((*counter & COUNTER_TIME) <= elapsed) {
+                    if (*counter & COUNTER_RELEASE) {
+                        cooked[row] &= ~mask;
+                    }
+                    *counter = 0;
+                } else {
+                    *counter -= elapsed;
+                    counters_active = true;
+                    continue;
+                }
+            }
+            if ((raw[row] ^ cooked[row]) & mask) {
+                if (raw[row] & mask) {
+                    cooked[row] |= mask;
+#if (DEBOUNCING_DELAY > 0)
+                    *counter = DEBOUNCING_DELAY;
+                    counters_active = true;
+#endif
+                } else {
+#if (DEBOUNCING_DELAY > 0)
+                    *counter = DEBOUNCING_DELAY | COUNTER_RELEASE;
+                    counters_active = true;
+#else
+                    cooked[row] &= ~mask;
+#endif
+                }
+            }
+        }
+    }
+}
+
+bool debounce_active(void)
+{
+    return counters_active;
+}
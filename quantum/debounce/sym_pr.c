@@ -0,0 +1,84 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Symmetric, per row debouncing.
+ *
+ * Each row has its own timer, which is restarted whenever the row changes, and
+ * the row is updated once it has been stable for DEBOUNCING_DELAY ms. A
+ * chattering switch only delays the other keys on the same row.
+ */
+
+#include "debounce.h"
+#include "timer.h"
+
+#if (DEBOUNCING_DELAY > 255)
+#   error "DEBOUNCING_DELAY has to be 255 or less for the sym_pr debounce type"
+#endif
+
+static matrix_row_t last_raw[MATRIX_ROWS];
+/* ms left until each row is stable, 0 when the row is not debouncing */
+static uint8_t counters[MATRIX_ROWS];
+static uint16_t last_time;
+static bool counters_active = false;
+
+void debounce_init(uint8_t num_rows)
+{
+    for (uint8_t i = 0; i < num_rows; i++) {
+        last_raw[i] = 0;
+        counters[i] = 0;
+    }
+    counters_active = false;
+    last_time = timer_read();
+}
+
+void debounce(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows, bool changed)
+{
+    uint16_t now = timer_read();
+    uint16_t elapsed = TIMER_DIFF_16(now, last_time);
+    last_time = now;
+
+    if (!changed && !counters_active) {
+        return;
+    }
+
+    counters_active = false;
+    for (uint8_t i = 0; i < num_rows; i++) {
+        if (raw[i] != last_raw[i]) {
+            last_raw[i] = raw[i];
+#if (DEBOUNCING_DELAY > 0)
+            counters[i] = DEBOUNCING_DELAY;
+            counters_active = true;
+#else
+            cooked[i] = raw[i];
+#endif
+        } else if (counters[i]) {
+            if (counters[i] <= elapsed) {
+                counters[i] = 0;
+                cooked[i] = raw[i];
+            } else {
+                counters[i] -= elapsed;
+                counters_active = true;
+            }
+        }
+    }
+}
+
+bool debounce_active(void)
+{
+    return counters_active;
+}
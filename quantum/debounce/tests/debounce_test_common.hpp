@@ -0,0 +1,81 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "gtest/gtest.h"
+#include <string.h>
+
+extern "C" {
+#include "debounce.h"
+void set_time(uint32_t t);
+void advance_time(uint32_t ms);
+}
+
+// Emulates a raw matrix that is scanned once per ms
+class Debounce : public ::testing::Test {
+public:
+    Debounce() {
+        set_time(1000);
+        memset(raw, 0, sizeof(raw));
+        memset(last_raw, 0, sizeof(last_raw));
+        memset(cooked, 0, sizeof(cooked));
+        debounce_init(MATRIX_ROWS);
+    }
+
+    void press(uint8_t col, uint8_t row) {
+        raw[row] |= (matrix_row_t)1 << col;
+    }
+
+    void release(uint8_t col, uint8_t row) {
+        raw[row] &= ~((matrix_row_t)1 << col);
+    }
+
+    bool is_on(uint8_t col, uint8_t row) {
+        return cooked[row] & ((matrix_row_t)1 << col);
+    }
+
+    void scan() {
+        bool changed = memcmp(raw, last_raw, sizeof(raw)) != 0;
+        memcpy(last_raw, raw, sizeof(raw));
+        debounce(raw, cooked, MATRIX_ROWS, changed);
+        advance_time(1);
+    }
+
+    void scan_for(unsigned ms) {
+        for (unsigned i = 0; i < ms; i++) {
+            scan();
+        }
+    }
+
+    // Scans until the debounced state of the key matches `pressed`, and
+    // returns the number of ms that took, or -1 if it didn't happen in 100 ms.
+    // A change seen in the first scan has a latency of 0.
+    int latency(uint8_t col, uint8_t row, bool pressed) {
+        for (int ms = 0; ms < 100; ms++) {
+            scan();
+            if (is_on(col, row) == pressed) {
+                return ms;
+            }
+        }
+        return -1;
+    }
+
+    matrix_row_t raw[MATRIX_ROWS];
+    matrix_row_t last_raw[MATRIX_ROWS];
+    matrix_row_t cooked[MATRIX_ROWS];
+};
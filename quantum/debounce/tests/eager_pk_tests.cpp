@@ -0,0 +1,91 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "debounce_test_common.hpp"
+
+TEST_F(Debounce, PressIsImmediateAndReleaseIsDelayed) {
+    press(0, 0);
+    EXPECT_EQ(latency(0, 0, true), 0);
+    scan_for(DEBOUNCING_DELAY);
+    release(0, 0);
+    EXPECT_EQ(latency(0, 0, false), DEBOUNCING_DELAY);
+}
+
+TEST_F(Debounce, IsActiveWhileAnyKeyIsDebouncing) {
+    EXPECT_FALSE(debounce_active());
+    press(0, 0);
+    scan();
+    EXPECT_TRUE(debounce_active());
+    scan_for(DEBOUNCING_DELAY);
+    EXPECT_FALSE(debounce_active());
+}
+
+TEST_F(Debounce, BouncingAfterAPressIsIgnored) {
+    press(0, 0);
+    scan();
+    EXPECT_TRUE(is_on(0, 0));
+    for (int i = 0; i < DEBOUNCING_DELAY - 1; i++) {
+        if (i % 2) {
+            press(0, 0);
+        } else {
+            release(0, 0);
+        }
+        scan();
+        EXPECT_TRUE(is_on(0, 0));
+    }
+    press(0, 0);
+    scan_for(DEBOUNCING_DELAY * 2);
+    EXPECT_TRUE(is_on(0, 0));
+}
+
+TEST_F(Debounce, ReleaseOfAKeyReleasedDuringTheLockoutIsReported) {
+    press(0, 0);
+    scan();
+    release(0, 0);
+    scan();
+    EXPECT_TRUE(is_on(0, 0));
+    EXPECT_NE(latency(0, 0, false), -1);
+}
+
+TEST_F(Debounce, BouncingBeforeTheReleaseIsReportedCancelsIt) {
+    press(0, 0);
+    scan_for(DEBOUNCING_DELAY + 1);
+    release(0, 0);
+    scan_for(2);
+    press(0, 0);
+    scan();
+    release(0, 0);
+    scan();
+    EXPECT_TRUE(is_on(0, 0));
+    EXPECT_EQ(latency(0, 0, false), DEBOUNCING_DELAY - 1);
+}
+
+TEST_F(Debounce, ChatteringKeyDoesNotDelayOtherKeys) {
+    for (int i = 0; i < 10; i++) {
+        if (i % 2) {
+            press(0, 0);
+        } else {
+            release(0, 0);
+        }
+        scan();
+    }
+    press(1, 0);
+    press(3, 2);
+    scan();
+    EXPECT_TRUE(is_on(1, 0));
+    EXPECT_TRUE(is_on(3, 2));
+}
@@ -0,0 +1,35 @@
+# Copyright 2018 QMK Contributors
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+DEBOUNCE_PATH := $(QUANTUM_PATH)/debounce
+DEBOUNCE_COMMON_DEFS := -DMATRIX_ROWS=4 -DMATRIX_COLS=10 -DDEBOUNCING_DELAY=5
+
+debounce_sym_g_DEFS := $(DEBOUNCE_COMMON_DEFS)
+debounce_sym_g_SRC := \
+	$(DEBOUNCE_PATH)/tests/sym_g_tests.cpp \
+	$(DEBOUNCE_PATH)/sym_g.c \
+	$(TMK_PATH)/common/test/timer.c
+
+debounce_sym_pr_DEFS := $(DEBOUNCE_COMMON_DEFS)
+debounce_sym_pr_SRC := \
+	$(DEBOUNCE_PATH)/tests/sym_pr_tests.cpp \
+	$(DEBOUNCE_PATH)/sym_pr.c \
+	$(TMK_PATH)/common/test/timer.c
+
+debounce_eager_pk_DEFS := $(DEBOUNCE_COMMON_DEFS)
+debounce_eager_pk_SRC := \
+	$(DEBOUNCE_PATH)/tests/eager_pk_tests.cpp \
+	$(DEBOUNCE_PATH)/eager_pk.c \
+	$(TMK_PATH)/common/test/timer.c
@@ -0,0 +1,69 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "debounce_test_common.hpp"
+
+TEST_F(Debounce, PressAndReleaseAreDelayed) {
+    press(0, 0);
+    EXPECT_EQ(latency(0, 0, true), DEBOUNCING_DELAY);
+    release(0, 0);
+    EXPECT_EQ(latency(0, 0, false), DEBOUNCING_DELAY);
+}
+
+TEST_F(Debounce, IsActiveUntilTheMatrixIsStable) {
+    EXPECT_FALSE(debounce_active());
+    press(0, 0);
+    scan();
+    EXPECT_TRUE(debounce_active());
+    scan_for(DEBOUNCING_DELAY);
+    EXPECT_FALSE(debounce_active());
+    EXPECT_TRUE(is_on(0, 0));
+}
+
+TEST_F(Debounce, BouncingRestartsTheTimer) {
+    press(0, 0);
+    scan_for(2);
+    release(0, 0);
+    scan();
+    press(0, 0);
+    EXPECT_EQ(latency(0, 0, true), DEBOUNCING_DELAY);
+}
+
+TEST_F(Debounce, ChatteringKeyOnlyDelaysItsOwnRow) {
+    press(3, 2);
+    press(4, 0);
+    int latency_other_row = -1;
+    int latency_same_row = -1;
+    for (int ms = 0; ms < 40; ms++) {
+        if (ms % 2 == 0) {
+            if (ms % 4) {
+                press(0, 0);
+            } else {
+                release(0, 0);
+            }
+        }
+        scan();
+        if (latency_other_row < 0 && is_on(3, 2)) {
+            latency_other_row = ms;
+        }
+        if (latency_same_row < 0 && is_on(4, 0)) {
+            latency_same_row = ms;
+        }
+    }
+    EXPECT_EQ(latency_other_row, DEBOUNCING_DELAY);
+    EXPECT_EQ(latency_same_row, -1);
+}
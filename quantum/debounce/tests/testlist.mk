@@ -0,0 +1,4 @@
+TEST_LIST +=\
+	debounce_sym_g\
+	debounce_sym_pr\
+	debounce_eager_pk
@@ -29,10 +29,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "backlight.h"
 #include "quantum.h"
 
-#ifdef SPLIT_KEYBOARD
-    #include "split_flags.h"
-#endif
-
 #ifdef MIDI_ENABLE
 	#include "process_midi.h"
 #endif
@@ -40,6 +36,34 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 extern keymap_config_t keymap_config;
 
 #include <inttypes.h>
+#include <string.h>
+
+/* Number of translated keycodes to remember, has to be a power of two, and 0
+ * disables the cache. Each entry uses 4 bytes of RAM.
+ */
+#ifndef KEYCODE_ACTION_CACHE_SIZE
+#   define KEYCODE_ACTION_CACHE_SIZE 32
+#endif
+#if (KEYCODE_ACTION_CACHE_SIZE & (KEYCODE_ACTION_CACHE_SIZE - 1)) != 0
+#   error "KEYCODE_ACTION_CACHE_SIZE has to be a power of two"
+#endif
+
+#if KEYCODE_ACTION_CACHE_SIZE > 0
+/* Recently translated keycodes
+ *
+ * The translation only depends on the keycode and keymap_config, so the
+ * entries are shared between all layers and keys. The keycode itself is still
+ * read for every lookup, so dynamic keymaps overriding keymap_key_to_keycode
+ * keep working. All entries start out as KC_NO, which translates to ACTION_NO.
+ */
+static struct {
+    uint16_t keycode;
+    action_t action;
+} keycode_action_cache[KEYCODE_ACTION_CACHE_SIZE];
+static uint16_t keycode_action_cache_config = 0;
+#endif
+
+static action_t keycode_to_action(uint16_t keycode);
 
 /* converts key to action */
 action_t action_for_key(uint8_t layer, keypos_t key)
@@ -47,6 +71,27 @@ action_t action_for_key(uint8_t layer, keypos_t key)
     // 16bit keycodes - important
     uint16_t keycode = keymap_key_to_keycode(layer, key);
 
+#if KEYCODE_ACTION_CACHE_SIZE > 0
+    if (keymap_config.raw != keycode_action_cache_config) {
+        memset(keycode_action_cache, 0, sizeof(keycode_action_cache));
+        keycode_action_cache_config = keymap_config.raw;
+    }
+    uint8_t index = (keycode ^ (keycode >> 8)) & (KEYCODE_ACTION_CACHE_SIZE - 1);
+    if (keycode_action_cache[index].keycode == keycode) {
+        return keycode_action_cache[index].action;
+    }
+    action_t action = keycode_to_action(keycode);
+    keycode_action_cache[index].keycode = keycode;
+    keycode_action_cache[index].action = action;
+    return action;
+#else
+    return keycode_to_action(keycode);
+#endif
+}
+
+/* converts keycode to action */
+static action_t keycode_to_action(uint16_t keycode)
+{
     // keycode remapping
     keycode = keycode_config(keycode);
 
@@ -138,39 +183,21 @@ action_t action_for_key(uint8_t layer, keypos_t key)
     #ifdef BACKLIGHT_ENABLE
         case BL_ON:
             action.code = ACTION_BACKLIGHT_ON();
-            #ifdef SPLIT_KEYBOARD
-                BACKLIT_DIRTY = true;
-            #endif
             break;
         case BL_OFF:
             action.code = ACTION_BACKLIGHT_OFF();
-            #ifdef SPLIT_KEYBOARD
-                BACKLIT_DIRTY = true;
-            #endif
             break;
         case BL_DEC:
             action.code = ACTION_BACKLIGHT_DECREASE();
-            #ifdef SPLIT_KEYBOARD
-                BACKLIT_DIRTY = true;
-            #endif
             break;
         case BL_INC:
             action.code = ACTION_BACKLIGHT_INCREASE();
-            #ifdef SPLIT_KEYBOARD
-                BACKLIT_DIRTY = true;
-            #endif
             break;
         case BL_TOGG:
             action.code = ACTION_BACKLIGHT_TOGGLE();
-            #ifdef SPLIT_KEYBOARD
-                BACKLIT_DIRTY = true;
-            #endif
             break;
         case BL_STEP:
             action.code = ACTION_BACKLIGHT_STEP();
-            #ifdef SPLIT_KEYBOARD
-                BACKLIT_DIRTY = true;
-            #endif
             break;
     #endif
     #ifdef SWAP_HANDS_ENABLE
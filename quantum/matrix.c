@@ -18,6 +18,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdbool.h>
 #if defined(__AVR__)
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #endif
 #include "wait.h"
 #include "print.h"
@@ -25,18 +26,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "util.h"
 #include "matrix.h"
 #include "timer.h"
-
-
-/* Set 0 if debouncing isn't needed */
-
-#ifndef DEBOUNCING_DELAY
-#   define DEBOUNCING_DELAY 5
-#endif
-
-#if (DEBOUNCING_DELAY > 0)
-    static uint16_t debouncing_time;
-    static bool debouncing = false;
-#endif
+#include "debounce.h"
 
 #if (MATRIX_COLS <= 8)
 #    define print_matrix_header()  print("\nr/c 01234567\n")
@@ -55,6 +45,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #    define ROW_SHIFTER  ((uint32_t)1)
 #endif
 
+#ifndef MATRIX_IO_DELAY
+#    define MATRIX_IO_DELAY 30
+#endif
+
 #ifdef MATRIX_MASKED
     extern const matrix_row_t matrix_mask[];
 #endif
@@ -62,6 +56,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #if (DIODE_DIRECTION == ROW2COL) || (DIODE_DIRECTION == COL2ROW)
 static const uint8_t row_pins[MATRIX_ROWS] = MATRIX_ROW_PINS;
 static const uint8_t col_pins[MATRIX_COLS] = MATRIX_COL_PINS;
+
+/* A run of pins on the same port, where the port bits follow the matrix
+ * index order, so that the whole run is read with one PINx access and a shift.
+ */
+typedef struct {
+    uint8_t port;  /* PINx I/O address */
+    uint8_t bit;   /* port bit of the first pin */
+    uint8_t mask;  /* one bit per pin in the run, starting at bit 0 */
+    uint8_t index; /* matrix index of the first pin */
+} pin_run_t;
 #endif
 
 /* matrix state(1:on, 0:off) */
@@ -71,12 +75,16 @@ static matrix_row_t matrix_debouncing[MATRIX_ROWS];
 
 
 #if (DIODE_DIRECTION == COL2ROW)
+    static pin_run_t col_runs[MATRIX_COLS];
+    static uint8_t col_run_count;
     static void init_cols(void);
     static bool read_cols_on_row(matrix_row_t current_matrix[], uint8_t current_row);
     static void unselect_rows(void);
     static void select_row(uint8_t row);
     static void unselect_row(uint8_t row);
 #elif (DIODE_DIRECTION == ROW2COL)
+    static pin_run_t row_runs[MATRIX_ROWS];
+    static uint8_t row_run_count;
     static void init_rows(void);
     static bool read_rows_on_col(matrix_row_t current_matrix[], uint8_t current_col);
     static void unselect_cols(void);
@@ -112,6 +120,11 @@ __attribute__ ((weak))
 void matrix_scan_user(void) {
 }
 
+__attribute__ ((weak))
+void matrix_io_delay(void) {
+    wait_us(MATRIX_IO_DELAY);
+}
+
 inline
 uint8_t matrix_rows(void) {
     return MATRIX_ROWS;
@@ -163,56 +176,28 @@ void matrix_init(void) {
         matrix_debouncing[i] = 0;
     }
 
+    debounce_init(MATRIX_ROWS);
+
     matrix_init_quantum();
 }
 
 uint8_t matrix_scan(void)
 {
+    bool changed = false;
 
 #if (DIODE_DIRECTION == COL2ROW)
-
     // Set row, read cols
     for (uint8_t current_row = 0; current_row < MATRIX_ROWS; current_row++) {
-#       if (DEBOUNCING_DELAY > 0)
-            bool matrix_changed = read_cols_on_row(matrix_debouncing, current_row);
-
-            if (matrix_changed) {
-                debouncing = true;
-                debouncing_time = timer_read();
-            }
-
-#       else
-            read_cols_on_row(matrix, current_row);
-#       endif
-
+        changed |= read_cols_on_row(matrix_debouncing, current_row);
     }
-
 #elif (DIODE_DIRECTION == ROW2COL)
-
     // Set col, read rows
     for (uint8_t current_col = 0; current_col < MATRIX_COLS; current_col++) {
-#       if (DEBOUNCING_DELAY > 0)
-            bool matrix_changed = read_rows_on_col(matrix_debouncing, current_col);
-            if (matrix_changed) {
-                debouncing = true;
-                debouncing_time = timer_read();
-            }
-#       else
-             read_rows_on_col(matrix, current_col);
-#       endif
-
+        changed |= read_rows_on_col(matrix_debouncing, current_col);
     }
-
 #endif
 
-#   if (DEBOUNCING_DELAY > 0)
-        if (debouncing && (timer_elapsed(debouncing_time) > DEBOUNCING_DELAY)) {
-            for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-                matrix[i] = matrix_debouncing[i];
-            }
-            debouncing = false;
-        }
-#   endif
+    debounce(matrix_debouncing, matrix, MATRIX_ROWS, changed);
 
     matrix_scan_quantum();
     return 1;
@@ -220,9 +205,7 @@ uint8_t matrix_scan(void)
 
 bool matrix_is_modified(void)
 {
-#if (DEBOUNCING_DELAY > 0)
-    if (debouncing) return false;
-#endif
+    if (debounce_active()) return false;
     return true;
 }
 
@@ -266,6 +249,47 @@ uint8_t matrix_key_count(void)
 
 
 
+#if (DIODE_DIRECTION == COL2ROW) || (DIODE_DIRECTION == ROW2COL)
+
+/* Groups the pins into runs, sorted by port so that each port is only read
+ * once per scan of a row or col. Returns the number of runs.
+ */
+static uint8_t init_pin_runs(pin_run_t runs[], const uint8_t pins[], uint8_t count)
+{
+    uint8_t run_count = 0;
+
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t port = pins[i] >> 4;
+        uint8_t bit = pins[i] & 0xF;
+
+        if (run_count > 0) {
+            pin_run_t *run = &runs[run_count - 1];
+            if (run->port == port && run->bit + bitpop(run->mask) == bit) {
+                run->mask = (run->mask << 1) | 1;
+                continue;
+            }
+        }
+        runs[run_count].port = port;
+        runs[run_count].bit = bit;
+        runs[run_count].mask = 1;
+        runs[run_count].index = i;
+        run_count++;
+    }
+
+    for (uint8_t i = 1; i < run_count; i++) {
+        pin_run_t run = runs[i];
+        uint8_t j = i;
+        for (; j > 0 && runs[j - 1].port > run.port; j--) {
+            runs[j] = runs[j - 1];
+        }
+        runs[j] = run;
+    }
+
+    return run_count;
+}
+
+#endif
+
 #if (DIODE_DIRECTION == COL2ROW)
 
 static void init_cols(void)
@@ -275,6 +299,8 @@ static void init_cols(void)
         _SFR_IO8((pin >> 4) + 1) &= ~_BV(pin & 0xF); // IN
         _SFR_IO8((pin >> 4) + 2) |=  _BV(pin & 0xF); // HI
     }
+
+    col_run_count = init_pin_runs(col_runs, col_pins, MATRIX_COLS);
 }
 
 static bool read_cols_on_row(matrix_row_t current_matrix[], uint8_t current_row)
@@ -287,17 +313,22 @@ static bool read_cols_on_row(matrix_row_t current_matrix[], uint8_t current_row)
 
     // Select row and wait for row selecton to stabilize
     select_row(current_row);
-    wait_us(30);
-
-    // For each col...
-    for(uint8_t col_index = 0; col_index < MATRIX_COLS; col_index++) {
-
-        // Select the col pin to read (active low)
-        uint8_t pin = col_pins[col_index];
-        uint8_t pin_state = (_SFR_IO8(pin >> 4) & _BV(pin & 0xF));
+    matrix_io_delay();
+
+    // For each run of col pins, the ports are sorted so each is read once
+    uint8_t port = 0;
+    uint8_t port_state = 0;
+    for(uint8_t run_index = 0; run_index < col_run_count; run_index++) {
+        const pin_run_t *run = &col_runs[run_index];
+
+        // Read the port (active low)
+        if (run_index == 0 || run->port != port) {
+            port = run->port;
+            port_state = ~_SFR_IO8(port);
+        }
 
-        // Populate the matrix row with the state of the col pin
-        current_matrix[current_row] |=  pin_state ? 0 : (ROW_SHIFTER << col_index);
+        // Populate the matrix row with the state of the col pins
+        current_matrix[current_row] |= (matrix_row_t)((port_state >> run->bit) & run->mask) << run->index;
     }
 
     // Unselect row
@@ -338,6 +369,8 @@ static void init_rows(void)
         _SFR_IO8((pin >> 4) + 1) &= ~_BV(pin & 0xF); // IN
         _SFR_IO8((pin >> 4) + 2) |=  _BV(pin & 0xF); // HI
     }
+
+    row_run_count = init_pin_runs(row_runs, row_pins, MATRIX_ROWS);
 }
 
 static bool read_rows_on_col(matrix_row_t current_matrix[], uint8_t current_col)
@@ -346,31 +379,46 @@ static bool read_rows_on_col(matrix_row_t current_matrix[], uint8_t current_col)
 
     // Select col and wait for col selecton to stabilize
     select_col(current_col);
-    wait_us(30);
+    matrix_io_delay();
 
-    // For each row...
-    for(uint8_t row_index = 0; row_index < MATRIX_ROWS; row_index++)
+    // For each run of row pins, the ports are sorted so each is read once
+    uint8_t port = 0;
+    uint8_t port_state = 0;
+    for(uint8_t run_index = 0; run_index < row_run_count; run_index++)
     {
+        const pin_run_t *run = &row_runs[run_index];
 
-        // Store last value of row prior to reading
-        matrix_row_t last_row_value = current_matrix[row_index];
-
-        // Check row pin state
-        if ((_SFR_IO8(row_pins[row_index] >> 4) & _BV(row_pins[row_index] & 0xF)) == 0)
+        // Read the port (active low)
+        if (run_index == 0 || run->port != port)
         {
-            // Pin LO, set col bit
-            current_matrix[row_index] |= (ROW_SHIFTER << current_col);
-        }
-        else
-        {
-            // Pin HI, clear col bit
-            current_matrix[row_index] &= ~(ROW_SHIFTER << current_col);
+            port = run->port;
+            port_state = ~_SFR_IO8(port);
         }
+        uint8_t pins_low = (port_state >> run->bit) & run->mask;
 
-        // Determine if the matrix changed state
-        if ((last_row_value != current_matrix[row_index]) && !(matrix_changed))
+        // For each row in the run...
+        uint8_t row_index = run->index;
+        for(uint8_t row_mask = run->mask; row_mask; row_mask >>= 1, pins_low >>= 1, row_index++)
         {
-            matrix_changed = true;
+            // Store last value of row prior to reading
+            matrix_row_t last_row_value = current_matrix[row_index];
+
+            if (pins_low & 1)
+            {
+                // Pin LO, set col bit
+                current_matrix[row_index] |= (ROW_SHIFTER << current_col);
+            }
+            else
+            {
+                // Pin HI, clear col bit
+                current_matrix[row_index] &= ~(ROW_SHIFTER << current_col);
+            }
+
+            // Determine if the matrix changed state
+            if (last_row_value != current_matrix[row_index])
+            {
+                matrix_changed = true;
+            }
         }
     }
 
@@ -404,3 +452,97 @@ static void unselect_cols(void)
 }
 
 #endif
+
+#if defined(IDLE_SLEEP_ENABLE) && ((DIODE_DIRECTION == COL2ROW) || (DIODE_DIRECTION == ROW2COL))
+
+/* The pin change interrupt of port B is only claimed when the keyboard asks
+ * for it, as the keyboard code may use PCINT0_vect itself.
+ * On these MCUs PCINT0-7 are the port B pins.
+ */
+#ifdef IDLE_SLEEP_PCINT_WAKEUP
+#    if defined(__AVR_ATmega32U4__) || defined(__AVR_ATmega16U4__) || \
+        defined(__AVR_AT90USB1286__) || defined(__AVR_AT90USB1287__) || \
+        defined(__AVR_AT90USB646__) || defined(__AVR_AT90USB647__) || \
+        defined(__AVR_ATmega32U2__) || defined(__AVR_ATmega16U2__)
+#        define MATRIX_WAKEUP_PCINT
+#    else
+#        error "IDLE_SLEEP_PCINT_WAKEUP is not supported on this MCU"
+#    endif
+#endif
+
+#if (DIODE_DIRECTION == COL2ROW)
+#    define input_runs      col_runs
+#    define input_run_count col_run_count
+#elif (DIODE_DIRECTION == ROW2COL)
+#    define input_runs      row_runs
+#    define input_run_count row_run_count
+#endif
+
+#ifdef MATRIX_WAKEUP_PCINT
+static uint8_t wakeup_pcint_mask = 0;
+
+/* Only wakes the MCU, the pins are read by matrix_idle_key_pressed */
+EMPTY_INTERRUPT(PCINT0_vect);
+#endif
+
+/* While idle all the rows (cols) are selected, so that pressing any key pulls
+ * its input pin low. With IDLE_SLEEP_PCINT_WAKEUP the inputs on port B also
+ * wake the MCU with a pin change interrupt, the others are read when the
+ * timer interrupt wakes it.
+ */
+void matrix_idle_enter(void)
+{
+#if (DIODE_DIRECTION == COL2ROW)
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        select_row(row);
+    }
+#elif (DIODE_DIRECTION == ROW2COL)
+    for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+        select_col(col);
+    }
+#endif
+    matrix_io_delay();
+
+#ifdef MATRIX_WAKEUP_PCINT
+    wakeup_pcint_mask = 0;
+    for (uint8_t i = 0; i < input_run_count; i++) {
+        if (input_runs[i].port == _SFR_IO_ADDR(PINB)) {
+            wakeup_pcint_mask |= input_runs[i].mask << input_runs[i].bit;
+        }
+    }
+    PCMSK0 |= wakeup_pcint_mask;
+    PCIFR = _BV(PCIF0);
+    if (wakeup_pcint_mask) {
+        PCICR |= _BV(PCIE0);
+    }
+#endif
+}
+
+bool matrix_idle_key_pressed(void)
+{
+    for (uint8_t i = 0; i < input_run_count; i++) {
+        const pin_run_t *run = &input_runs[i];
+        if ((~_SFR_IO8(run->port) >> run->bit) & run->mask) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void matrix_idle_exit(void)
+{
+#ifdef MATRIX_WAKEUP_PCINT
+    PCMSK0 &= ~wakeup_pcint_mask;
+    if (!PCMSK0) {
+        PCICR &= ~_BV(PCIE0);
+    }
+#endif
+
+#if (DIODE_DIRECTION == COL2ROW)
+    unselect_rows();
+#elif (DIODE_DIRECTION == ROW2COL)
+    unselect_cols();
+#endif
+}
+
+#endif
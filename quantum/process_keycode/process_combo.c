@@ -18,7 +18,31 @@
 #include "print.h"
 
 
-#define COMBO_TIMER_ELAPSED -1
+#ifndef COMBO_INDEX_SIZE
+#define COMBO_INDEX_SIZE (COMBO_COUNT * 3)
+#endif
+
+#ifndef COMBO_BUFFER_LENGTH
+#define COMBO_BUFFER_LENGTH 4
+#endif
+
+#if COMBO_COUNT > 255
+#error "COMBO_COUNT can't be more than 255"
+#endif
+
+#if COMBO_BUFFER_LENGTH < 2
+#error "COMBO_BUFFER_LENGTH has to be at least 2"
+#endif
+
+#define COMBO_NONE 0xFF
+
+#ifdef EXTRA_EXTRA_LONG_COMBOS
+#define COMBO_STATE_BITPOP(state) bitpop32(state)
+#elif EXTRA_LONG_COMBOS
+#define COMBO_STATE_BITPOP(state) bitpop16(state)
+#else
+#define COMBO_STATE_BITPOP(state) bitpop(state)
+#endif
 
 
 __attribute__ ((weak))
@@ -31,10 +55,173 @@ void process_combo_event(uint8_t combo_index, bool pressed) {
 
 }
 
-static uint8_t current_combo_index = 0;
+/* One key of one combo. The keycode itself is read from the combo's key
+ * list, so an entry only takes two bytes of RAM.
+ */
+typedef struct {
+    uint8_t combo;
+    uint8_t key;
+} combo_index_entry_t;
+
+/* The keys of all combos, sorted by keycode, and by combo for the same keycode */
+static combo_index_entry_t combo_index[COMBO_INDEX_SIZE];
+static uint16_t combo_index_count = 0;
+/* The combos from this one on didn't fit in the index, and are searched */
+static uint8_t first_unindexed_combo = 0;
+
+/* The presses that could still be the start of a combo, shared by all
+ * combos. A combo is a candidate while it contains all of them, which is
+ * when it has a bit set in its state for each of them.
+ */
+typedef struct {
+    keyrecord_t record;
+    uint16_t keycode;
+} combo_buffered_key_t;
+
+static combo_buffered_key_t key_buffer[COMBO_BUFFER_LENGTH];
+static uint8_t key_buffer_count = 0;
+static uint16_t key_buffer_timer = 0;
+/* The longest combo all of whose keys are in the buffer */
+static uint8_t longest_combo = COMBO_NONE;
+/* Set while the buffered presses are processed again */
+static bool replaying = false;
+
+static inline combo_t *get_combo(uint8_t combo_index)
+{
+    // Do not treat the (weak) key_combos too strict.
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Warray-bounds"
+    return &key_combos[combo_index];
+    #pragma GCC diagnostic pop
+}
+
+static inline uint16_t combo_index_keycode(const combo_index_entry_t *entry)
+{
+    return pgm_read_word(&get_combo(entry->combo)->keys[entry->key]);
+}
+
+/* Counts the keys of the combos, and sorts them into the index */
+static void combo_build_index(void)
+{
+    combo_index_count = 0;
+    first_unindexed_combo = COMBO_COUNT;
+
+    for (uint8_t i = 0; i < COMBO_COUNT; ++i) {
+        combo_t *combo = get_combo(i);
+        uint8_t count = 0;
+        while (COMBO_END != pgm_read_word(&combo->keys[count])) {
+            ++count;
+        }
+        combo->count = count;
+
+        if (first_unindexed_combo < COMBO_COUNT ||
+            combo_index_count + count > COMBO_INDEX_SIZE) {
+            if (first_unindexed_combo == COMBO_COUNT) {
+                first_unindexed_combo = i;
+                dprintf("combo: index full, combos from %u on are searched\n", i);
+            }
+            continue;
+        }
+
+        for (uint8_t key = 0; key < count; ++key) {
+            uint16_t keycode = pgm_read_word(&combo->keys[key]);
+            uint16_t pos = combo_index_count;
+            while (pos > 0 && combo_index_keycode(&combo_index[pos - 1]) > keycode) {
+                combo_index[pos] = combo_index[pos - 1];
+                --pos;
+            }
+            if (pos > 0 && combo_index[pos - 1].combo == i &&
+                combo_index_keycode(&combo_index[pos - 1]) == keycode) {
+                /* The same keycode twice in a combo, the last one is used */
+                combo_index[pos - 1].key = key;
+                for (; pos < combo_index_count; ++pos) {
+                    combo_index[pos] = combo_index[pos + 1];
+                }
+                continue;
+            }
+            combo_index[pos].combo = i;
+            combo_index[pos].key = key;
+            ++combo_index_count;
+        }
+    }
+}
+
+/** \brief Builds the keycode index of the combos
+ *
+ * Called from matrix_init_quantum. To change the keys of a combo later on,
+ * use combo_set_keys.
+ */
+void combo_init(void)
+{
+    key_buffer_count = 0;
+    longest_combo = COMBO_NONE;
+    for (uint8_t i = 0; i < COMBO_COUNT; ++i) {
+        get_combo(i)->state = 0;
+        get_combo(i)->active = false;
+    }
+    combo_build_index();
+}
+
+/* Iterates over the combos that contain a keycode, first the ones in the
+ * index, then the ones that didn't fit
+ */
+typedef struct {
+    uint16_t keycode;
+    uint16_t pos;
+    uint8_t combo;
+    uint8_t key;
+} combo_iter_t;
+
+static void combo_iter_start(combo_iter_t *it, uint16_t keycode)
+{
+    uint16_t low = 0;
+    uint16_t high = combo_index_count;
+    while (low < high) {
+        uint16_t mid = (low + high) / 2;
+        if (combo_index_keycode(&combo_index[mid]) < keycode) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    it->keycode = keycode;
+    it->pos = low;
+}
 
-static inline void send_combo(uint16_t action, bool pressed)
+static bool combo_iter_next(combo_iter_t *it)
 {
+    if (it->pos < combo_index_count) {
+        const combo_index_entry_t *entry = &combo_index[it->pos];
+        if (combo_index_keycode(entry) == it->keycode) {
+            it->combo = entry->combo;
+            it->key = entry->key;
+            ++it->pos;
+            return true;
+        }
+        it->pos = combo_index_count;
+    }
+    for (; it->pos - combo_index_count + first_unindexed_combo < COMBO_COUNT; ++it->pos) {
+        uint8_t combo_index = it->pos - combo_index_count + first_unindexed_combo;
+        const uint16_t *keys = get_combo(combo_index)->keys;
+        int16_t index = -1;
+        for (uint8_t key = 0; ; ++key) {
+            uint16_t combo_key = pgm_read_word(&keys[key]);
+            if (COMBO_END == combo_key) break;
+            if (it->keycode == combo_key) index = key;
+        }
+        if (index >= 0) {
+            it->combo = combo_index;
+            it->key = index;
+            ++it->pos;
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline void send_combo(uint8_t combo_index, bool pressed)
+{
+    uint16_t action = get_combo(combo_index)->keycode;
     if (action) {
         if (pressed) {
             register_code16(action);
@@ -42,113 +229,182 @@ static inline void send_combo(uint16_t action, bool pressed)
             unregister_code16(action);
         }
     } else {
-        process_combo_event(current_combo_index, pressed);
+        process_combo_event(combo_index, pressed);
     }
 }
 
-#define ALL_COMBO_KEYS_ARE_DOWN     (((1<<count)-1) == combo->state)
-#define NO_COMBO_KEYS_ARE_DOWN      (0 == combo->state)
-#define KEY_STATE_DOWN(key)         do{ combo->state |= (1<<key); } while(0)
-#define KEY_STATE_UP(key)           do{ combo->state &= ~(1<<key); } while(0)
-static bool process_single_combo(combo_t *combo, uint16_t keycode, keyrecord_t *record) 
+/* Ends the wait for more combo keys. The longest combo that was completed
+ * is pressed, and the presses that aren't part of it are processed again,
+ * in the order they happened, but this time without looking for combos.
+ */
+static void resolve_key_buffer(void)
 {
-    uint8_t count = 0;
-    uint8_t index = -1;
-    /* Find index of keycode and number of combo keys */
-    for (const uint16_t *keys = combo->keys; ;++count) {
-        uint16_t key = pgm_read_word(&keys[count]);
-        if (keycode == key) index = count;
-        if (COMBO_END == key) break;
+    if (!key_buffer_count) return;
+
+    for (uint8_t i = 0; i < key_buffer_count; ++i) {
+        combo_iter_t it;
+        combo_iter_start(&it, key_buffer[i].keycode);
+        while (combo_iter_next(&it)) {
+            combo_t *combo = get_combo(it.combo);
+            if (!combo->active) {
+                combo->state = 0;
+            }
+        }
     }
 
-    /* Return if not a combo key */
-    if (-1 == (int8_t)index) return false;
+    /* The combo was completed by the first presses of the buffer */
+    uint8_t first_replayed = 0;
+    if (longest_combo != COMBO_NONE) {
+        combo_t *combo = get_combo(longest_combo);
+        combo->state = ((1<<combo->count)-1);
+        combo->active = true;
+        first_replayed = combo->count;
+        send_combo(longest_combo, true);
+    }
 
-    /* The combos timer is used to signal whether the combo is active */
-    bool is_combo_active = COMBO_TIMER_ELAPSED == combo->timer ? false : true;
+    uint8_t count = key_buffer_count;
+    key_buffer_count = 0;
+    longest_combo = COMBO_NONE;
 
-    if (record->event.pressed) {
-        KEY_STATE_DOWN(index);
-
-        if (is_combo_active) {
-            if (ALL_COMBO_KEYS_ARE_DOWN) { /* Combo was pressed */
-                send_combo(combo->keycode, true);
-                combo->timer = COMBO_TIMER_ELAPSED;
-            } else { /* Combo key was pressed */
-                combo->timer = timer_read();
-#ifdef COMBO_ALLOW_ACTION_KEYS
-                combo->prev_record = *record;
-#else
-                combo->prev_key = keycode;
-#endif
-            }
-        }
-    } else {
-        if (ALL_COMBO_KEYS_ARE_DOWN) { /* Combo was released */
-            send_combo(combo->keycode, false);
+    replaying = true;
+    for (uint8_t i = first_replayed; i < count; ++i) {
+        process_record(&key_buffer[i].record);
+    }
+    replaying = false;
+}
+
+/* Adds a press to the buffer, if some combo contains it and all the
+ * presses already there. Returns false if there is no such combo.
+ */
+static bool buffer_combo_key(uint16_t keycode, keyrecord_t *record)
+{
+    uint8_t candidates = 0;
+    bool waiting = false;
+    combo_iter_t it;
+
+    combo_iter_start(&it, keycode);
+    while (combo_iter_next(&it)) {
+        combo_t *combo = get_combo(it.combo);
+        if (!combo->active && COMBO_STATE_BITPOP(combo->state) == key_buffer_count) {
+            ++candidates;
         }
+    }
+    if (!candidates) return false;
 
-        if (is_combo_active) { /* Combo key was tapped */
-#ifdef COMBO_ALLOW_ACTION_KEYS
-            record->event.pressed = true;
-            process_action(record, store_or_get_action(record->event.pressed, record->event.key));
-            record->event.pressed = false;
-            process_action(record, store_or_get_action(record->event.pressed, record->event.key));
-#else
-            register_code16(keycode);
-            send_keyboard_report();
-            unregister_code16(keycode);
-#endif
-            combo->timer = 0;            
+    combo_iter_start(&it, keycode);
+    while (combo_iter_next(&it)) {
+        combo_t *combo = get_combo(it.combo);
+        if (combo->active || COMBO_STATE_BITPOP(combo->state) != key_buffer_count) {
+            continue;
         }
+        combo->state |= (1<<it.key);
+        if (combo->count == key_buffer_count + 1) {
+            /* The first combo wins when several have the same keys */
+            if (longest_combo == COMBO_NONE ||
+                get_combo(longest_combo)->count < combo->count) {
+                longest_combo = it.combo;
+            }
+        } else {
+            waiting = true;
+        }
+    }
 
-        KEY_STATE_UP(index);        
+    if (!key_buffer_count) {
+        key_buffer_timer = timer_read();
     }
+    key_buffer[key_buffer_count].record = *record;
+    key_buffer[key_buffer_count].keycode = keycode;
+    ++key_buffer_count;
 
-    if (NO_COMBO_KEYS_ARE_DOWN) {
-        combo->timer = 0;
+    /* No longer combo can be completed, or there's no room to try */
+    if (!waiting || key_buffer_count == COMBO_BUFFER_LENGTH) {
+        resolve_key_buffer();
     }
+    return true;
+}
 
-    return is_combo_active;
+/* Releases the combos that were pressed with the key. Returns true if the
+ * key was part of such a combo.
+ */
+static bool release_combo_key(uint16_t keycode)
+{
+    bool is_combo_key = false;
+    combo_iter_t it;
+
+    combo_iter_start(&it, keycode);
+    while (combo_iter_next(&it)) {
+        combo_t *combo = get_combo(it.combo);
+        if (!combo->active || !(combo->state & (1<<it.key))) {
+            continue;
+        }
+        if (((1<<combo->count)-1) == combo->state) {
+            /* The first key that is released releases the combo */
+            send_combo(it.combo, false);
+        }
+        combo->state &= ~(1<<it.key);
+        if (!combo->state) {
+            combo->active = false;
+        }
+        is_combo_key = true;
+    }
+    return is_combo_key;
 }
 
 bool process_combo(uint16_t keycode, keyrecord_t *record)
 {
-    bool is_combo_key = false;
+    if (replaying) return true;
 
-    for (current_combo_index = 0; current_combo_index < COMBO_COUNT; ++current_combo_index) {
-        combo_t *combo = &key_combos[current_combo_index];
-        is_combo_key |= process_single_combo(combo, keycode, record);
-    }    
+    if (record->event.pressed) {
+        if (buffer_combo_key(keycode, record)) {
+            return false;
+        }
+        if (key_buffer_count) {
+            /* The press can't be part of the same combo, so the buffer
+             * has to be resolved before this press is processed
+             */
+            resolve_key_buffer();
+            if (buffer_combo_key(keycode, record)) {
+                return false;
+            }
+        }
+        return true;
+    }
 
-    return !is_combo_key;
+    resolve_key_buffer();
+    return !release_combo_key(keycode);
 }
 
-void matrix_scan_combo(void)
+/** \brief Changes the keys of a combo
+ *
+ * The presses waiting for a combo are processed first, and the combo is
+ * released if it's held, then the index is built again.
+ */
+void combo_set_keys(uint8_t combo_index, const uint16_t *keys)
 {
-    for (int i = 0; i < COMBO_COUNT; ++i) {
-        // Do not treat the (weak) key_combos too strict.
-        #pragma GCC diagnostic push
-        #pragma GCC diagnostic ignored "-Warray-bounds"
-        combo_t *combo = &key_combos[i];
-        #pragma GCC diagnostic pop
-        if (combo->timer &&
-            combo->timer != COMBO_TIMER_ELAPSED && 
-            timer_elapsed(combo->timer) > COMBO_TERM) {
-            
-            /* This disables the combo, meaning key events for this
-             * combo will be handled by the next processors in the chain 
-             */
-            combo->timer = COMBO_TIMER_ELAPSED;
+    if (combo_index >= COMBO_COUNT) return;
 
-#ifdef COMBO_ALLOW_ACTION_KEYS
-            process_action(&combo->prev_record, 
-                store_or_get_action(combo->prev_record.event.pressed, 
-                                    combo->prev_record.event.key));
-#else
-            unregister_code16(combo->prev_key);
-            register_code16(combo->prev_key);
-#endif
+    resolve_key_buffer();
+    combo_t *combo = get_combo(combo_index);
+    if (combo->active) {
+        if (((1<<combo->count)-1) == combo->state) {
+            send_combo(combo_index, false);
         }
+        combo->state = 0;
+        combo->active = false;
+    }
+    combo->keys = keys;
+    combo_build_index();
+}
+
+/** \brief Returns true while presses wait for the rest of a combo */
+bool combo_pending(void)
+{
+    return key_buffer_count;
+}
+
+void matrix_scan_combo(void)
+{
+    if (key_buffer_count && timer_elapsed(key_buffer_timer) > COMBO_TERM) {
+        resolve_key_buffer();
     }
 }
@@ -32,12 +32,8 @@ typedef struct
 #else
     uint8_t state;
 #endif
-    uint16_t timer;
-#ifdef COMBO_ALLOW_ACTION_KEYS
-    keyrecord_t prev_record;
-#else
-    uint16_t prev_key;
-#endif
+    uint8_t count;
+    bool active;
 } combo_t;
 
 
@@ -52,6 +48,9 @@ typedef struct
 #define COMBO_TERM TAPPING_TERM
 #endif
 
+void combo_init(void);
+bool combo_pending(void);
+void combo_set_keys(uint8_t combo_index, const uint16_t *keys);
 bool process_combo(uint16_t keycode, keyrecord_t *record);
 void matrix_scan_combo(void);
 void process_combo_event(uint8_t combo_index, bool pressed);
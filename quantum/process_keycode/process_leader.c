@@ -28,13 +28,87 @@ void leader_start(void) {}
 __attribute__ ((weak))
 void leader_end(void) {}
 
+/* No leader table, the keymap uses LEADER_DICTIONARY() instead. The entry
+ * is never read, it only keeps the array from being empty.
+ */
+__attribute__ ((weak))
+const leader_seq_t leader_sequences[1] PROGMEM = {{{0}, 0, NULL}};
+__attribute__ ((weak))
+uint16_t leader_sequence_count(void) { return 0; }
+
 // Leader key stuff
 bool leading = false;
 uint16_t leader_time = 0;
 
-uint16_t leader_sequence[5] = {0, 0, 0, 0, 0};
+uint16_t leader_sequence[LEADER_MAX_LENGTH] = {0};
 uint8_t leader_sequence_size = 0;
 
+/* The table entries that can still match are between these two */
+static uint16_t leader_first = 0;
+static uint16_t leader_last = 0;
+/* The entry that matches the keys typed so far exactly, if any */
+static uint16_t leader_exact = 0;
+static bool leader_has_exact = false;
+
+static void leader_finish(void) {
+  leading = false;
+  if (leader_has_exact) {
+    leader_has_exact = false;
+    const leader_seq_t *seq = &leader_sequences[leader_exact];
+    void (*action)(void) = (void (*)(void))pgm_read_ptr(&seq->action);
+    if (action) {
+      action();
+    } else {
+      uint16_t keycode = pgm_read_word(&seq->keycode);
+      register_code16(keycode);
+      unregister_code16(keycode);
+    }
+  }
+  leader_end();
+}
+
+/* Narrows the table entries down to the ones starting with the keys typed
+ * so far. Fires the sequence once no longer one can match, and ends the
+ * leader when nothing matches anymore.
+ */
+static void leader_match(void) {
+  uint8_t depth = leader_sequence_size;
+  uint16_t count = leader_sequence_count();
+  uint16_t first = count;
+  uint16_t last = 0;
+  bool longer = false;
+
+  leader_has_exact = false;
+  for (uint16_t i = leader_first; i <= leader_last && i < count; i++) {
+    const uint16_t *keys = leader_sequences[i].keys;
+    // The newest key first, it rejects most entries
+    bool match = true;
+    for (int8_t k = depth - 1; k >= 0; k--) {
+      if (pgm_read_word(&keys[k]) != leader_sequence[k]) {
+        match = false;
+        break;
+      }
+    }
+    if (!match) continue;
+
+    if (first > i) first = i;
+    last = i;
+    if (depth < LEADER_MAX_LENGTH && pgm_read_word(&keys[depth])) {
+      longer = true;
+    } else if (!leader_has_exact) {
+      leader_exact = i;
+      leader_has_exact = true;
+    }
+  }
+
+  leader_first = first;
+  leader_last = last;
+  if (!longer) {
+    // Either the sequence is complete, or it can't be completed anymore
+    leader_finish();
+  }
+}
+
 bool process_leader(uint16_t keycode, keyrecord_t *record) {
   // Leader key set-up
   if (record->event.pressed) {
@@ -43,20 +117,33 @@ bool process_leader(uint16_t keycode, keyrecord_t *record) {
       leading = true;
       leader_time = timer_read();
       leader_sequence_size = 0;
-      leader_sequence[0] = 0;
-      leader_sequence[1] = 0;
-      leader_sequence[2] = 0;
-      leader_sequence[3] = 0;
-      leader_sequence[4] = 0;
+      for (uint8_t i = 0; i < LEADER_MAX_LENGTH; i++) {
+        leader_sequence[i] = 0;
+      }
+      leader_first = 0;
+      leader_last = leader_sequence_count() ? leader_sequence_count() - 1 : 0;
+      leader_has_exact = false;
       return false;
     }
     if (leading && timer_elapsed(leader_time) < LEADER_TIMEOUT) {
-      leader_sequence[leader_sequence_size] = keycode;
-      leader_sequence_size++;
+      if (leader_sequence_size < LEADER_MAX_LENGTH) {
+        leader_sequence[leader_sequence_size] = keycode;
+        leader_sequence_size++;
+        if (leader_sequence_count()) {
+          leader_match();
+        }
+      }
       return false;
     }
   }
   return true;
 }
 
+void matrix_scan_leader(void) {
+  // The keymap handles the timeout itself without a table
+  if (leading && leader_sequence_count() && timer_elapsed(leader_time) > LEADER_TIMEOUT) {
+    leader_finish();
+  }
+}
+
 #endif
@@ -20,7 +20,40 @@
 #include "quantum.h"
 
 
+#ifndef LEADER_MAX_LENGTH
+  #define LEADER_MAX_LENGTH 5
+#endif
+
+#if LEADER_MAX_LENGTH < 5
+  #error "LEADER_MAX_LENGTH can't be less than 5, the SEQ_* macros use five keys"
+#endif
+
+/* A sequence of the leader table. It either taps a keycode or calls a
+ * function, and is stored in PROGMEM with unused keys set to 0.
+ */
+typedef struct {
+  uint16_t keys[LEADER_MAX_LENGTH];
+  uint16_t keycode;
+  void (*action)(void);
+} leader_seq_t;
+
+#define LEADER_SEQ(fn, ...)       {.keys = {__VA_ARGS__}, .action = (fn)}
+#define LEADER_SEQ_KEY(kc, ...)   {.keys = {__VA_ARGS__}, .keycode = (kc)}
+
+/* Defines the leader table of a keymap. Sequences sharing a prefix are
+ * searched faster when they are next to each other, sorted is best.
+ */
+#define LEADER_SEQUENCES(...) \
+  const leader_seq_t PROGMEM leader_sequences[] = {__VA_ARGS__}; \
+  uint16_t leader_sequence_count(void) { return sizeof(leader_sequences) / sizeof(leader_sequences[0]); }
+
+extern const leader_seq_t leader_sequences[];
+uint16_t leader_sequence_count(void);
+
 bool process_leader(uint16_t keycode, keyrecord_t *record);
+void matrix_scan_leader(void);
+
+extern bool leading;
 
 void leader_start(void);
 void leader_end(void);
@@ -32,7 +65,7 @@ void leader_end(void);
 #define SEQ_FOUR_KEYS(key1, key2, key3, key4) if (leader_sequence[0] == (key1) && leader_sequence[1] == (key2) && leader_sequence[2] == (key3) && leader_sequence[3] == (key4) && leader_sequence[4] == 0)
 #define SEQ_FIVE_KEYS(key1, key2, key3, key4, key5) if (leader_sequence[0] == (key1) && leader_sequence[1] == (key2) && leader_sequence[2] == (key3) && leader_sequence[3] == (key4) && leader_sequence[4] == (key5))
 
-#define LEADER_EXTERNS() extern bool leading; extern uint16_t leader_time; extern uint16_t leader_sequence[5]; extern uint8_t leader_sequence_size
+#define LEADER_EXTERNS() extern bool leading; extern uint16_t leader_time; extern uint16_t leader_sequence[LEADER_MAX_LENGTH]; extern uint8_t leader_sequence_size
 #define LEADER_DICTIONARY() if (leading && timer_elapsed(leader_time) > LEADER_TIMEOUT)
 
 #endif
@@ -14,13 +14,39 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
 #include "process_ucis.h"
 
 qk_ucis_state_t qk_ucis_state;
 
+/* Counted on the first use, a sorted table is searched with binary search */
+static uint16_t ucis_symbol_count = 0;
+static bool ucis_table_sorted = false;
+static bool ucis_table_checked = false;
+/* The first symbol starting with the typed characters, or ucis_symbol_count
+ * when none does, so no more searching is needed until a backspace
+ */
+static uint16_t ucis_match = 0;
+
+static void ucis_check_table(void) {
+  ucis_symbol_count = 0;
+  ucis_table_sorted = true;
+  for (uint16_t i = 0; ucis_symbol_table[i].symbol; i++) {
+    if (i > 0 && strcmp(ucis_symbol_table[i - 1].symbol, ucis_symbol_table[i].symbol) >= 0) {
+      ucis_table_sorted = false;
+    }
+    ucis_symbol_count++;
+  }
+  ucis_table_checked = true;
+}
+
 void qk_ucis_start(void) {
+  if (!ucis_table_checked) {
+    ucis_check_table();
+  }
   qk_ucis_state.count = 0;
   qk_ucis_state.in_progress = true;
+  ucis_match = 0;
 
   qk_ucis_start_user();
 }
@@ -32,22 +58,68 @@ void qk_ucis_start_user(void) {
   unicode_input_finish();
 }
 
-static bool is_uni_seq(char *seq) {
-  uint8_t i;
+/* The character of a typed key, or 0 if it can't be part of a symbol */
+static char ucis_char(uint16_t keycode) {
+  switch (keycode) {
+  case KC_A ... KC_Z:
+    return keycode - KC_A + 'a';
+  case KC_1 ... KC_9:
+    return keycode - KC_1 + '1';
+  case KC_0:
+    return '0';
+  }
+  return 0;
+}
 
-  for (i = 0; seq[i]; i++) {
-    uint16_t code;
-    if (('1' <= seq[i]) && (seq[i] <= '0'))
-      code = seq[i] - '1' + KC_1;
-    else
-      code = seq[i] - 'a' + KC_A;
+/* Compares the start of a symbol with the first len typed characters, which
+ * are all valid, like strncmp does
+ */
+static int8_t ucis_compare(const char *symbol, uint8_t len) {
+  for (uint8_t i = 0; i < len; i++) {
+    char c = ucis_char(qk_ucis_state.codes[i]);
+    if (symbol[i] != c) {
+      return symbol[i] < c ? -1 : 1;
+    }
+  }
+  return 0;
+}
 
-    if (i > qk_ucis_state.count || qk_ucis_state.codes[i] != code)
-      return false;
+/* Returns the first symbol starting with the first len typed characters, or
+ * only the one that is exactly those, and ucis_symbol_count if there's none
+ */
+static uint16_t ucis_find(uint8_t len, bool exact) {
+  for (uint8_t i = 0; i < len; i++) {
+    if (!ucis_char(qk_ucis_state.codes[i])) {
+      return ucis_symbol_count;
+    }
+  }
+
+  if (ucis_table_sorted) {
+    uint16_t lo = 0;
+    uint16_t hi = ucis_symbol_count;
+    while (lo < hi) {
+      uint16_t mid = lo + (hi - lo) / 2;
+      if (ucis_compare(ucis_symbol_table[mid].symbol, len) < 0) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    // a symbol sorts before the longer ones it's the start of
+    if (lo < ucis_symbol_count && ucis_compare(ucis_symbol_table[lo].symbol, len) == 0 &&
+        (!exact || ucis_symbol_table[lo].symbol[len] == 0)) {
+      return lo;
+    }
+    return ucis_symbol_count;
   }
 
-  return (qk_ucis_state.codes[i] == KC_ENT ||
-          qk_ucis_state.codes[i] == KC_SPC);
+  for (uint16_t i = 0; i < ucis_symbol_count; i++) {
+    if (ucis_compare(ucis_symbol_table[i].symbol, len) == 0 &&
+        (!exact || ucis_symbol_table[i].symbol[len] == 0)) {
+      return i;
+    }
+  }
+  return ucis_symbol_count;
 }
 
 __attribute__((weak))
@@ -108,6 +180,7 @@ bool process_ucis (uint16_t keycode, keyrecord_t *record) {
   if (keycode == KC_BSPC) {
     if (qk_ucis_state.count >= 2) {
       qk_ucis_state.count -= 2;
+      ucis_match = ucis_find(qk_ucis_state.count, false);
       return true;
     } else {
       qk_ucis_state.count--;
@@ -116,13 +189,14 @@ bool process_ucis (uint16_t keycode, keyrecord_t *record) {
   }
 
   if (keycode == KC_ENT || keycode == KC_SPC || keycode == KC_ESC) {
-    bool symbol_found = false;
+    uint8_t length = qk_ucis_state.count - 1;
 
+    // The host doesn't need time between the backspaces, only after them
     for (i = qk_ucis_state.count; i > 0; i--) {
       register_code (KC_BSPC);
       unregister_code (KC_BSPC);
-      wait_ms(UNICODE_TYPE_DELAY);
     }
+    wait_ms(UNICODE_TYPE_DELAY);
 
     if (keycode == KC_ESC) {
       qk_ucis_state.in_progress = false;
@@ -130,14 +204,12 @@ bool process_ucis (uint16_t keycode, keyrecord_t *record) {
     }
 
     unicode_input_start();
-    for (i = 0; ucis_symbol_table[i].symbol; i++) {
-      if (is_uni_seq (ucis_symbol_table[i].symbol)) {
-        symbol_found = true;
-        register_ucis(ucis_symbol_table[i].code + 2);
-        break;
-      }
+    if (ucis_match < ucis_symbol_count) {
+      ucis_match = ucis_find(length, true);
     }
-    if (!symbol_found) {
+    if (ucis_match < ucis_symbol_count) {
+      register_ucis(ucis_symbol_table[ucis_match].code + 2);
+    } else {
       qk_ucis_symbol_fallback();
     }
     unicode_input_finish();
@@ -145,5 +217,11 @@ bool process_ucis (uint16_t keycode, keyrecord_t *record) {
     qk_ucis_state.in_progress = false;
     return false;
   }
+
+  // Once nothing starts with the typed characters, only a backspace can
+  // change that
+  if (ucis_match < ucis_symbol_count) {
+    ucis_match = ucis_find(qk_ucis_state.count, false);
+  }
   return true;
 }
@@ -31,12 +31,16 @@ typedef struct {
 
 typedef struct {
   uint8_t count;
-  uint16_t codes[UCIS_MAX_SYMBOL_LENGTH];
+  // the name, and the key that ends it
+  uint16_t codes[UCIS_MAX_SYMBOL_LENGTH + 1];
   bool in_progress:1;
 } qk_ucis_state_t;
 
 extern qk_ucis_state_t qk_ucis_state;
 
+/* A table sorted by symbol name is searched with binary search, otherwise
+ * every symbol is compared with the typed name.
+ */
 #define UCIS_TABLE(...) {__VA_ARGS__, {NULL, NULL}}
 #define UCIS_SYM(name, code) {name, #code}
 
@@ -322,9 +322,6 @@ bool process_record_quantum(keyrecord_t *record) {
     if (!record->event.pressed) {
     #endif
       rgblight_toggle();
-      #ifdef SPLIT_KEYBOARD
-          RGB_DIRTY = true;
-      #endif
     }
     return false;
   case RGB_MODE_FORWARD:
@@ -336,9 +333,6 @@ bool process_record_quantum(keyrecord_t *record) {
       else {
         rgblight_step();
       }
-      #ifdef SPLIT_KEYBOARD
-          RGB_DIRTY = true;
-      #endif
     }
     return false;
   case RGB_MODE_REVERSE:
@@ -350,9 +344,6 @@ bool process_record_quantum(keyrecord_t *record) {
       else {
         rgblight_step_reverse();
       }
-      #ifdef SPLIT_KEYBOARD
-          RGB_DIRTY = true;
-      #endif
     }
     return false;
   case RGB_HUI:
@@ -363,9 +354,6 @@ bool process_record_quantum(keyrecord_t *record) {
     if (!record->event.pressed) {
     #endif
       rgblight_increase_hue();
-      #ifdef SPLIT_KEYBOARD
-          RGB_DIRTY = true;
-      #endif
     }
     return false;
   case RGB_HUD:
@@ -376,9 +364,6 @@ bool process_record_quantum(keyrecord_t *record) {
     if (!record->event.pressed) {
     #endif
       rgblight_decrease_hue();
-      #ifdef SPLIT_KEYBOARD
-          RGB_DIRTY = true;
-      #endif
     }
     return false;
   case RGB_SAI:
@@ -389,9 +374,6 @@ bool process_record_quantum(keyrecord_t *record) {
     if (!record->event.pressed) {
     #endif
       rgblight_increase_sat();
-      #ifdef SPLIT_KEYBOARD
-          RGB_DIRTY = true;
-      #endif
     }
     return false;
   case RGB_SAD:
@@ -402,9 +384,6 @@ bool process_record_quantum(keyrecord_t *record) {
     if (!record->event.pressed) {
     #endif
       rgblight_decrease_sat();
-      #ifdef SPLIT_KEYBOARD
-          RGB_DIRTY = true;
-      #endif
     }
     return false;
   case RGB_VAI:
@@ -415,9 +394,6 @@ bool process_record_quantum(keyrecord_t *record) {
     if (!record->event.pressed) {
     #endif
       rgblight_increase_val();
-      #ifdef SPLIT_KEYBOARD
-          RGB_DIRTY = true;
-      #endif
     }
     return false;
   case RGB_VAD:
@@ -428,9 +404,6 @@ bool process_record_quantum(keyrecord_t *record) {
     if (!record->event.pressed) {
     #endif
       rgblight_decrease_val();
-      #ifdef SPLIT_KEYBOARD
-          RGB_DIRTY = true;
-      #endif
     }
     return false;
   case RGB_SPI:
@@ -446,9 +419,6 @@ bool process_record_quantum(keyrecord_t *record) {
   case RGB_MODE_PLAIN:
     if (record->event.pressed) {
       rgblight_mode(1);
-      #ifdef SPLIT_KEYBOARD
-          RGB_DIRTY = true;
-      #endif
     }
     return false;
   case RGB_MODE_BREATHE:
@@ -793,6 +763,10 @@ void send_string_P(const char *str) {
 }
 
 void send_string_with_delay(const char *str, uint8_t interval) {
+#ifdef SEND_STRING_ASYNC_ENABLE
+    send_string_async_flush();
+#endif
+    host_keyboard_begin();
     while (1) {
         char ascii_code = *str;
         if (!ascii_code) break;
@@ -814,11 +788,21 @@ void send_string_with_delay(const char *str, uint8_t interval) {
         }
         ++str;
         // interval
-        { uint8_t ms = interval; while (ms--) wait_ms(1); }
+        if (interval) {
+            // the host has to see the character before the wait
+            host_keyboard_commit();
+            { uint8_t ms = interval; while (ms--) wait_ms(1); }
+            host_keyboard_begin();
+        }
     }
+    host_keyboard_commit();
 }
 
 void send_string_with_delay_P(const char *str, uint8_t interval) {
+#ifdef SEND_STRING_ASYNC_ENABLE
+    send_string_async_flush();
+#endif
+    host_keyboard_begin();
     while (1) {
         char ascii_code = pgm_read_byte(str);
         if (!ascii_code) break;
@@ -840,13 +824,23 @@ void send_string_with_delay_P(const char *str, uint8_t interval) {
         }
         ++str;
         // interval
-        { uint8_t ms = interval; while (ms--) wait_ms(1); }
+        if (interval) {
+            // the host has to see the character before the wait
+            host_keyboard_commit();
+            { uint8_t ms = interval; while (ms--) wait_ms(1); }
+            host_keyboard_begin();
+        }
     }
+    host_keyboard_commit();
 }
 
 void send_char(char ascii_code) {
   uint8_t keycode;
   keycode = pgm_read_byte(&ascii_to_keycode_lut[(uint8_t)ascii_code]);
+  #ifdef SEND_STRING_ASYNC_ENABLE
+    send_string_async_flush();
+  #endif
+  host_keyboard_begin();
   if (pgm_read_byte(&ascii_to_shift_lut[(uint8_t)ascii_code])) {
       register_code(KC_LSFT);
       register_code(keycode);
@@ -856,6 +850,7 @@ void send_char(char ascii_code) {
       register_code(keycode);
       unregister_code(keycode);
   }
+  host_keyboard_commit();
 }
 
 void set_single_persistent_default_layer(uint8_t default_layer) {
@@ -924,13 +919,27 @@ void matrix_init_quantum() {
   #ifdef RGB_MATRIX_ENABLE
     rgb_matrix_init();
   #endif
+  #ifdef COMBO_ENABLE
+    combo_init();
+  #endif
   matrix_init_kb();
 }
 
-uint8_t rgb_matrix_task_counter = 0;
-
-#ifndef RGB_MATRIX_SKIP_FRAMES
-  #define RGB_MATRIX_SKIP_FRAMES 1
+#ifdef IDLE_SLEEP_ENABLE
+/** \brief Keeps the scan loop awake while a combo or a leader sequence waits */
+bool keyboard_idle_quantum(void) {
+  #ifdef COMBO_ENABLE
+    if (combo_pending()) {
+      return false;
+    }
+  #endif
+  #ifdef LEADER_ENABLE
+    if (leading) {
+      return false;
+    }
+  #endif
+  return keyboard_idle_kb();
+}
 #endif
 
 void matrix_scan_quantum() {
@@ -946,16 +955,20 @@ void matrix_scan_quantum() {
     matrix_scan_combo();
   #endif
 
+  #ifndef DISABLE_LEADER
+    matrix_scan_leader();
+  #endif
+
+  #ifdef SEND_STRING_ASYNC_ENABLE
+    send_string_async_task();
+  #endif
+
   #if defined(BACKLIGHT_ENABLE) && defined(BACKLIGHT_PIN)
     backlight_task();
   #endif
 
   #ifdef RGB_MATRIX_ENABLE
     rgb_matrix_task();
-    if (rgb_matrix_task_counter == 0) {
-      rgb_matrix_update_pwm_buffers();
-    }
-    rgb_matrix_task_counter = ((rgb_matrix_task_counter + 1) % (RGB_MATRIX_SKIP_FRAMES + 1));
   #endif
 
   matrix_scan_kb();
@@ -34,10 +34,6 @@
   #include "rgblight.h"
 #endif
 
-#ifdef SPLIT_KEYBOARD
-    #include "split_flags.h"
-#endif
-
 #ifdef RGB_MATRIX_ENABLE
 	#include "rgb_matrix.h"
 #endif
@@ -50,6 +46,7 @@
 #include "config_common.h"
 #include "led.h"
 #include "action_util.h"
+#include "host.h"
 #include <stdlib.h>
 #include "print.h"
 #include "send_string_keycodes.h"
@@ -132,6 +129,10 @@ extern uint32_t default_layer_state;
 	#include "hd44780.h"
 #endif
 
+#ifdef SEND_STRING_ASYNC_ENABLE
+	#include "send_string_async.h"
+#endif
+
 #define STRINGIZE(z) #z
 #define ADD_SLASH_X(y) STRINGIZE(\x ## y)
 #define SYMBOL_STR(x) ADD_SLASH_X(x)
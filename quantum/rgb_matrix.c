@@ -25,7 +25,6 @@
 #include "config.h"
 #include "eeprom.h"
 #include "lufa.h"
-#include <math.h>
 
 rgb_config_t rgb_matrix_config;
 
@@ -47,19 +46,29 @@ rgb_config_t rgb_matrix_config;
 
 bool g_suspend_state = false;
 
-// Global tick at 20 Hz
+#ifndef RGB_MATRIX_FRAME_MS
+    #define RGB_MATRIX_FRAME_MS 16
+#endif
+#define RGB_MATRIX_FRAMES_PER_SECOND (1000 / RGB_MATRIX_FRAME_MS)
+
+// The number of LEDs computed in one call of rgb_matrix_task
+#ifndef RGB_MATRIX_LED_PROCESS_LIMIT
+    #define RGB_MATRIX_LED_PROCESS_LIMIT ((DRIVER_LED_TOTAL + 4) / 5)
+#endif
+
+#if RGB_MATRIX_LED_PROCESS_LIMIT < 1
+    #error "RGB_MATRIX_LED_PROCESS_LIMIT must be at least 1"
+#endif
+
+// Global tick, once per frame
 uint32_t g_tick = 0;
 
-// Ticks since this key was last hit.
+// Frames since this key was last hit.
 uint8_t g_key_hit[DRIVER_LED_TOTAL];
 
-// Ticks since any key was last hit.
+// Frames since any key was last hit.
 uint32_t g_any_key_hit = 0;
 
-#ifndef PI
-#define PI 3.14159265
-#endif
-
 uint32_t eeconfig_read_rgb_matrix(void) {
   return eeprom_read_dword(EECONFIG_RGB_MATRIX);
 }
@@ -91,20 +100,40 @@ void eeconfig_debug_rgb_matrix(void) {
 uint8_t g_last_led_hit[LED_HITS_TO_REMEMBER] = {255};
 uint8_t g_last_led_count = 0;
 
-void map_row_column_to_led( uint8_t row, uint8_t column, uint8_t *led_i, uint8_t *led_count) {
-    rgb_led led;
-    *led_count = 0;
+// The first LED of each key, and the next LED of the same key, so that the
+// LEDs of a key are found without searching all of them
+#define NO_LED 255
+static uint8_t g_first_led[MATRIX_ROWS][MATRIX_COLS];
+static uint8_t g_next_led[DRIVER_LED_TOTAL];
 
-    for (uint8_t i = 0; i < DRIVER_LED_TOTAL; i++) {
-        // map_index_to_led(i, &led);
-        led = g_rgb_leds[i];
-        if (row == led.matrix_co.row && column == led.matrix_co.col) {
-            led_i[*led_count] = i;
-            (*led_count)++;
+static void rgb_matrix_init_led_index(void) {
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            g_first_led[row][col] = NO_LED;
+        }
+    }
+    // Backwards, so that the LEDs of a key are listed in order
+    for (int16_t i = DRIVER_LED_TOTAL - 1; i >= 0; i--) {
+        rgb_led led = g_rgb_leds[i];
+        g_next_led[i] = NO_LED;
+        if (led.matrix_co.row < MATRIX_ROWS && led.matrix_co.col < MATRIX_COLS) {
+            g_next_led[i] = g_first_led[led.matrix_co.row][led.matrix_co.col];
+            g_first_led[led.matrix_co.row][led.matrix_co.col] = i;
         }
     }
 }
 
+void map_row_column_to_led( uint8_t row, uint8_t column, uint8_t *led_i, uint8_t *led_count) {
+    *led_count = 0;
+    if (row >= MATRIX_ROWS || column >= MATRIX_COLS) {
+        return;
+    }
+    for (uint8_t i = g_first_led[row][column]; i != NO_LED; i = g_next_led[i]) {
+        led_i[*led_count] = i;
+        (*led_count)++;
+    }
+}
+
 void rgb_matrix_update_pwm_buffers(void) {
     IS31FL3731_update_pwm_buffers( DRIVER_ADDR_1, DRIVER_ADDR_2 );
     IS31FL3731_update_led_control_registers( DRIVER_ADDR_1, DRIVER_ADDR_2 );
@@ -231,9 +260,9 @@ void rgb_matrix_solid_color(void) {
     rgb_matrix_set_color_all( rgb.r, rgb.g, rgb.b );
 }
 
-void rgb_matrix_solid_reactive(void) {
+void rgb_matrix_solid_reactive(uint8_t led_min, uint8_t led_max) {
 	// Relies on hue being 8-bit and wrapping
-	for ( int i=0; i<DRIVER_LED_TOTAL; i++ )
+	for ( int i=led_min; i<led_max; i++ )
 	{
 		uint16_t offset2 = g_key_hit[i]<<2;
 		offset2 = (offset2<=130) ? (130-offset2) : 0;
@@ -245,13 +274,13 @@ void rgb_matrix_solid_reactive(void) {
 }
 
 // alphas = color1, mods = color2
-void rgb_matrix_alphas_mods(void) {
+void rgb_matrix_alphas_mods(uint8_t led_min, uint8_t led_max) {
 
     RGB rgb1 = hsv_to_rgb( (HSV){ .h = rgb_matrix_config.hue, .s = rgb_matrix_config.sat, .v = rgb_matrix_config.val } );
     RGB rgb2 = hsv_to_rgb( (HSV){ .h = (rgb_matrix_config.hue + 180) % 360, .s = rgb_matrix_config.sat, .v = rgb_matrix_config.val } );
 
     rgb_led led;
-    for (int i = 0; i < DRIVER_LED_TOTAL; i++) {
+    for (int i = led_min; i < led_max; i++) {
         led = g_rgb_leds[i];
         if ( led.matrix_co.raw < 0xFF ) {
             if ( led.modifier )
@@ -266,7 +295,7 @@ void rgb_matrix_alphas_mods(void) {
     }
 }
 
-void rgb_matrix_gradient_up_down(void) {
+void rgb_matrix_gradient_up_down(uint8_t led_min, uint8_t led_max) {
     int16_t h1 = rgb_matrix_config.hue;
     int16_t h2 = (rgb_matrix_config.hue + 180) % 360;
     int16_t deltaH = h2 - h1;
@@ -290,7 +319,7 @@ void rgb_matrix_gradient_up_down(void) {
     HSV hsv = { .h = 0, .s = 255, .v = rgb_matrix_config.val };
     RGB rgb;
     Point point;
-    for ( int i=0; i<DRIVER_LED_TOTAL; i++ )
+    for ( int i=led_min; i<led_max; i++ )
     {
         // map_led_to_point( i, &point );
         point = g_rgb_leds[i].point;
@@ -304,7 +333,7 @@ void rgb_matrix_gradient_up_down(void) {
     }
 }
 
-void rgb_matrix_raindrops(bool initialize) {
+void rgb_matrix_raindrops(bool initialize, uint8_t led_min, uint8_t led_max) {
     int16_t h1 = rgb_matrix_config.hue;
     int16_t h2 = (rgb_matrix_config.hue + 180) % 360;
     int16_t deltaH = h2 - h1;
@@ -328,9 +357,13 @@ void rgb_matrix_raindrops(bool initialize) {
     RGB rgb;
 
     // Change one LED every tick, make sure speed is not 0
-    uint8_t led_to_change = ( g_tick & ( 0x0A / (rgb_matrix_config.speed == 0 ? 1 : rgb_matrix_config.speed) ) ) == 0 ? rand() % (DRIVER_LED_TOTAL) : 255;
+    // The frame can be split in several calls, pick the LED in the first one
+    static uint8_t led_to_change = 255;
+    if ( led_min == 0 ) {
+        led_to_change = ( g_tick & ( 0x0A / (rgb_matrix_config.speed == 0 ? 1 : rgb_matrix_config.speed) ) ) == 0 ? rand() % (DRIVER_LED_TOTAL) : 255;
+    }
 
-    for ( int i=0; i<DRIVER_LED_TOTAL; i++ )
+    for ( int i=led_min; i<led_max; i++ )
     {
         // If initialize, all get set to random colors
         // If not, all but one will stay the same as before.
@@ -347,13 +380,13 @@ void rgb_matrix_raindrops(bool initialize) {
     }
 }
 
-void rgb_matrix_cycle_all(void) {
+void rgb_matrix_cycle_all(uint8_t led_min, uint8_t led_max) {
     uint8_t offset = ( g_tick << rgb_matrix_config.speed ) & 0xFF;
 
     rgb_led led;
 
     // Relies on hue being 8-bit and wrapping
-    for ( int i=0; i<DRIVER_LED_TOTAL; i++ )
+    for ( int i=led_min; i<led_max; i++ )
     {
         // map_index_to_led(i, &led);
         led = g_rgb_leds[i];
@@ -368,13 +401,13 @@ void rgb_matrix_cycle_all(void) {
     }
 }
 
-void rgb_matrix_cycle_left_right(void) {
+void rgb_matrix_cycle_left_right(uint8_t led_min, uint8_t led_max) {
     uint8_t offset = ( g_tick << rgb_matrix_config.speed ) & 0xFF;
     HSV hsv = { .h = 0, .s = 255, .v = rgb_matrix_config.val };
     RGB rgb;
     Point point;
     rgb_led led;
-    for ( int i=0; i<DRIVER_LED_TOTAL; i++ )
+    for ( int i=led_min; i<led_max; i++ )
     {
         // map_index_to_led(i, &led);
         led = g_rgb_leds[i];
@@ -392,13 +425,13 @@ void rgb_matrix_cycle_left_right(void) {
     }
 }
 
-void rgb_matrix_cycle_up_down(void) {
+void rgb_matrix_cycle_up_down(uint8_t led_min, uint8_t led_max) {
     uint8_t offset = ( g_tick << rgb_matrix_config.speed ) & 0xFF;
     HSV hsv = { .h = 0, .s = 255, .v = rgb_matrix_config.val };
     RGB rgb;
     Point point;
     rgb_led led;
-    for ( int i=0; i<DRIVER_LED_TOTAL; i++ )
+    for ( int i=led_min; i<led_max; i++ )
     {
         // map_index_to_led(i, &led);
         led = g_rgb_leds[i];
@@ -417,65 +450,146 @@ void rgb_matrix_cycle_up_down(void) {
 }
 
 
-void rgb_matrix_dual_beacon(void) {
+// Quarter of a sine wave, scaled to 255
+static const uint8_t PROGMEM sin_quarter[65] = {
+      0,   6,  13,  19,  25,  31,  37,  44,  50,  56,  62,  68,  74,  80,  86,  92,
+     98, 103, 109, 115, 120, 126, 131, 136, 142, 147, 152, 157, 162, 167, 171, 176,
+    180, 185, 189, 193, 197, 201, 205, 208, 212, 215, 219, 222, 225, 228, 231, 233,
+    236, 238, 240, 242, 244, 246, 247, 249, 250, 251, 252, 253, 254, 254, 255, 255,
+    255
+};
+
+// The sine of an angle where 256 is a full turn, scaled to -256..256, so
+// that a product with it is divided by 256. The table stops at 255, so the
+// upper half is stretched by one, like scale8 does with its scale.
+static int16_t sin_fixed(uint8_t angle) {
+    uint8_t i = angle & 0x3F;
+    int16_t value;
+    if (angle & 0x40) {
+        value = pgm_read_byte(&sin_quarter[64 - i]);
+    } else {
+        value = pgm_read_byte(&sin_quarter[i]);
+    }
+    value += value >> 7;
+    return (angle & 0x80) ? -value : value;
+}
+
+static int16_t cos_fixed(uint8_t angle) {
+    return sin_fixed(angle + 64);
+}
+
+// Floor of the square root, the same as (uint16_t)sqrt(value)
+static uint16_t sqrt_fixed(uint32_t value) {
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+// The distance between two LEDs, in the units of their points
+static uint16_t led_distance(Point a, Point b) {
+    int16_t dx = a.x - b.x;
+    int16_t dy = a.y - b.y;
+    return sqrt_fixed((int32_t)dx * dx + (int32_t)dy * dy);
+}
+
+void rgb_matrix_dual_beacon(uint8_t led_min, uint8_t led_max) {
     HSV hsv = { .h = rgb_matrix_config.hue, .s = rgb_matrix_config.sat, .v = rgb_matrix_config.val };
     RGB rgb;
     rgb_led led;
-    for (uint8_t i = 0; i < DRIVER_LED_TOTAL; i++) {
+    // A turn takes 256 ticks
+    int16_t cos_tick = cos_fixed(g_tick);
+    int16_t sin_tick = sin_fixed(g_tick);
+    for (uint8_t i = led_min; i < led_max; i++) {
         led = g_rgb_leds[i];
-        hsv.h = ((led.point.y - 32.0)* cos(g_tick * PI / 128) / 32 + (led.point.x - 112.0) * sin(g_tick * PI / 128) / (112)) * (180) + rgb_matrix_config.hue;
+        int32_t y = ((int32_t)(led.point.y - 32) * cos_tick * 180) / 32;
+        int32_t x = ((int32_t)(led.point.x - 112) * sin_tick * 180) / 112;
+        hsv.h = ((x + y) >> 8) + rgb_matrix_config.hue;
         rgb = hsv_to_rgb( hsv );
         rgb_matrix_set_color( i, rgb.r, rgb.g, rgb.b );
     }
 }
 
-void rgb_matrix_rainbow_beacon(void) {
+void rgb_matrix_rainbow_beacon(uint8_t led_min, uint8_t led_max) {
     HSV hsv = { .h = rgb_matrix_config.hue, .s = rgb_matrix_config.sat, .v = rgb_matrix_config.val };
     RGB rgb;
     rgb_led led;
-    for (uint8_t i = 0; i < DRIVER_LED_TOTAL; i++) {
+    // 1.5 times the speed, in halves
+    int16_t scale = 3 * (rgb_matrix_config.speed == 0 ? 1 : rgb_matrix_config.speed);
+    int16_t cos_tick = cos_fixed(g_tick);
+    int16_t sin_tick = sin_fixed(g_tick);
+    for (uint8_t i = led_min; i < led_max; i++) {
         led = g_rgb_leds[i];
-        hsv.h = (1.5 * (rgb_matrix_config.speed == 0 ? 1 : rgb_matrix_config.speed)) * (led.point.y - 32.0)* cos(g_tick * PI / 128) + (1.5 * (rgb_matrix_config.speed == 0 ? 1 : rgb_matrix_config.speed)) * (led.point.x - 112.0) * sin(g_tick * PI / 128) + rgb_matrix_config.hue;
+        int32_t angle = (int32_t)(led.point.y - 32) * cos_tick + (int32_t)(led.point.x - 112) * sin_tick;
+        hsv.h = ((scale * angle) >> 9) + rgb_matrix_config.hue;
         rgb = hsv_to_rgb( hsv );
         rgb_matrix_set_color( i, rgb.r, rgb.g, rgb.b );
     }
 }
 
-void rgb_matrix_rainbow_pinwheels(void) {
+void rgb_matrix_rainbow_pinwheels(uint8_t led_min, uint8_t led_max) {
     HSV hsv = { .h = rgb_matrix_config.hue, .s = rgb_matrix_config.sat, .v = rgb_matrix_config.val };
     RGB rgb;
     rgb_led led;
-    for (uint8_t i = 0; i < DRIVER_LED_TOTAL; i++) {
+    int16_t scale = 2 * (rgb_matrix_config.speed == 0 ? 1 : rgb_matrix_config.speed);
+    int16_t cos_tick = cos_fixed(g_tick);
+    int16_t sin_tick = sin_fixed(g_tick);
+    for (uint8_t i = led_min; i < led_max; i++) {
         led = g_rgb_leds[i];
-        hsv.h = (2 * (rgb_matrix_config.speed == 0 ? 1 : rgb_matrix_config.speed)) * (led.point.y - 32.0)* cos(g_tick * PI / 128) + (2 * (rgb_matrix_config.speed == 0 ? 1 : rgb_matrix_config.speed)) * (66 - abs(led.point.x - 112.0)) * sin(g_tick * PI / 128) + rgb_matrix_config.hue;
+        int32_t angle = (int32_t)(led.point.y - 32) * cos_tick + (int32_t)(66 - abs(led.point.x - 112)) * sin_tick;
+        hsv.h = ((scale * angle) >> 8) + rgb_matrix_config.hue;
         rgb = hsv_to_rgb( hsv );
         rgb_matrix_set_color( i, rgb.r, rgb.g, rgb.b );
     }
 }
 
-void rgb_matrix_rainbow_moving_chevron(void) {
+void rgb_matrix_rainbow_moving_chevron(uint8_t led_min, uint8_t led_max) {
     HSV hsv = { .h = rgb_matrix_config.hue, .s = rgb_matrix_config.sat, .v = rgb_matrix_config.val };
     RGB rgb;
     rgb_led led;
-    for (uint8_t i = 0; i < DRIVER_LED_TOTAL; i++) {
+    int16_t scale = 3 * (rgb_matrix_config.speed == 0 ? 1 : rgb_matrix_config.speed);
+    // uint8_t r = g_tick;
+    uint8_t r = 32;
+    int16_t sin_r = sin_fixed(r);
+    int16_t cos_r = cos_fixed(r);
+    // The chevron crosses the 224 points of the board every 256 ticks. The hue
+    // that moves it is kept as a 16 bit phase, in 1/256 of the hue, which
+    // wraps exactly when the hue does, so the colors never jump.
+    uint16_t phase_per_tick = ((int32_t)scale * cos_r * 224) >> 9;
+    uint16_t phase = g_tick * phase_per_tick;
+    for (uint8_t i = led_min; i < led_max; i++) {
         led = g_rgb_leds[i];
-        // uint8_t r = g_tick;
-        uint8_t r = 32;
-        hsv.h = (1.5 * (rgb_matrix_config.speed == 0 ? 1 : rgb_matrix_config.speed)) * abs(led.point.y - 32.0)* sin(r * PI / 128) + (1.5 * (rgb_matrix_config.speed == 0 ? 1 : rgb_matrix_config.speed)) * (led.point.x - (g_tick / 256.0 * 224)) * cos(r * PI / 128) + rgb_matrix_config.hue;
+        int32_t angle = (int32_t)abs(led.point.y - 32) * sin_r + (int32_t)led.point.x * cos_r;
+        hsv.h = ((scale * angle) >> 9) - (phase >> 8) + rgb_matrix_config.hue;
         rgb = hsv_to_rgb( hsv );
         rgb_matrix_set_color( i, rgb.r, rgb.g, rgb.b );
     }
 }
 
 
-void rgb_matrix_jellybean_raindrops( bool initialize ) {
+void rgb_matrix_jellybean_raindrops( bool initialize, uint8_t led_min, uint8_t led_max ) {
     HSV hsv;
     RGB rgb;
 
     // Change one LED every tick, make sure speed is not 0
-    uint8_t led_to_change = ( g_tick & ( 0x0A / (rgb_matrix_config.speed == 0 ? 1 : rgb_matrix_config.speed) ) ) == 0 ? rand() % (DRIVER_LED_TOTAL) : 255;
+    // The frame can be split in several calls, pick the LED in the first one
+    static uint8_t led_to_change = 255;
+    if ( led_min == 0 ) {
+        led_to_change = ( g_tick & ( 0x0A / (rgb_matrix_config.speed == 0 ? 1 : rgb_matrix_config.speed) ) ) == 0 ? rand() % (DRIVER_LED_TOTAL) : 255;
+    }
 
-    for ( int i=0; i<DRIVER_LED_TOTAL; i++ )
+    for ( int i=led_min; i<led_max; i++ )
     {
         // If initialize, all get set to random colors
         // If not, all but one will stay the same as before.
@@ -492,19 +606,19 @@ void rgb_matrix_jellybean_raindrops( bool initialize ) {
     }
 }
 
-void rgb_matrix_multisplash(void) {
+void rgb_matrix_multisplash(uint8_t led_min, uint8_t led_max) {
     // if (g_any_key_hit < 0xFF) {
         HSV hsv = { .h = rgb_matrix_config.hue, .s = rgb_matrix_config.sat, .v = rgb_matrix_config.val };
         RGB rgb;
         rgb_led led;
-        for (uint8_t i = 0; i < DRIVER_LED_TOTAL; i++) {
+        for (uint8_t i = led_min; i < led_max; i++) {
             led = g_rgb_leds[i];
             uint16_t c = 0, d = 0;
             rgb_led last_led;
             // if (g_last_led_count) {
                 for (uint8_t last_i = 0; last_i < g_last_led_count; last_i++) {
                     last_led = g_rgb_leds[g_last_led_hit[last_i]];
-                    uint16_t dist = (uint16_t)sqrt(pow(led.point.x - last_led.point.x, 2) + pow(led.point.y - last_led.point.y, 2));
+                    uint16_t dist = led_distance(led.point, last_led.point);
                     uint16_t effect = (g_key_hit[g_last_led_hit[last_i]] << 2) - dist;
                     c += MIN(MAX(effect, 0), 255);
                     d += 255 - MIN(MAX(effect, 0), 255);
@@ -523,25 +637,25 @@ void rgb_matrix_multisplash(void) {
 }
 
 
-void rgb_matrix_splash(void) {
+void rgb_matrix_splash(uint8_t led_min, uint8_t led_max) {
     g_last_led_count = MIN(g_last_led_count, 1);
-    rgb_matrix_multisplash();
+    rgb_matrix_multisplash(led_min, led_max);
 }
 
 
-void rgb_matrix_solid_multisplash(void) {
+void rgb_matrix_solid_multisplash(uint8_t led_min, uint8_t led_max) {
     // if (g_any_key_hit < 0xFF) {
         HSV hsv = { .h = rgb_matrix_config.hue, .s = rgb_matrix_config.sat, .v = rgb_matrix_config.val };
         RGB rgb;
         rgb_led led;
-        for (uint8_t i = 0; i < DRIVER_LED_TOTAL; i++) {
+        for (uint8_t i = led_min; i < led_max; i++) {
             led = g_rgb_leds[i];
             uint16_t d = 0;
             rgb_led last_led;
             // if (g_last_led_count) {
                 for (uint8_t last_i = 0; last_i < g_last_led_count; last_i++) {
                     last_led = g_rgb_leds[g_last_led_hit[last_i]];
-                    uint16_t dist = (uint16_t)sqrt(pow(led.point.x - last_led.point.x, 2) + pow(led.point.y - last_led.point.y, 2));
+                    uint16_t dist = led_distance(led.point, last_led.point);
                     uint16_t effect = (g_key_hit[g_last_led_hit[last_i]] << 2) - dist;
                     d += 255 - MIN(MAX(effect, 0), 255);
                 }
@@ -558,9 +672,9 @@ void rgb_matrix_solid_multisplash(void) {
 }
 
 
-void rgb_matrix_solid_splash(void) {
+void rgb_matrix_solid_splash(uint8_t led_min, uint8_t led_max) {
     g_last_led_count = MIN(g_last_led_count, 1);
-    rgb_matrix_solid_multisplash();
+    rgb_matrix_solid_multisplash(led_min, led_max);
 }
 
 
@@ -579,21 +693,25 @@ void rgb_matrix_custom(void) {
 //     }
 }
 
-void rgb_matrix_task(void) {
-    static uint8_t toggle_enable_last = 255;
-	if (!rgb_matrix_config.enable) {
-    	rgb_matrix_all_off();
-        toggle_enable_last = rgb_matrix_config.enable;
-    	return;
-    }
-    // delay 1 second before driving LEDs or doing anything else
-    static uint8_t startup_tick = 0;
-    if ( startup_tick < 20 ) {
-        startup_tick++;
-        return;
-    }
-
-    g_tick++;
+// The state of the frame being rendered
+enum rgb_matrix_render_state {
+    RENDER_IDLE,    // waiting for the next frame
+    RENDER_EFFECT,  // computing the LEDs, RGB_MATRIX_LED_PROCESS_LIMIT at a time
+    RENDER_FLUSH,   // sending the frame to the LED drivers
+};
+
+static uint8_t g_render_state = RENDER_IDLE;
+static uint8_t g_render_led = 0;
+static uint8_t g_render_effect = 0;
+static bool g_render_initialize = false;
+static bool g_render_indicators = false;
+static uint32_t g_frame_timer = 0;
+// Also updated while disabled, so that enabling again initializes the effect
+static uint8_t toggle_enable_last = 255;
+
+// Starts a new frame, everything that is done once per frame
+static void rgb_matrix_start_frame(void) {
+    static uint8_t effect_last = 255;
 
     if ( g_any_key_hit < 0xFFFFFFFF ) {
         g_any_key_hit++;
@@ -607,92 +725,149 @@ void rgb_matrix_task(void) {
         }
     }
 
-    // Factory default magic value
-    if ( rgb_matrix_config.mode == 255 ) {
-        rgb_matrix_test();
-        return;
-    }
-
     // Ideally we would also stop sending zeros to the LED driver PWM buffers
     // while suspended and just do a software shutdown. This is a cheap hack for now.
     bool suspend_backlight = ((g_suspend_state && RGB_DISABLE_WHEN_USB_SUSPENDED) ||
-            (RGB_DISABLE_AFTER_TIMEOUT > 0 && g_any_key_hit > RGB_DISABLE_AFTER_TIMEOUT * 60 * 20));
+            (RGB_DISABLE_AFTER_TIMEOUT > 0 && g_any_key_hit > (uint32_t)RGB_DISABLE_AFTER_TIMEOUT * 60 * RGB_MATRIX_FRAMES_PER_SECOND));
     uint8_t effect = suspend_backlight ? 0 : rgb_matrix_config.mode;
 
     // Keep track of the effect used last time,
     // detect change in effect, so each effect can
     // have an optional initialization.
-    static uint8_t effect_last = 255;
-    bool initialize = (effect != effect_last) || (rgb_matrix_config.enable != toggle_enable_last);
+    g_render_initialize = (effect != effect_last) || (rgb_matrix_config.enable != toggle_enable_last);
     effect_last = effect;
     toggle_enable_last = rgb_matrix_config.enable;
 
-    // this gets ticked at 20 Hz.
-    // each effect can opt to do calculations
-    // and/or request PWM buffer updates.
-    switch ( effect ) {
+    g_render_effect = effect;
+    g_render_indicators = !suspend_backlight;
+}
+
+// Computes the LEDs from led_min up to led_max of the current frame
+static void rgb_matrix_render(uint8_t led_min, uint8_t led_max) {
+    bool initialize = g_render_initialize;
+
+    // The effects that set all LEDs at once are done in the first call
+    switch ( g_render_effect ) {
         case RGB_MATRIX_SOLID_COLOR:
-            rgb_matrix_solid_color();
+            if ( led_min == 0 ) {
+                rgb_matrix_solid_color();
+            }
             break;
         case RGB_MATRIX_ALPHAS_MODS:
-            rgb_matrix_alphas_mods();
+            rgb_matrix_alphas_mods(led_min, led_max);
             break;
         case RGB_MATRIX_DUAL_BEACON:
-            rgb_matrix_dual_beacon();
+            rgb_matrix_dual_beacon(led_min, led_max);
             break;
         case RGB_MATRIX_GRADIENT_UP_DOWN:
-            rgb_matrix_gradient_up_down();
+            rgb_matrix_gradient_up_down(led_min, led_max);
             break;
         case RGB_MATRIX_RAINDROPS:
-            rgb_matrix_raindrops( initialize );
+            rgb_matrix_raindrops( initialize, led_min, led_max );
             break;
         case RGB_MATRIX_CYCLE_ALL:
-            rgb_matrix_cycle_all();
+            rgb_matrix_cycle_all(led_min, led_max);
             break;
         case RGB_MATRIX_CYCLE_LEFT_RIGHT:
-            rgb_matrix_cycle_left_right();
+            rgb_matrix_cycle_left_right(led_min, led_max);
             break;
         case RGB_MATRIX_CYCLE_UP_DOWN:
-            rgb_matrix_cycle_up_down();
+            rgb_matrix_cycle_up_down(led_min, led_max);
             break;
         case RGB_MATRIX_RAINBOW_BEACON:
-            rgb_matrix_rainbow_beacon();
+            rgb_matrix_rainbow_beacon(led_min, led_max);
             break;
         case RGB_MATRIX_RAINBOW_PINWHEELS:
-            rgb_matrix_rainbow_pinwheels();
+            rgb_matrix_rainbow_pinwheels(led_min, led_max);
             break;
         case RGB_MATRIX_RAINBOW_MOVING_CHEVRON:
-            rgb_matrix_rainbow_moving_chevron();
+            rgb_matrix_rainbow_moving_chevron(led_min, led_max);
             break;
         case RGB_MATRIX_JELLYBEAN_RAINDROPS:
-            rgb_matrix_jellybean_raindrops( initialize );
+            rgb_matrix_jellybean_raindrops( initialize, led_min, led_max );
             break;
         #ifdef RGB_MATRIX_KEYPRESSES
             case RGB_MATRIX_SOLID_REACTIVE:
-                rgb_matrix_solid_reactive();
+                rgb_matrix_solid_reactive(led_min, led_max);
                 break;
             case RGB_MATRIX_SPLASH:
-                rgb_matrix_splash();
+                rgb_matrix_splash(led_min, led_max);
                 break;
             case RGB_MATRIX_MULTISPLASH:
-                rgb_matrix_multisplash();
+                rgb_matrix_multisplash(led_min, led_max);
                 break;
             case RGB_MATRIX_SOLID_SPLASH:
-                rgb_matrix_solid_splash();
+                rgb_matrix_solid_splash(led_min, led_max);
                 break;
             case RGB_MATRIX_SOLID_MULTISPLASH:
-                rgb_matrix_solid_multisplash();
+                rgb_matrix_solid_multisplash(led_min, led_max);
                 break;
         #endif
         default:
-            rgb_matrix_custom();
+            if ( led_min == 0 ) {
+                rgb_matrix_custom();
+            }
             break;
     }
+}
 
-    if ( ! suspend_backlight ) {
-        rgb_matrix_indicators();
-    }
+// Each call does one step of the current frame, so that the lighting adds
+// a bounded amount of time to any single scan. A new frame starts every
+// RGB_MATRIX_FRAME_MS, no matter how fast the matrix is scanned.
+void rgb_matrix_task(void) {
+    static uint16_t startup_frames = 0;
+
+    switch ( g_render_state ) {
+        case RENDER_IDLE:
+            if ( timer_elapsed32(g_frame_timer) < RGB_MATRIX_FRAME_MS ) {
+                return;
+            }
+            g_frame_timer = timer_read32();
+
+            if (!rgb_matrix_config.enable) {
+                toggle_enable_last = rgb_matrix_config.enable;
+                rgb_matrix_all_off();
+                g_render_state = RENDER_FLUSH;
+                return;
+            }
+            // delay 1 second before driving LEDs or doing anything else
+            if ( startup_frames < RGB_MATRIX_FRAMES_PER_SECOND ) {
+                startup_frames++;
+                return;
+            }
+
+            g_tick++;
+
+            // Factory default magic value
+            if ( rgb_matrix_config.mode == 255 ) {
+                rgb_matrix_test();
+                g_render_state = RENDER_FLUSH;
+                return;
+            }
 
+            rgb_matrix_start_frame();
+            g_render_led = 0;
+            g_render_state = RENDER_EFFECT;
+            break;
+
+        case RENDER_EFFECT: {
+            uint8_t led_max = MIN(g_render_led + RGB_MATRIX_LED_PROCESS_LIMIT, DRIVER_LED_TOTAL);
+            rgb_matrix_render(g_render_led, led_max);
+            g_render_led = led_max;
+            if ( g_render_led >= DRIVER_LED_TOTAL ) {
+                if ( g_render_indicators ) {
+                    rgb_matrix_indicators();
+                }
+                g_render_state = RENDER_FLUSH;
+            }
+            break;
+        }
+
+        case RENDER_FLUSH:
+            rgb_matrix_update_pwm_buffers();
+            g_render_state = RENDER_IDLE;
+            break;
+    }
 }
 
 void rgb_matrix_indicators(void) {
@@ -726,6 +901,7 @@ void rgb_matrix_indicators_user(void) {}
 
 void rgb_matrix_init(void) {
   rgb_matrix_setup_drivers();
+  rgb_matrix_init_led_index();
 
   // TODO: put the 1 second startup delay here?
 
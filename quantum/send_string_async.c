@@ -0,0 +1,183 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "quantum.h"
+#include "send_string_async.h"
+
+#ifndef SEND_STRING_ASYNC_BUFFER_SIZE
+#   define SEND_STRING_ASYNC_BUFFER_SIZE 64
+#endif
+
+#if SEND_STRING_ASYNC_BUFFER_SIZE < 2 || SEND_STRING_ASYNC_BUFFER_SIZE > 255
+#   error "SEND_STRING_ASYNC_BUFFER_SIZE must be between 2 and 255"
+#endif
+
+/* The bytes waiting to be typed, in the SEND_STRING format */
+static char buffer[SEND_STRING_ASYNC_BUFFER_SIZE];
+static uint8_t buffer_head = 0;
+static uint8_t buffer_count = 0;
+/* The rest of a PROGMEM string, copied to the buffer when there's room */
+static const char *progmem_str = NULL;
+
+/* The key pressed by the last step, released by the next one */
+static uint8_t held_key = 0;
+/* Shift is kept down between shifted characters */
+static bool held_shift = false;
+
+static void buffer_push(char c) {
+    buffer[(buffer_head + buffer_count) % SEND_STRING_ASYNC_BUFFER_SIZE] = c;
+    buffer_count++;
+}
+
+static char buffer_peek(uint8_t offset) {
+    return buffer[(buffer_head + offset) % SEND_STRING_ASYNC_BUFFER_SIZE];
+}
+
+static void buffer_pop(uint8_t count) {
+    buffer_head = (buffer_head + count) % SEND_STRING_ASYNC_BUFFER_SIZE;
+    buffer_count -= count;
+}
+
+static void buffer_fill_progmem(void) {
+    while (progmem_str && buffer_count < SEND_STRING_ASYNC_BUFFER_SIZE) {
+        char c = pgm_read_byte(progmem_str);
+        if (c) {
+            buffer_push(c);
+            progmem_str++;
+        } else {
+            progmem_str = NULL;
+        }
+    }
+}
+
+/* Returns the keycode of the next character, and if it needs shift, or 0
+ * when the buffer starts with a tap, down or up code instead
+ */
+static uint8_t next_char_keycode(bool *shifted) {
+    uint8_t ascii_code = (uint8_t)buffer_peek(0);
+    if (ascii_code <= 3 || ascii_code >= 0x80) {
+        return 0;
+    }
+    *shifted = pgm_read_byte(&ascii_to_shift_lut[ascii_code]);
+    return pgm_read_byte(&ascii_to_keycode_lut[ascii_code]);
+}
+
+/* Types the next step, which changes the report once. The release of a key is
+ * combined with the press of the next one when they don't need shift changes,
+ * so most characters take a single report.
+ */
+static void send_string_async_step(void) {
+    bool shifted = false;
+    uint8_t keycode;
+
+    buffer_fill_progmem();
+    host_keyboard_begin();
+
+    if (held_key) {
+        unregister_code(held_key);
+        keycode = buffer_count ? next_char_keycode(&shifted) : 0;
+        if (keycode && keycode != held_key && shifted == held_shift) {
+            register_code(keycode);
+            buffer_pop(1);
+            held_key = keycode;
+        } else {
+            held_key = 0;
+            // shift can go with the key, unless the next character needs it
+            if (held_shift && !(keycode && shifted)) {
+                unregister_code(KC_LSFT);
+                held_shift = false;
+            }
+        }
+    } else if (buffer_count) {
+        uint8_t code = (uint8_t)buffer_peek(0);
+        keycode = next_char_keycode(&shifted);
+        if (held_shift && (code <= 3 || !shifted)) {
+            unregister_code(KC_LSFT);
+            held_shift = false;
+        } else if (code >= 1 && code <= 3) {
+            // tap, down or up, followed by the keycode
+            if (buffer_count < 2) {
+                // the string ended without a keycode
+                buffer_pop(1);
+            } else {
+                keycode = (uint8_t)buffer_peek(1);
+                buffer_pop(2);
+                if (code == 3) {
+                    unregister_code(keycode);
+                } else {
+                    register_code(keycode);
+                    if (code == 1) {
+                        held_key = keycode;
+                    }
+                }
+            }
+        } else if (!keycode) {
+            // nothing to type for this character
+            buffer_pop(1);
+        } else if (shifted && !held_shift) {
+            register_code(KC_LSFT);
+            held_shift = true;
+        } else {
+            register_code(keycode);
+            buffer_pop(1);
+            held_key = keycode;
+        }
+    } else if (held_shift) {
+        unregister_code(KC_LSFT);
+        held_shift = false;
+    }
+
+    host_keyboard_commit();
+}
+
+bool send_string_async_active(void) {
+    return buffer_count || progmem_str || held_key || held_shift;
+}
+
+void send_string_async_task(void) {
+    if (send_string_async_active() && host_keyboard_ready()) {
+        send_string_async_step();
+    }
+}
+
+void send_string_async_flush(void) {
+    while (send_string_async_active()) {
+        if (host_keyboard_ready()) {
+            send_string_async_step();
+        }
+    }
+}
+
+void send_string_async(const char *str) {
+    for (; *str; str++) {
+        while (progmem_str || buffer_count == SEND_STRING_ASYNC_BUFFER_SIZE) {
+            if (host_keyboard_ready()) {
+                send_string_async_step();
+            }
+        }
+        buffer_push(*str);
+    }
+}
+
+void send_string_async_P(const char *str) {
+    while (progmem_str) {
+        if (host_keyboard_ready()) {
+            send_string_async_step();
+        }
+    }
+    progmem_str = str;
+    buffer_fill_progmem();
+}
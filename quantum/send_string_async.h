@@ -0,0 +1,42 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEND_STRING_ASYNC_H
+#define SEND_STRING_ASYNC_H
+
+#include <stdbool.h>
+
+// Strings sent this way are typed from the scan loop, as fast as the host
+// accepts the reports, so the keyboard keeps scanning while they are typed.
+// They use the same format as SEND_STRING, and are typed in the order they
+// were sent. A synchronous send_string waits for them to be typed first.
+#define SEND_STRING_ASYNC(str) send_string_async_P(PSTR(str))
+
+// The string is copied, so it can be a temporary buffer. Only waits when
+// the buffer of SEND_STRING_ASYNC_BUFFER_SIZE bytes is full.
+void send_string_async(const char *str);
+// The string is read from PROGMEM while it's typed, so it can be of any
+// length. Waits when the previous PROGMEM string is still being typed.
+void send_string_async_P(const char *str);
+
+// Returns true while there is something left to type
+bool send_string_async_active(void);
+// Types everything that is left, waiting for the host
+void send_string_async_flush(void);
+// Types the next report, called from matrix_scan_quantum
+void send_string_async_task(void);
+
+#endif
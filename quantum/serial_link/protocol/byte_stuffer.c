@@ -102,41 +102,45 @@ void byte_stuffer_recv_byte(uint8_t link, uint8_t data) {
     }
 }
 
-static void send_block(uint8_t link, uint8_t* start, uint8_t* end, uint8_t num_non_zero) {
-    send_data(link, &num_non_zero, 1);
-    if (end > start) {
-        send_data(link, start, end-start);
-    }
-}
+// The worst case is a code byte for every 254 bytes of data, one at the
+// start, and the terminating zero
+#define MAX_ENCODED_FRAME_SIZE (MAX_FRAME_SIZE + MAX_FRAME_SIZE / 254 + 2)
+
+static uint8_t send_buffers[NUM_LINKS][MAX_ENCODED_FRAME_SIZE];
 
+// The frame is encoded in a single pass, the code byte of each block is
+// filled in when the block ends, and the whole frame is sent with a single
+// call to send_data
 void byte_stuffer_send_frame(uint8_t link, uint8_t* data, uint16_t size) {
-    const uint8_t zero = 0;
-    if (size > 0) {
-        uint16_t num_non_zero = 1;
-        uint8_t* end = data + size;
-        uint8_t* start = data;
-        while (data < end) {
-            if (num_non_zero == 0xFF) {
-                // There's more data after big non-zero block
-                // So send it, and start a new block
-                send_block(link, start, data, num_non_zero);
-                start = data;
-                num_non_zero = 1;
-            }
-            else {
-                if (*data == 0) {
-                    // A zero encountered, so send the block
-                    send_block(link, start, data, num_non_zero);
-                    start = data + 1;
-                    num_non_zero = 1;
-                }
-                else {
-                    num_non_zero++;
-                }
-                ++data;
-            }
+    if (size == 0 || size > MAX_FRAME_SIZE) {
+        return;
+    }
+    uint8_t* out = send_buffers[link];
+    uint8_t* code = out;
+    uint8_t* pos = out + 1;
+    uint8_t num_non_zero = 1;
+    uint8_t* end = data + size;
+    while (data < end) {
+        if (num_non_zero == 0xFF) {
+            // There's more data after big non-zero block
+            // So end it, and start a new block
+            *code = num_non_zero;
+            code = pos++;
+            num_non_zero = 1;
+        }
+        if (*data == 0) {
+            // A zero encountered, so end the block
+            *code = num_non_zero;
+            code = pos++;
+            num_non_zero = 1;
+        }
+        else {
+            *pos++ = *data;
+            num_non_zero++;
         }
-        send_block(link, start, data, num_non_zero);
-        send_data(link, &zero, 1);
+        ++data;
     }
+    *code = num_non_zero;
+    *pos++ = 0;
+    send_data(link, out, pos - out);
 }
@@ -27,8 +27,16 @@ SOFTWARE.
 
 #include <stdint.h>
 
+typedef struct {
+    // The frames with a correct CRC
+    uint32_t frames;
+    // The frames with an incorrect CRC, or too short to have one
+    uint32_t crc_errors;
+} validator_statistics_t;
+
 void validator_recv_frame(uint8_t link, uint8_t* data, uint16_t size);
 // The buffer pointed to by the data needs 4 additional bytes
 void validator_send_frame(uint8_t link, uint8_t* data, uint16_t size);
+const validator_statistics_t* validator_get_statistics(uint8_t link);
 
 #endif
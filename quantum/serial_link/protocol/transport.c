@@ -30,15 +30,120 @@ SOFTWARE.
 #define MAX_REMOTE_OBJECTS 16
 static remote_object_t* remote_objects[MAX_REMOTE_OBJECTS];
 static uint32_t num_remote_objects = 0;
+static transport_statistics_t statistics;
+
+#ifdef SERIAL_LINK_RELIABLE
+#include "timer.h"
+
+// Each frame carries a sequence number before the object id. The receiver
+// acknowledges it, and the sender sends the object again until every
+// destination has acknowledged it. Only the latest value of an object is
+// sent again, the older ones are no longer interesting.
+//
+// The acknowledgements are frames with ACK_ID as the object id. They start
+// with a bitmap of the acknowledged objects, followed by the sequence number
+// of each of them.
+//
+// The sequence numbers start again from 1 when a half restarts, while the
+// other halves still have the ones from before. So until a peer has
+// acknowledged a frame of the object since the start, the frames are marked
+// with SEQ_RESTART, and the peer takes them even when the number is the one
+// it has. A frame sent again before that acknowledgement can be written
+// twice, but none is lost.
+//
+// The round trip grows with the number of slaves in the chain and shrinks
+// with the link rate, so a fixed timeout sends again frames that were never
+// lost. Instead the objects are sent again after twice the measured round
+// trip, and never sooner than SERIAL_LINK_RETRANSMIT_TIMEOUT. The estimate
+// follows a longer round trip at once, and a shorter one slowly, so the
+// farthest peer keeps it up. The frames sent again aren't measured, so each
+// time one is sent again the timeout doubles, up to MAX_RETRANSMIT_TIMEOUT,
+// until a frame is acknowledged without it. That way a chain longer than the
+// first timeout still gets measured.
+#define FRAME_TRAILER_SIZE 2
+#define ACK_ID 0xFF
+#define SEQ_RESTART 0x80
+#define SEQ_MAX 0x7F
+#define MAX_RETRANSMIT_TIMEOUT (16 * SERIAL_LINK_RETRANSMIT_TIMEOUT)
+
+// One for each local buffer, MASTER_TO_SINGLE_SLAVE objects have one for each
+// slave
+#define MAX_LOCAL_OBJECTS 32
+#define NO_SEND_STATE 0xFF
+
+typedef struct {
+    // The last frame, kept in the read buffer of the triple buffer
+    uint8_t* data;
+    uint16_t sent_time;
+    uint8_t seq;
+    // The peers that haven't acknowledged the frame yet
+    uint8_t unacked;
+    // The peers that have acknowledged a frame since the start
+    uint8_t synced;
+    bool retransmitted;
+} send_state_t;
+
+static send_state_t send_states[MAX_LOCAL_OBJECTS];
+static uint8_t first_send_state[MAX_REMOTE_OBJECTS];
+static uint8_t num_send_states = 0;
+
+// The peers are the halves this one receives from, the master for a slave,
+// and the slaves for the master, in the order they are connected
+static uint8_t known_peers = 0;
+static uint8_t recv_seq[NUM_SLAVES][MAX_REMOTE_OBJECTS];
+static uint16_t pending_acks[NUM_SLAVES];
+static uint8_t ack_destinations[NUM_SLAVES];
+static uint8_t ack_buffer[2 + MAX_REMOTE_OBJECTS + 1 + LOCAL_OBJECT_EXTRA];
+static uint16_t round_trip_estimate = 0;
+static uint16_t retransmit_timeout = SERIAL_LINK_RETRANSMIT_TIMEOUT;
+
+static void update_retransmit_timeout(uint16_t rtt) {
+    if (rtt > round_trip_estimate) {
+        round_trip_estimate = rtt;
+    }
+    else {
+        round_trip_estimate -= (round_trip_estimate - rtt) / 8;
+    }
+    uint16_t timeout = 2 * round_trip_estimate;
+    retransmit_timeout = timeout > SERIAL_LINK_RETRANSMIT_TIMEOUT ? timeout : SERIAL_LINK_RETRANSMIT_TIMEOUT;
+}
+#else
+#define FRAME_TRAILER_SIZE 1
+#endif
 
 void reinitialize_serial_link_transport(void) {
     num_remote_objects = 0;
+    memset(&statistics, 0, sizeof(statistics));
+#ifdef SERIAL_LINK_RELIABLE
+    num_send_states = 0;
+    known_peers = 0;
+    memset(send_states, 0, sizeof(send_states));
+    memset(recv_seq, 0, sizeof(recv_seq));
+    memset(pending_acks, 0, sizeof(pending_acks));
+    round_trip_estimate = 0;
+    retransmit_timeout = SERIAL_LINK_RETRANSMIT_TIMEOUT;
+#endif
+}
+
+const transport_statistics_t* transport_get_statistics(void) {
+    return &statistics;
 }
 
 void add_remote_objects(remote_object_t** _remote_objects, uint32_t _num_remote_objects) {
     unsigned int i;
     for(i=0;i<_num_remote_objects;i++) {
         remote_object_t* obj = _remote_objects[i];
+#ifdef SERIAL_LINK_RELIABLE
+        uint8_t num_local = obj->object_type == MASTER_TO_SINGLE_SLAVE ? NUM_SLAVES : 1;
+        if (num_send_states + num_local <= MAX_LOCAL_OBJECTS) {
+            first_send_state[num_remote_objects] = num_send_states;
+            num_send_states += num_local;
+        }
+        else {
+            // Sent without retransmissions
+            first_send_state[num_remote_objects] = NO_SEND_STATE;
+        }
+#endif
         remote_objects[num_remote_objects++] = obj;
         if (obj->object_type == MASTER_TO_ALL_SLAVES) {
             triple_buffer_object_t* tb = (triple_buffer_object_t*)obj->buffer;
@@ -73,11 +178,118 @@ void add_remote_objects(remote_object_t** _remote_objects, uint32_t _num_remote_
     }
 }
 
+#ifdef SERIAL_LINK_RELIABLE
+// The peers that have to acknowledge a frame sent to destination
+static uint8_t destination_peers(uint8_t destination) {
+    if (destination == 0) {
+        // The master
+        return 1;
+    }
+    else if (destination == 0xFF) {
+        // Every slave that has been heard from, or at least the first one
+        return known_peers ? known_peers : 1;
+    }
+    else {
+        return destination;
+    }
+}
+
+static void recv_ack(uint8_t peer, uint8_t* data, uint16_t size) {
+    if (size < 2) {
+        return;
+    }
+    uint16_t objects = data[0] | (data[1] << 8);
+    uint8_t* seq = data + 2;
+    uint8_t* end = data + size;
+    unsigned int id;
+    for (id=0;id<num_remote_objects && seq < end;id++) {
+        if (!(objects & (1 << id))) {
+            continue;
+        }
+        if (first_send_state[id] != NO_SEND_STATE) {
+            remote_object_t* obj = remote_objects[id];
+            uint8_t num_local = obj->object_type == MASTER_TO_SINGLE_SLAVE ? NUM_SLAVES : 1;
+            send_state_t* state = &send_states[first_send_state[id]];
+            unsigned int j;
+            for (j=0;j<num_local;j++, state++) {
+                if (state->seq == *seq && (state->unacked & (1 << peer))) {
+                    state->unacked &= ~(1 << peer);
+                    state->synced |= 1 << peer;
+                    // The time is only known when the frame was sent once
+                    if (!state->unacked && !state->retransmitted) {
+                        uint16_t rtt = timer_elapsed(state->sent_time);
+                        statistics.round_trip_time = rtt;
+                        if (rtt > statistics.max_round_trip_time) {
+                            statistics.max_round_trip_time = rtt;
+                        }
+                        update_retransmit_timeout(rtt);
+                    }
+                }
+            }
+        }
+        seq++;
+    }
+}
+
+static void send_acks(void) {
+    unsigned int peer;
+    for (peer=0;peer<NUM_SLAVES;peer++) {
+        uint16_t objects = pending_acks[peer];
+        if (!objects) {
+            continue;
+        }
+        pending_acks[peer] = 0;
+        uint8_t* pos = ack_buffer;
+        *pos++ = objects & 0xFF;
+        *pos++ = objects >> 8;
+        unsigned int id;
+        for (id=0;id<num_remote_objects;id++) {
+            if (objects & (1 << id)) {
+                *pos++ = recv_seq[peer][id];
+            }
+        }
+        *pos++ = ACK_ID;
+        router_send_frame(ack_destinations[peer], ack_buffer, pos - ack_buffer);
+    }
+}
+#endif
+
 void transport_recv_frame(uint8_t from, uint8_t* data, uint16_t size) {
+    if (size < FRAME_TRAILER_SIZE || from > NUM_SLAVES) {
+        return;
+    }
     uint8_t id = data[size-1];
+#ifdef SERIAL_LINK_RELIABLE
+    uint8_t peer = from ? from - 1 : 0;
+    if (from) {
+        known_peers |= 1 << peer;
+    }
+    if (id == ACK_ID) {
+        recv_ack(peer, data, size - 1);
+        return;
+    }
+#endif
     if (id < num_remote_objects) {
         remote_object_t* obj = remote_objects[id];
-        if (obj->object_size == size - 1) {
+        // The objects from the slaves have to come through at least one hop
+        bool valid_source = from != 0 || obj->object_type != SLAVE_TO_MASTER;
+        if (obj->object_size == size - FRAME_TRAILER_SIZE && valid_source) {
+            statistics.frames_received++;
+#ifdef SERIAL_LINK_RELIABLE
+            uint8_t seq = data[size-2] & ~SEQ_RESTART;
+            bool restart = data[size-2] & SEQ_RESTART;
+            // Acknowledge duplicates too, the previous acknowledgement could
+            // have been lost
+            pending_acks[peer] |= 1 << id;
+            ack_destinations[peer] = from ? 1 << peer : 0;
+            if (seq != 0) {
+                if (seq == recv_seq[peer][id] && !restart) {
+                    statistics.duplicates++;
+                    return;
+                }
+                recv_seq[peer][id] = seq;
+            }
+#endif
             uint8_t* start;
             if (obj->object_type == MASTER_TO_ALL_SLAVES) {
                 start = obj->buffer + LOCAL_OBJECT_SIZE(obj->object_size);
@@ -91,38 +303,73 @@ void transport_recv_frame(uint8_t from, uint8_t* data, uint16_t size) {
             }
             triple_buffer_object_t* tb = (triple_buffer_object_t*)start;
             void* ptr = triple_buffer_begin_write_internal(obj->object_size, tb);
-            memcpy(ptr, data, size - 1);
+            memcpy(ptr, data, obj->object_size);
             triple_buffer_end_write_internal(tb);
         }
     }
 }
 
+// Sends the new value of a local object, or sends the last one again when it
+// wasn't acknowledged in time. local is the index of the buffer, the slave
+// for MASTER_TO_SINGLE_SLAVE objects.
+static void update_local_object(uint8_t id, uint8_t local, uint8_t destination) {
+    remote_object_t* obj = remote_objects[id];
+    uint8_t* start = obj->buffer + local * LOCAL_OBJECT_SIZE(obj->object_size);
+    triple_buffer_object_t* tb = (triple_buffer_object_t*)start;
+    uint8_t* ptr = (uint8_t*)triple_buffer_read_internal(obj->object_size + LOCAL_OBJECT_EXTRA, tb);
+#ifdef SERIAL_LINK_RELIABLE
+    uint8_t seq = 0;
+    if (first_send_state[id] != NO_SEND_STATE) {
+        send_state_t* state = &send_states[first_send_state[id] + local];
+        if (ptr) {
+            state->data = ptr;
+            // 0 is for the objects sent without retransmissions
+            state->seq = state->seq == SEQ_MAX ? 1 : state->seq + 1;
+            state->unacked = destination_peers(destination);
+            state->retransmitted = false;
+            state->sent_time = timer_read();
+        }
+        else if (state->unacked && timer_elapsed(state->sent_time) >= retransmit_timeout) {
+            ptr = state->data;
+            state->retransmitted = true;
+            state->sent_time = timer_read();
+            statistics.retransmits++;
+            if (retransmit_timeout < MAX_RETRANSMIT_TIMEOUT) {
+                retransmit_timeout *= 2;
+            }
+        }
+        seq = state->seq;
+        if (destination_peers(destination) & ~state->synced) {
+            seq |= SEQ_RESTART;
+        }
+    }
+    if (ptr) {
+        ptr[obj->object_size] = seq;
+    }
+#endif
+    if (ptr) {
+        ptr[obj->object_size + FRAME_TRAILER_SIZE - 1] = id;
+        router_send_frame(destination, ptr, obj->object_size + FRAME_TRAILER_SIZE);
+        statistics.frames_sent++;
+    }
+}
+
 void update_transport(void) {
     unsigned int i;
     for(i=0;i<num_remote_objects;i++) {
         remote_object_t* obj = remote_objects[i];
         if (obj->object_type == MASTER_TO_ALL_SLAVES || obj->object_type == SLAVE_TO_MASTER) {
-            triple_buffer_object_t* tb = (triple_buffer_object_t*)obj->buffer;
-            uint8_t* ptr = (uint8_t*)triple_buffer_read_internal(obj->object_size + LOCAL_OBJECT_EXTRA, tb);
-            if (ptr) {
-                ptr[obj->object_size] = i;
-                uint8_t dest = obj->object_type == MASTER_TO_ALL_SLAVES ? 0xFF : 0;
-                router_send_frame(dest, ptr, obj->object_size + 1);
-            }
+            uint8_t dest = obj->object_type == MASTER_TO_ALL_SLAVES ? 0xFF : 0;
+            update_local_object(i, 0, dest);
         }
         else {
-            uint8_t* start = obj->buffer;
             unsigned int j;
             for (j=0;j<NUM_SLAVES;j++) {
-                triple_buffer_object_t* tb = (triple_buffer_object_t*)start;
-                uint8_t* ptr = (uint8_t*)triple_buffer_read_internal(obj->object_size + LOCAL_OBJECT_EXTRA, tb);
-                if (ptr) {
-                    ptr[obj->object_size] = i;
-                    uint8_t dest = j + 1;
-                    router_send_frame(dest, ptr, obj->object_size + 1);
-                }
-                start += LOCAL_OBJECT_SIZE(obj->object_size);
+                update_local_object(i, j, j + 1);
             }
         }
     }
+#ifdef SERIAL_LINK_RELIABLE
+    send_acks();
+#endif
 }
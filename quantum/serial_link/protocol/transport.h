@@ -31,6 +31,15 @@ SOFTWARE.
 #define NUM_SLAVES 8
 #define LOCAL_OBJECT_EXTRA 16
 
+// Define SERIAL_LINK_RELIABLE to have the objects acknowledged, and sent
+// again when the acknowledgement doesn't arrive in time. All the halves have
+// to be built with the same setting. The objects are sent again after twice
+// the measured round trip, SERIAL_LINK_RETRANSMIT_TIMEOUT is the shortest
+// timeout in milliseconds, and the one used before the first measurement.
+#ifndef SERIAL_LINK_RETRANSMIT_TIMEOUT
+#define SERIAL_LINK_RETRANSMIT_TIMEOUT 10
+#endif
+
 // master -> slave = 1 local(target all), 1 remote object
 // slave -> master = 1 local(target 0), multiple remote objects
 // master -> single slave (multiple local, target id), 1 remote object
@@ -43,7 +52,7 @@ typedef enum {
 typedef struct {
     remote_object_type object_type;
     uint16_t object_size;
-    uint8_t buffer[] __attribute__((aligned(4)));
+    uint8_t buffer[0] __attribute__((aligned(4)));
 } remote_object_t;
 
 #define REMOTE_OBJECT_SIZE(objectsize) \
@@ -144,9 +153,23 @@ typedef struct { \
 
 #define REMOTE_OBJECT(name) (remote_object_t*)&remote_object_##name
 
+typedef struct {
+    // Including the ones sent again
+    uint32_t frames_sent;
+    // Including the duplicates
+    uint32_t frames_received;
+    uint32_t retransmits;
+    uint32_t duplicates;
+    // Milliseconds between sending an object and the last acknowledgement,
+    // only measured for the ones that weren't sent again
+    uint16_t round_trip_time;
+    uint16_t max_round_trip_time;
+} transport_statistics_t;
+
 void add_remote_objects(remote_object_t** remote_objects, uint32_t num_remote_objects);
 void reinitialize_serial_link_transport(void);
 void transport_recv_frame(uint8_t from, uint8_t* data, uint16_t size);
 void update_transport(void);
+const transport_statistics_t* transport_get_statistics(void);
 
 #endif
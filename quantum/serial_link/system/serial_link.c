@@ -28,6 +28,7 @@ SOFTWARE.
 #include "serial_link/protocol/byte_stuffer.h"
 #include "serial_link/protocol/transport.h"
 #include "serial_link/protocol/frame_router.h"
+#include "serial_link/protocol/frame_validator.h"
 #include "matrix.h"
 #include <stdbool.h>
 #include "print.h"
@@ -60,6 +61,13 @@ host_driver_t serial_driver = {
 #error "Serial link thread priority not set"
 #endif
 
+#ifdef SERIAL_LINK_RELIABLE
+// Wake up in time to send again the objects that weren't acknowledged
+#define SERIAL_LINK_WAIT_TIMEOUT MS2ST(SERIAL_LINK_RETRANSMIT_TIMEOUT)
+#else
+#define SERIAL_LINK_WAIT_TIMEOUT MS2ST(1000)
+#endif
+
 static SerialConfig config = {
     .sc_speed = SERIAL_LINK_BAUD
 };
@@ -137,7 +145,7 @@ static THD_FUNCTION(serialThread, arg) {
         eventflags_t flags1 = 0;
         eventflags_t flags2 = 0;
         if (need_wait) {
-            eventmask_t mask = chEvtWaitAnyTimeout(ALL_EVENTS, MS2ST(1000));
+            eventmask_t mask = chEvtWaitAnyTimeout(ALL_EVENTS, SERIAL_LINK_WAIT_TIMEOUT);
             if (mask & EVENT_MASK(1)) {
                 flags1 = chEvtGetAndClearFlags(&sd1_listener);
                 print_error("DOWNLINK", flags1, &SD1);
@@ -238,6 +246,24 @@ bool is_serial_link_connected(void) {
     return serial_link_connected;
 }
 
+void serial_link_print_statistics(void) {
+    const transport_statistics_t* transport = transport_get_statistics();
+    const validator_statistics_t* up = validator_get_statistics(UP_LINK);
+    const validator_statistics_t* down = validator_get_statistics(DOWN_LINK);
+
+    print("\n\t- Serial link -\n");
+    xprintf("sent: %u, received: %u\n",
+        (unsigned int)transport->frames_sent, (unsigned int)transport->frames_received);
+    xprintf("retransmits: %u, duplicates: %u\n",
+        (unsigned int)transport->retransmits, (unsigned int)transport->duplicates);
+    xprintf("round trip: %u ms, max: %u ms\n",
+        transport->round_trip_time, transport->max_round_trip_time);
+    xprintf("UPLINK frames: %u, CRC errors: %u\n",
+        (unsigned int)up->frames, (unsigned int)up->crc_errors);
+    xprintf("DOWNLINK frames: %u, CRC errors: %u\n",
+        (unsigned int)down->frames, (unsigned int)down->crc_errors);
+}
+
 host_driver_t* get_serial_link_driver(void) {
     return &serial_driver;
 }
@@ -34,6 +34,8 @@ bool is_serial_link_connected(void);
 bool is_serial_link_master(void);
 host_driver_t* get_serial_link_driver(void);
 void serial_link_update(void);
+// Prints the frame counters and the round trip time to the console
+void serial_link_print_statistics(void);
 
 #if defined(PROTOCOL_CHIBIOS)
 #include "ch.h"
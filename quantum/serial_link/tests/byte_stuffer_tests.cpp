@@ -26,6 +26,8 @@ SOFTWARE.
 #include "gmock/gmock.h"
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
 extern "C" {
 #include "serial_link/protocol/byte_stuffer.h"
 #include "serial_link/protocol/frame_validator.h"
@@ -50,9 +52,11 @@ public:
     MOCK_METHOD3(validator_recv_frame, void (uint8_t link, uint8_t* data, uint16_t size));
 
     void send_data(uint8_t link, const uint8_t* data, uint16_t size) {
+        send_data_calls++;
         std::copy(data, data + size, std::back_inserter(sent_data));
     }
     std::vector<uint8_t> sent_data;
+    int send_data_calls = 0;
 
     static ByteStuffer* Instance;
 };
@@ -481,3 +485,45 @@ TEST_F(ByteStuffer, sends_and_receives_full_roundtrip_254_bytes_and_then_zero) {
        byte_stuffer_recv_byte(1, d);
     }
 }
+
+TEST_F(ByteStuffer, sends_the_whole_frame_with_one_call) {
+    uint8_t data[600];
+    int i;
+    for(i=0;i<600;i++) {
+        data[i] = i % 100;
+    }
+    byte_stuffer_send_frame(0, data, 600);
+    EXPECT_EQ(send_data_calls, 1);
+}
+
+TEST_F(ByteStuffer, receives_what_it_sends_for_a_max_size_frame) {
+    uint8_t data[MAX_FRAME_SIZE];
+    int i;
+    for(i=0;i<MAX_FRAME_SIZE;i++) {
+        // Long runs without zeroes, and some zeroes next to each other
+        data[i] = (i % 300 < 3) ? 0 : i;
+    }
+    byte_stuffer_send_frame(1, data, MAX_FRAME_SIZE);
+    EXPECT_CALL(*this, validator_recv_frame(_, _, _))
+        .With(Args<1, 2>(ElementsAreArray(data, MAX_FRAME_SIZE)));
+    for (auto byte : sent_data) {
+        byte_stuffer_recv_byte(1, byte);
+    }
+}
+
+TEST_F(ByteStuffer, sends_large_frames_fast) {
+    static uint8_t data[MAX_FRAME_SIZE];
+    int i;
+    for(i=0;i<MAX_FRAME_SIZE;i++) {
+        data[i] = i * 13 + 7;
+    }
+    const int iterations = 2000;
+    auto start = std::chrono::steady_clock::now();
+    for (i=0;i<iterations;i++) {
+        sent_data.clear();
+        byte_stuffer_send_frame(0, data, MAX_FRAME_SIZE);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    printf("[ BENCH    ] byte_stuffer: %.1f MB/s\n",
+        iterations * MAX_FRAME_SIZE / elapsed.count() / 1e6);
+}
@@ -24,6 +24,9 @@ SOFTWARE.
 
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 extern "C" {
 #include "serial_link/protocol/frame_validator.h"
 }
@@ -113,3 +116,67 @@ TEST_F(FrameValidator, sends_five_bytes_with_correct_crc) {
         .With(Args<1, 2>(ElementsAreArray(expected)));
     validator_send_frame(0, original, 5);
 }
+
+TEST_F(FrameValidator, counts_frames_and_crc_errors) {
+    uint8_t valid[] = {1, 2, 3, 4, 5, 0xF4, 0x99, 0x0B, 0x47};
+    uint8_t invalid[] = {1, 2, 3, 4, 5, 0xF4, 0x99, 0x0B, 0x48};
+    // The counters are never reset
+    validator_statistics_t before = *validator_get_statistics(1);
+    EXPECT_CALL(*this, route_incoming_frame(_, _, _));
+    validator_recv_frame(1, valid, sizeof(valid));
+    validator_recv_frame(1, invalid, sizeof(invalid));
+    validator_recv_frame(1, invalid, 3);
+    EXPECT_EQ(validator_get_statistics(1)->frames - before.frames, 1);
+    EXPECT_EQ(validator_get_statistics(1)->crc_errors - before.crc_errors, 2);
+}
+
+namespace {
+    // The CRC computed a bit at a time, to check the table driven one
+    uint32_t reference_crc(const uint8_t* data, uint16_t size) {
+        uint32_t crc = 0xFFFFFFFF;
+        for (uint16_t i = 0; i < size; i++) {
+            crc ^= data[i];
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+            }
+        }
+        return ~crc;
+    }
+}
+
+TEST_F(FrameValidator, sends_correct_crc_for_any_size_and_alignment) {
+    uint8_t buffer[80];
+    for (unsigned i = 0; i < sizeof(buffer); i++) {
+        buffer[i] = i * 37 + 11;
+    }
+    EXPECT_CALL(*this, byte_stuffer_send_frame(_, _, _))
+        .Times(4 * 64);
+    for (uint16_t offset = 0; offset < 4; offset++) {
+        for (uint16_t size = 1; size <= 64; size++) {
+            uint8_t* data = buffer + offset;
+            validator_send_frame(0, data, size);
+            uint32_t crc;
+            memcpy(&crc, data + size, 4);
+            EXPECT_EQ(crc, reference_crc(data, size)) << "offset " << offset << ", size " << size;
+        }
+    }
+}
+
+// Checks the CRC of frames of the maximum size. The CRC is wrong, so that
+// only the validator is measured.
+TEST_F(FrameValidator, validates_large_frames_fast) {
+    static uint8_t data[1024];
+    for (unsigned i = 0; i < sizeof(data); i++) {
+        data[i] = i * 13 + 7;
+    }
+    EXPECT_CALL(*this, route_incoming_frame(_, _, _))
+        .Times(0);
+    const int iterations = 2000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        validator_recv_frame(0, data, sizeof(data));
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    printf("[ BENCH    ] frame_validator: %.1f MB/s\n",
+        iterations * sizeof(data) / elapsed.count() / 1e6);
+}
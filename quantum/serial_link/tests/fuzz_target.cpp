@@ -0,0 +1,100 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Feeds arbitrary data to the receiving side of a serial_link node. The
+// entry point follows the libFuzzer convention, so with clang it can be
+// built as a fuzzer, without the tests at the end of the file:
+//
+//   clang++ -g -fsanitize=fuzzer,address -DSERIAL_LINK_FUZZER -DSERIAL_LINK_RELIABLE \
+//     -Iquantum -Iquantum/serial_link/tests -Itmk_core/common \
+//     quantum/serial_link/tests/fuzz_target.cpp quantum/serial_link/tests/simulator.cpp \
+//     -x c tmk_core/common/test/timer.c -o serial_link_fuzzer
+//
+// The first byte of the input selects what's tested:
+//   bit 0: the node is the master
+//   bit 1: the link the data arrives on
+//   bit 2: the rest goes to validator_recv_frame instead of the byte stuffer
+//   bit 3: with bit 2, a correct CRC is added, so that the frame gets to the
+//          router and the transport
+
+#include "simulator.hpp"
+#include <string.h>
+#include <algorithm>
+
+#define FUZZ_MAX_FRAME_SIZE 1024
+
+static uint32_t fuzz_crc32(const uint8_t* data, size_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+        }
+    }
+    return ~crc;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    static uint8_t frame[FUZZ_MAX_FRAME_SIZE];
+    if (size == 0) {
+        return 0;
+    }
+    const SimulatorNode* node = simulator_nodes[0];
+    uint8_t mode = data[0];
+    uint8_t link = (mode >> 1) & 1;
+    node->init(mode & 1);
+    data++;
+    size--;
+    if (mode & 4) {
+        size_t crc_size = (mode & 8) ? 4 : 0;
+        size = std::min(size, sizeof(frame) - crc_size);
+        memcpy(frame, data, size);
+        if (crc_size) {
+            uint32_t crc = fuzz_crc32(frame, size);
+            memcpy(frame + size, &crc, 4);
+        }
+        node->recv_frame(link, frame, size + crc_size);
+    }
+    else {
+        for (size_t i = 0; i < size; i++) {
+            node->recv_byte(link, data[i]);
+        }
+    }
+    node->update();
+    return 0;
+}
+
+#ifndef SERIAL_LINK_FUZZER
+#include "gtest/gtest.h"
+#include <random>
+#include <vector>
+
+// Not a replacement for running the fuzzer, but catches the obvious crashes
+TEST(SerialLinkFuzz, survives_random_input) {
+    std::mt19937 random(1);
+    std::vector<uint8_t> input;
+    for (int i = 0; i < 20000; i++) {
+        input.resize(random() % 64 + 1);
+        for (auto& byte : input) {
+            // Mostly small values, so that the object ids and the hop
+            // counts are often valid
+            byte = (random() % 4) ? random() % 8 : random();
+        }
+        input[0] = random() % 16;
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+}
+#endif
@@ -20,3 +20,17 @@ serial_link_transport_SRC := \
 	$(SERIAL_PATH)/tests/transport_tests.cpp \
 	$(SERIAL_PATH)/protocol/transport.c \
 	$(SERIAL_PATH)/protocol/triple_buffered_object.c 
+
+serial_link_transport_reliable_DEFS := -DSERIAL_LINK_RELIABLE
+serial_link_transport_reliable_SRC := \
+	$(SERIAL_PATH)/tests/transport_reliable_tests.cpp \
+	$(SERIAL_PATH)/protocol/transport.c \
+	$(SERIAL_PATH)/protocol/triple_buffered_object.c \
+	$(TMK_PATH)/common/test/timer.c
+
+serial_link_simulator_DEFS := -DSERIAL_LINK_RELIABLE
+serial_link_simulator_SRC := \
+	$(SERIAL_PATH)/tests/simulator_tests.cpp \
+	$(SERIAL_PATH)/tests/simulator.cpp \
+	$(SERIAL_PATH)/tests/fuzz_target.cpp \
+	$(TMK_PATH)/common/test/timer.c
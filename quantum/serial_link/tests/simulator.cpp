@@ -0,0 +1,325 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "simulator.hpp"
+#include <stdbool.h>
+#include <string.h>
+#include <algorithm>
+#include <cstdio>
+
+extern "C" {
+#include "timer.h"
+#include "host_driver.h"
+    void advance_time(uint32_t ms);
+}
+
+#define SIMULATOR_NODE 0
+namespace node0 {
+#include "simulator_node.h"
+}
+#undef SIMULATOR_NODE
+#define SIMULATOR_NODE 1
+namespace node1 {
+#include "simulator_node.h"
+}
+#undef SIMULATOR_NODE
+#define SIMULATOR_NODE 2
+namespace node2 {
+#include "simulator_node.h"
+}
+#undef SIMULATOR_NODE
+#define SIMULATOR_NODE 3
+namespace node3 {
+#include "simulator_node.h"
+}
+#undef SIMULATOR_NODE
+#define SIMULATOR_NODE 4
+namespace node4 {
+#include "simulator_node.h"
+}
+#undef SIMULATOR_NODE
+#define SIMULATOR_NODE 5
+namespace node5 {
+#include "simulator_node.h"
+}
+#undef SIMULATOR_NODE
+#define SIMULATOR_NODE 6
+namespace node6 {
+#include "simulator_node.h"
+}
+#undef SIMULATOR_NODE
+#define SIMULATOR_NODE 7
+namespace node7 {
+#include "simulator_node.h"
+}
+#undef SIMULATOR_NODE
+#define SIMULATOR_NODE 8
+namespace node8 {
+#include "simulator_node.h"
+}
+#undef SIMULATOR_NODE
+
+const SimulatorNode* const simulator_nodes[SIMULATOR_MAX_NODES] = {
+    &node0::node, &node1::node, &node2::node,
+    &node3::node, &node4::node, &node5::node,
+    &node6::node, &node7::node, &node8::node,
+};
+
+Simulator* Simulator::current = nullptr;
+
+Simulator::Simulator(const SimulatorConfig& config) :
+    config(config),
+    random(config.seed),
+    links(config.num_nodes - 1, config.link),
+    up_wires(config.num_nodes - 1),
+    down_wires(config.num_nodes - 1),
+    last_matrix(config.num_nodes),
+    last_matrix_write(config.num_nodes),
+    matrix_seen(config.num_nodes),
+    state_seen(config.num_nodes)
+{
+    current = this;
+    for (size_t i = 0; i < links.size(); i++) {
+        up_wires[i].config = &links[i];
+        down_wires[i].config = &links[i];
+    }
+    memset(&last_state, 0, sizeof(last_state));
+    now = timer_read32();
+    start = now;
+    for (uint8_t i = 0; i < config.num_nodes; i++) {
+        memset(&last_matrix[i], 0, sizeof(sim_matrix_t));
+        last_matrix_write[i] = now;
+        simulator_nodes[i]->init(i == 0);
+        initial_statistics.push_back(simulator_nodes[i]->statistics());
+    }
+}
+
+Simulator::~Simulator() {
+    current = nullptr;
+}
+
+void Simulator::send_data(uint8_t node, uint8_t link, const uint8_t* data, uint16_t size) {
+    if (current) {
+        current->send(node, link, data, size);
+    }
+}
+
+// The wire a node sends to on one of its links
+Simulator::Wire* Simulator::wire(uint8_t node, uint8_t link) {
+    if (link == DOWN_LINK) {
+        return node + 1 < config.num_nodes ? &down_wires[node] : nullptr;
+    }
+    else {
+        return node > 0 ? &up_wires[node - 1] : nullptr;
+    }
+}
+
+void Simulator::send(uint8_t node, uint8_t link, const uint8_t* data, uint16_t size) {
+    Wire* w = wire(node, link);
+    if (!w) {
+        return;
+    }
+    const LinkConfig& link_config = *w->config;
+    // A start bit, 8 data bits and a stop bit
+    uint64_t byte_time = 10000000ULL / link_config.baud;
+    std::uniform_real_distribution<double> probability(0.0, 1.0);
+    uint64_t now_us = uint64_t(now) * 1000;
+    for (uint16_t i = 0; i < size; i++) {
+        w->free_at = std::max(w->free_at, now_us) + byte_time;
+        w->bytes++;
+        if (!link_config.connected) {
+            continue;
+        }
+        if (link_config.drop_rate > 0 && probability(random) < link_config.drop_rate) {
+            continue;
+        }
+        uint8_t byte = data[i];
+        if (link_config.bit_error_rate > 0) {
+            for (uint8_t bit = 0; bit < 8; bit++) {
+                if (probability(random) < link_config.bit_error_rate) {
+                    byte ^= 1 << bit;
+                }
+            }
+        }
+        w->bytes_in_flight.push_back({w->free_at + link_config.latency_us, byte});
+    }
+}
+
+void Simulator::write_objects() {
+    if (!frozen && now % config.state_interval == 0) {
+        last_state.counter++;
+        last_state.written_at = now;
+        for (auto& byte : last_state.data) {
+            byte = random();
+        }
+        states_written++;
+        simulator_nodes[0]->write_state(&last_state);
+    }
+    for (uint8_t i = 1; i < config.num_nodes; i++) {
+        sim_matrix_t& matrix = last_matrix[i];
+        // The slaves don't scan in lockstep
+        if (!frozen && (now + i) % config.matrix_interval == 0) {
+            matrix.counter++;
+            matrix.written_at = now;
+            for (auto& row : matrix.rows) {
+                row = random();
+            }
+            matrices_written++;
+        }
+        else if (now - last_matrix_write[i] < config.keepalive_interval) {
+            continue;
+        }
+        last_matrix_write[i] = now;
+        simulator_nodes[i]->write_matrix(&matrix);
+    }
+}
+
+void Simulator::read_objects() {
+    for (uint8_t i = 1; i < config.num_nodes; i++) {
+        sim_matrix_t matrix;
+        if (simulator_nodes[0]->read_matrix(i - 1, &matrix) && matrix.counter > matrix_seen[i]) {
+            matrix_seen[i] = matrix.counter;
+            matrices_delivered++;
+            uint32_t latency = now - matrix.written_at;
+            total_latency += latency;
+            max_latency = std::max(max_latency, latency);
+        }
+        sim_state_t state;
+        if (simulator_nodes[i]->read_state(&state) && state.counter > state_seen[i]) {
+            state_seen[i] = state.counter;
+            states_delivered++;
+            uint32_t latency = now - state.written_at;
+            total_latency += latency;
+            max_latency = std::max(max_latency, latency);
+        }
+    }
+}
+
+// Advances the time by a millisecond. The nodes receive the bytes that
+// arrived meanwhile, and then send what they have to.
+void Simulator::step() {
+    now++;
+    advance_time(1);
+    write_objects();
+    uint64_t now_us = uint64_t(now) * 1000;
+    for (uint8_t i = 0; i < config.num_nodes; i++) {
+        // The bytes coming from the previous node, and from the next one
+        Wire* incoming[2] = {
+            i > 0 ? &down_wires[i - 1] : nullptr,
+            i + 1 < config.num_nodes ? &up_wires[i] : nullptr,
+        };
+        uint8_t incoming_link[2] = {UP_LINK, DOWN_LINK};
+        for (int j = 0; j < 2; j++) {
+            Wire* w = incoming[j];
+            while (w && !w->bytes_in_flight.empty() && w->bytes_in_flight.front().arrives_at <= now_us) {
+                uint8_t byte = w->bytes_in_flight.front().data;
+                w->bytes_in_flight.pop_front();
+                simulator_nodes[i]->recv_byte(incoming_link[j], byte);
+            }
+        }
+    }
+    for (uint8_t i = 0; i < config.num_nodes; i++) {
+        simulator_nodes[i]->update();
+    }
+    read_objects();
+}
+
+void Simulator::run(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+        step();
+    }
+}
+
+bool Simulator::synchronized() {
+    for (uint8_t i = 1; i < config.num_nodes; i++) {
+        if (matrix_seen[i] != last_matrix[i].counter || state_seen[i] != last_state.counter) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t Simulator::run_until_synchronized(uint32_t timeout) {
+    for (uint32_t elapsed = 0; elapsed < timeout; elapsed++) {
+        if (synchronized()) {
+            return elapsed;
+        }
+        step();
+    }
+    return UINT32_MAX;
+}
+
+LinkConfig& Simulator::link(uint8_t node) {
+    return links[node];
+}
+
+void Simulator::restart(uint8_t node) {
+    simulator_nodes[node]->init(node == 0);
+    // The application writes its objects again after starting
+    if (node == 0 && last_state.counter) {
+        simulator_nodes[0]->write_state(&last_state);
+    }
+    else {
+        last_matrix_write[node] = now - config.keepalive_interval;
+    }
+}
+
+void Simulator::freeze(bool f) {
+    frozen = f;
+}
+
+SimulatorResults Simulator::results() {
+    SimulatorResults results;
+    results.matrices_written = matrices_written;
+    results.matrices_delivered = matrices_delivered;
+    results.states_written = states_written;
+    results.states_delivered = states_delivered;
+    uint32_t delivered = matrices_delivered + states_delivered;
+    results.average_latency = delivered ? double(total_latency) / delivered : 0;
+    results.max_latency = max_latency;
+    uint64_t max_bytes = 0;
+    for (size_t i = 0; i < links.size(); i++) {
+        max_bytes = std::max(max_bytes, std::max(up_wires[i].bytes, down_wires[i].bytes));
+    }
+    double seconds = (now - start) / 1000.0;
+    results.max_link_bytes_per_second = seconds > 0 ? max_bytes / seconds : 0;
+    for (uint8_t i = 0; i < config.num_nodes; i++) {
+        NodeStatistics statistics = simulator_nodes[i]->statistics();
+        statistics.valid_frames -= initial_statistics[i].valid_frames;
+        statistics.crc_errors -= initial_statistics[i].crc_errors;
+        results.nodes.push_back(statistics);
+    }
+    return results;
+}
+
+void Simulator::print_results(const std::string& name) {
+    SimulatorResults r = results();
+    uint32_t retransmits = 0;
+    uint32_t crc_errors = 0;
+    for (auto& node : r.nodes) {
+        retransmits += node.retransmits;
+        crc_errors += node.crc_errors;
+    }
+    printf("[ BENCH    ] %s: %u nodes at %u baud, %u/%u matrices, %u/%u states, "
+        "latency %.1f ms (max %u ms), busiest link %.0f bytes/s (%.0f%% of capacity), "
+        "%u retransmits, %u CRC errors\n",
+        name.c_str(), config.num_nodes, config.link.baud,
+        r.matrices_delivered, r.matrices_written,
+        r.states_delivered, r.states_written * (config.num_nodes - 1),
+        r.average_latency, r.max_latency, r.max_link_bytes_per_second,
+        100.0 * r.max_link_bytes_per_second * 10 / config.link.baud,
+        retransmits, crc_errors);
+}
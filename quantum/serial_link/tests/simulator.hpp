@@ -0,0 +1,180 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+// The objects every node of the simulator has. The slaves send their matrix
+// to the master, and the master sends its state to all the slaves. Both
+// start with the number of the write, and the time it was written, so that
+// the receiver knows the latency.
+struct sim_matrix_t {
+    uint32_t counter;
+    uint32_t written_at;
+    uint8_t rows[8];
+};
+
+struct sim_state_t {
+    uint32_t counter;
+    uint32_t written_at;
+    uint8_t data[24];
+};
+
+struct NodeStatistics {
+    uint32_t frames_sent;
+    uint32_t frames_received;
+    uint32_t retransmits;
+    uint32_t duplicates;
+    uint16_t round_trip_time;
+    uint16_t max_round_trip_time;
+    uint32_t valid_frames;
+    uint32_t crc_errors;
+};
+
+// The serial_link stack of a node, each node has its own copy
+struct SimulatorNode {
+    void (*init)(bool master);
+    void (*recv_byte)(uint8_t link, uint8_t data);
+    void (*recv_frame)(uint8_t link, uint8_t* data, uint16_t size);
+    void (*update)(void);
+    void (*write_matrix)(const sim_matrix_t* matrix);
+    bool (*read_matrix)(uint8_t slave, sim_matrix_t* matrix);
+    void (*write_state)(const sim_state_t* state);
+    bool (*read_state)(sim_state_t* state);
+    NodeStatistics (*statistics)(void);
+};
+
+// The master, and up to NUM_SLAVES slaves
+#define SIMULATOR_MAX_NODES 9
+
+extern const SimulatorNode* const simulator_nodes[SIMULATOR_MAX_NODES];
+
+// One direction of the cable between two nodes
+struct LinkConfig {
+    uint32_t baud = 115200;
+    // Microseconds added to every byte, on top of the time it takes to send
+    uint32_t latency_us = 0;
+    // Probability of each bit to be flipped
+    double bit_error_rate = 0;
+    // Probability of each byte to be lost
+    double drop_rate = 0;
+    bool connected = true;
+};
+
+struct SimulatorConfig {
+    uint8_t num_nodes = 2;
+    LinkConfig link;
+    // Milliseconds between the changes of the matrix of each slave, and of
+    // the state of the master
+    uint32_t matrix_interval = 10;
+    uint32_t state_interval = 50;
+    // Like serial_link_update, the matrix is also written when it didn't
+    // change for this many milliseconds
+    uint32_t keepalive_interval = 5;
+    uint32_t seed = 1;
+};
+
+struct SimulatorResults {
+    uint32_t matrices_written;
+    uint32_t matrices_delivered;
+    uint32_t states_written;
+    // Counted for each slave
+    uint32_t states_delivered;
+    // Milliseconds from writing an object to reading it on the other end
+    double average_latency;
+    uint32_t max_latency;
+    // Bytes sent over the busiest link each second. More than the link can
+    // carry when it's overloaded, the bytes wait in the queue.
+    double max_link_bytes_per_second;
+    std::vector<NodeStatistics> nodes;
+};
+
+class Simulator {
+public:
+    Simulator(const SimulatorConfig& config);
+    ~Simulator();
+
+    // Runs for the given number of milliseconds
+    void run(uint32_t ms);
+    // Runs until every node has the latest objects of the others, and
+    // returns how many milliseconds it took, or UINT32_MAX after timeout
+    uint32_t run_until_synchronized(uint32_t timeout);
+    bool synchronized();
+
+    // The link between node and the next one in the chain, both directions
+    LinkConfig& link(uint8_t node);
+    void restart(uint8_t node);
+    // Stops changing the objects, so that the nodes can catch up
+    void freeze(bool frozen);
+
+    SimulatorResults results();
+    void print_results(const std::string& name);
+
+    // Called by send_data of the nodes
+    static void send_data(uint8_t node, uint8_t link, const uint8_t* data, uint16_t size);
+
+private:
+    struct Byte {
+        uint64_t arrives_at;
+        uint8_t data;
+    };
+
+    struct Wire {
+        LinkConfig* config;
+        uint64_t free_at = 0;
+        uint64_t bytes = 0;
+        std::deque<Byte> bytes_in_flight;
+    };
+
+    Wire* wire(uint8_t node, uint8_t link);
+    void send(uint8_t node, uint8_t link, const uint8_t* data, uint16_t size);
+    void step();
+    void write_objects();
+    void read_objects();
+
+    static Simulator* current;
+
+    SimulatorConfig config;
+    std::mt19937 random;
+    std::vector<LinkConfig> links;
+    // Two for each link, towards the master and away from it
+    std::vector<Wire> up_wires;
+    std::vector<Wire> down_wires;
+    uint32_t now = 0;
+    uint32_t start = 0;
+    bool frozen = false;
+
+    std::vector<sim_matrix_t> last_matrix;
+    std::vector<uint32_t> last_matrix_write;
+    std::vector<uint32_t> matrix_seen;
+    sim_state_t last_state;
+    std::vector<uint32_t> state_seen;
+    // The validator counters are never reset, only the ones since the start
+    // of the simulation are reported
+    std::vector<NodeStatistics> initial_statistics;
+
+    uint32_t matrices_written = 0;
+    uint32_t matrices_delivered = 0;
+    uint32_t states_written = 0;
+    uint32_t states_delivered = 0;
+    uint64_t total_latency = 0;
+    uint32_t max_latency = 0;
+};
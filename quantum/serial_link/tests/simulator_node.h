@@ -0,0 +1,109 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// A node of the simulator. Included once for each node, inside a namespace
+// of its own, with SIMULATOR_NODE set to its index. That way every node gets
+// its own copy of the static state of the serial_link stack.
+
+#undef SERIAL_LINK_BYTE_STUFFER_H
+#undef SERIAL_LINK_FRAME_VALIDATOR_H
+#undef SERIAL_LINK_FRAME_ROUTER_H
+#undef SERIAL_LINK_PHYSICAL_H
+#undef SERIAL_LINK_TRIPLE_BUFFERED_OBJECT_H
+#undef SERIAL_LINK_TRANSPORT_H
+#undef SERIAL_LINK_H
+
+#include "serial_link/protocol/byte_stuffer.c"
+#include "serial_link/protocol/frame_validator.c"
+#include "serial_link/protocol/frame_router.c"
+#include "serial_link/protocol/triple_buffered_object.c"
+#include "serial_link/protocol/transport.c"
+
+SLAVE_TO_MASTER_OBJECT(sim_matrix, sim_matrix_t);
+MASTER_TO_ALL_SLAVES_OBJECT(sim_state, sim_state_t);
+
+static remote_object_t* sim_objects[] = {
+    REMOTE_OBJECT(sim_matrix),
+    REMOTE_OBJECT(sim_state),
+};
+
+void send_data(uint8_t link, const uint8_t* data, uint16_t size) {
+    Simulator::send_data(SIMULATOR_NODE, link, data, size);
+}
+
+void signal_data_written(void) {
+}
+
+static void node_init(bool master) {
+    reinitialize_serial_link_transport();
+    add_remote_objects(sim_objects, sizeof(sim_objects) / sizeof(remote_object_t*));
+    init_byte_stuffer();
+    router_set_master(master);
+}
+
+static void node_write_matrix(const sim_matrix_t* matrix) {
+    *begin_write_sim_matrix() = *matrix;
+    end_write_sim_matrix();
+}
+
+static bool node_read_matrix(uint8_t slave, sim_matrix_t* matrix) {
+    sim_matrix_t* m = read_sim_matrix(slave);
+    if (m) {
+        *matrix = *m;
+    }
+    return m;
+}
+
+static void node_write_state(const sim_state_t* state) {
+    *begin_write_sim_state() = *state;
+    end_write_sim_state();
+}
+
+static bool node_read_state(sim_state_t* state) {
+    sim_state_t* s = read_sim_state();
+    if (s) {
+        *state = *s;
+    }
+    return s;
+}
+
+static NodeStatistics node_statistics(void) {
+    const transport_statistics_t* transport = transport_get_statistics();
+    NodeStatistics result = {};
+    result.frames_sent = transport->frames_sent;
+    result.frames_received = transport->frames_received;
+    result.retransmits = transport->retransmits;
+    result.duplicates = transport->duplicates;
+    result.round_trip_time = transport->round_trip_time;
+    result.max_round_trip_time = transport->max_round_trip_time;
+    for (uint8_t link = 0; link < NUM_LINKS; link++) {
+        result.valid_frames += validator_get_statistics(link)->frames;
+        result.crc_errors += validator_get_statistics(link)->crc_errors;
+    }
+    return result;
+}
+
+const SimulatorNode node = {
+    node_init,
+    byte_stuffer_recv_byte,
+    validator_recv_frame,
+    update_transport,
+    node_write_matrix,
+    node_read_matrix,
+    node_write_state,
+    node_read_state,
+    node_statistics,
+};
@@ -0,0 +1,136 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include "simulator.hpp"
+
+extern "C" {
+#include "serial_link/protocol/transport.h"
+    void set_time(uint32_t t);
+}
+
+class SerialLinkSimulator : public testing::Test {
+public:
+    SerialLinkSimulator() {
+        set_time(1000);
+    }
+};
+
+TEST_F(SerialLinkSimulator, two_halves_stay_in_sync) {
+    SimulatorConfig config;
+    Simulator simulator(config);
+    simulator.run(1000);
+    EXPECT_LT(simulator.run_until_synchronized(10), 10);
+    SimulatorResults results = simulator.results();
+    EXPECT_EQ(results.matrices_delivered, results.matrices_written);
+    EXPECT_EQ(results.states_delivered, results.states_written);
+    simulator.print_results("two_halves");
+}
+
+TEST_F(SerialLinkSimulator, full_chain_delivers_every_object) {
+    SimulatorConfig config;
+    config.num_nodes = SIMULATOR_MAX_NODES;
+    config.link.baud = 1000000;
+    Simulator simulator(config);
+    // The first frames can be sent again before the round trip is measured
+    simulator.run(100);
+    std::vector<uint32_t> retransmits;
+    for (auto& node : simulator.results().nodes) {
+        retransmits.push_back(node.retransmits);
+    }
+    simulator.run(900);
+    simulator.freeze(true);
+    EXPECT_NE(simulator.run_until_synchronized(100), UINT32_MAX);
+    SimulatorResults results = simulator.results();
+    EXPECT_EQ(results.matrices_delivered, results.matrices_written);
+    EXPECT_EQ(results.states_delivered, results.states_written * (SIMULATOR_MAX_NODES - 1));
+    for (size_t i = 0; i < results.nodes.size(); i++) {
+        EXPECT_EQ(results.nodes[i].crc_errors, 0);
+        // Nothing is lost, so nothing is sent again after that
+        EXPECT_EQ(results.nodes[i].retransmits, retransmits[i]);
+    }
+    simulator.print_results("full_chain");
+}
+
+TEST_F(SerialLinkSimulator, recovers_from_bit_errors_and_drops) {
+    SimulatorConfig config;
+    config.num_nodes = 4;
+    config.link.baud = 1000000;
+    config.link.bit_error_rate = 1e-4;
+    config.link.drop_rate = 1e-3;
+    Simulator simulator(config);
+    simulator.run(2000);
+    simulator.print_results("noisy_chain");
+    SimulatorResults results = simulator.results();
+    uint32_t crc_errors = 0;
+    uint32_t retransmits = 0;
+    for (auto& node : results.nodes) {
+        crc_errors += node.crc_errors;
+        retransmits += node.retransmits;
+    }
+    EXPECT_GT(crc_errors, 0);
+    EXPECT_GT(retransmits, 0);
+    // The latest values get through once the noise stops
+    for (uint8_t i = 0; i < config.num_nodes - 1; i++) {
+        simulator.link(i).bit_error_rate = 0;
+        simulator.link(i).drop_rate = 0;
+    }
+    simulator.freeze(true);
+    EXPECT_LT(simulator.run_until_synchronized(100), 3 * SERIAL_LINK_RETRANSMIT_TIMEOUT);
+}
+
+TEST_F(SerialLinkSimulator, recovers_when_a_cable_is_plugged_back) {
+    SimulatorConfig config;
+    config.num_nodes = 3;
+    config.link.baud = 1000000;
+    Simulator simulator(config);
+    simulator.run(100);
+    simulator.link(1).connected = false;
+    simulator.run(200);
+    EXPECT_FALSE(simulator.synchronized());
+    simulator.link(1).connected = true;
+    simulator.freeze(true);
+    uint32_t recovery = simulator.run_until_synchronized(100);
+    printf("[ BENCH    ] cable_plugged_back: recovered in %u ms\n", recovery);
+    EXPECT_LT(recovery, 3 * SERIAL_LINK_RETRANSMIT_TIMEOUT);
+}
+
+TEST_F(SerialLinkSimulator, recovers_when_a_slave_restarts) {
+    SimulatorConfig config;
+    config.num_nodes = 3;
+    Simulator simulator(config);
+    simulator.run(100);
+    simulator.restart(2);
+    simulator.run(100);
+    simulator.freeze(true);
+    uint32_t recovery = simulator.run_until_synchronized(100);
+    printf("[ BENCH    ] slave_restart: recovered in %u ms\n", recovery);
+    EXPECT_NE(recovery, UINT32_MAX);
+}
+
+// Prints the load of the busiest link and the latency for a few link rates,
+// to help choosing SERIAL_LINK_BAUD
+TEST_F(SerialLinkSimulator, link_rates) {
+    const uint32_t rates[] = {57600, 115200, 460800, 1000000};
+    for (uint32_t baud : rates) {
+        SimulatorConfig config;
+        config.num_nodes = 5;
+        config.link.baud = baud;
+        Simulator simulator(config);
+        simulator.run(1000);
+        simulator.print_results("link_rate");
+    }
+}
@@ -3,4 +3,6 @@ TEST_LIST +=\
 	serial_link_frame_validator\
 	serial_link_frame_router\
 	serial_link_triple_buffered_object\
-	serial_link_transport
\ No newline at end of file
+	serial_link_transport\
+	serial_link_transport_reliable\
+	serial_link_simulator
\ No newline at end of file
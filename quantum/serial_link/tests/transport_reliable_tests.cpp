@@ -0,0 +1,262 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include <vector>
+
+using testing::ElementsAre;
+
+extern "C" {
+#include "serial_link/protocol/transport.h"
+void set_time(uint32_t t);
+void advance_time(uint32_t ms);
+}
+
+struct test_object1 {
+    uint32_t test;
+};
+
+MASTER_TO_ALL_SLAVES_OBJECT(master_to_slave, test_object1);
+MASTER_TO_SINGLE_SLAVE_OBJECT(master_to_single_slave, test_object1);
+SLAVE_TO_MASTER_OBJECT(slave_to_master, test_object1);
+
+static remote_object_t* test_remote_objects[] = {
+    REMOTE_OBJECT(master_to_slave),
+    REMOTE_OBJECT(master_to_single_slave),
+    REMOTE_OBJECT(slave_to_master),
+};
+
+#define MASTER_TO_SLAVE_ID 0
+#define SLAVE_TO_MASTER_ID 2
+#define ACK_ID 0xFF
+#define SEQ_RESTART 0x80
+
+struct Frame {
+    uint8_t destination;
+    std::vector<uint8_t> data;
+};
+
+class ReliableTransport : public testing::Test {
+public:
+    ReliableTransport() {
+        Instance = this;
+        set_time(1000);
+        add_remote_objects(test_remote_objects, sizeof(test_remote_objects) / sizeof(remote_object_t*));
+    }
+
+    ~ReliableTransport() {
+        Instance = nullptr;
+        reinitialize_serial_link_transport();
+    }
+
+    void write_master_to_slave(uint32_t value) {
+        begin_write_master_to_slave()->test = value;
+        end_write_master_to_slave();
+    }
+
+    void write_slave_to_master(uint32_t value) {
+        begin_write_slave_to_master()->test = value;
+        end_write_slave_to_master();
+    }
+
+    // Runs the transport, and returns the frames it sent
+    std::vector<Frame> update() {
+        sent_frames.clear();
+        update_transport();
+        return sent_frames;
+    }
+
+    void receive(uint8_t from, std::vector<uint8_t> data) {
+        transport_recv_frame(from, data.data(), data.size());
+    }
+
+    static ReliableTransport* Instance;
+
+    std::vector<Frame> sent_frames;
+};
+
+ReliableTransport* ReliableTransport::Instance = nullptr;
+
+extern "C" {
+void signal_data_written(void) {
+}
+
+void router_send_frame(uint8_t destination, uint8_t* data, uint16_t size) {
+    ReliableTransport::Instance->sent_frames.push_back({destination, std::vector<uint8_t>(data, data + size)});
+}
+}
+
+TEST_F(ReliableTransport, frames_have_a_sequence_number_before_the_id) {
+    write_slave_to_master(7);
+    auto frames = update();
+    ASSERT_EQ(frames.size(), 1);
+    EXPECT_EQ(frames[0].destination, 0);
+    EXPECT_THAT(frames[0].data, ElementsAre(7, 0, 0, 0, 1 | SEQ_RESTART, SLAVE_TO_MASTER_ID));
+    receive(0, {1 << SLAVE_TO_MASTER_ID, 0, 1, ACK_ID});
+    write_slave_to_master(8);
+    frames = update();
+    ASSERT_EQ(frames.size(), 1);
+    EXPECT_THAT(frames[0].data, ElementsAre(8, 0, 0, 0, 2, SLAVE_TO_MASTER_ID));
+}
+
+TEST_F(ReliableTransport, frames_are_marked_as_restarted_until_acknowledged) {
+    write_slave_to_master(7);
+    update();
+    write_slave_to_master(8);
+    auto frames = update();
+    ASSERT_EQ(frames.size(), 1);
+    EXPECT_THAT(frames[0].data, ElementsAre(8, 0, 0, 0, 2 | SEQ_RESTART, SLAVE_TO_MASTER_ID));
+    receive(0, {1 << SLAVE_TO_MASTER_ID, 0, 2, ACK_ID});
+    write_slave_to_master(9);
+    frames = update();
+    ASSERT_EQ(frames.size(), 1);
+    EXPECT_THAT(frames[0].data, ElementsAre(9, 0, 0, 0, 3, SLAVE_TO_MASTER_ID));
+}
+
+TEST_F(ReliableTransport, restarted_peer_is_not_taken_for_a_duplicate) {
+    receive(0, {5, 0, 0, 0, 1, MASTER_TO_SLAVE_ID});
+    EXPECT_NE(read_master_to_slave(), nullptr);
+    // The master restarted, and starts again from 1
+    receive(0, {6, 0, 0, 0, 1 | SEQ_RESTART, MASTER_TO_SLAVE_ID});
+    test_object1* obj = read_master_to_slave();
+    ASSERT_NE(obj, nullptr);
+    EXPECT_EQ(obj->test, 6);
+    auto frames = update();
+    ASSERT_EQ(frames.size(), 1);
+    EXPECT_THAT(frames[0].data, ElementsAre(1 << MASTER_TO_SLAVE_ID, 0, 1, ACK_ID));
+    EXPECT_EQ(transport_get_statistics()->duplicates, 0);
+}
+
+TEST_F(ReliableTransport, received_objects_are_acknowledged) {
+    receive(0, {5, 0, 0, 0, 3, MASTER_TO_SLAVE_ID});
+    test_object1* obj = read_master_to_slave();
+    ASSERT_NE(obj, nullptr);
+    EXPECT_EQ(obj->test, 5);
+    auto frames = update();
+    ASSERT_EQ(frames.size(), 1);
+    EXPECT_EQ(frames[0].destination, 0);
+    EXPECT_THAT(frames[0].data, ElementsAre(1 << MASTER_TO_SLAVE_ID, 0, 3, ACK_ID));
+    // Only once
+    EXPECT_EQ(update().size(), 0);
+}
+
+TEST_F(ReliableTransport, master_acknowledges_to_the_slave_it_received_from) {
+    receive(3, {5, 0, 0, 0, 9, SLAVE_TO_MASTER_ID});
+    auto frames = update();
+    ASSERT_EQ(frames.size(), 1);
+    EXPECT_EQ(frames[0].destination, 1 << 2);
+    EXPECT_THAT(frames[0].data, ElementsAre(1 << SLAVE_TO_MASTER_ID, 0, 9, ACK_ID));
+}
+
+TEST_F(ReliableTransport, unacknowledged_objects_are_sent_again_after_the_timeout) {
+    write_slave_to_master(7);
+    update();
+    advance_time(SERIAL_LINK_RETRANSMIT_TIMEOUT - 1);
+    EXPECT_EQ(update().size(), 0);
+    advance_time(1);
+    auto frames = update();
+    ASSERT_EQ(frames.size(), 1);
+    EXPECT_THAT(frames[0].data, ElementsAre(7, 0, 0, 0, 1 | SEQ_RESTART, SLAVE_TO_MASTER_ID));
+    EXPECT_EQ(transport_get_statistics()->retransmits, 1);
+}
+
+TEST_F(ReliableTransport, acknowledged_objects_are_not_sent_again) {
+    write_slave_to_master(7);
+    update();
+    advance_time(3);
+    receive(0, {1 << SLAVE_TO_MASTER_ID, 0, 1, ACK_ID});
+    advance_time(SERIAL_LINK_RETRANSMIT_TIMEOUT);
+    EXPECT_EQ(update().size(), 0);
+    EXPECT_EQ(transport_get_statistics()->retransmits, 0);
+    EXPECT_EQ(transport_get_statistics()->round_trip_time, 3);
+}
+
+TEST_F(ReliableTransport, the_timeout_follows_the_measured_round_trip) {
+    write_slave_to_master(7);
+    update();
+    advance_time(8);
+    receive(0, {1 << SLAVE_TO_MASTER_ID, 0, 1, ACK_ID});
+    write_slave_to_master(8);
+    update();
+    advance_time(15);
+    EXPECT_EQ(update().size(), 0);
+    advance_time(1);
+    EXPECT_EQ(update().size(), 1);
+}
+
+TEST_F(ReliableTransport, the_timeout_doubles_while_frames_are_sent_again) {
+    write_slave_to_master(7);
+    update();
+    advance_time(SERIAL_LINK_RETRANSMIT_TIMEOUT);
+    EXPECT_EQ(update().size(), 1);
+    advance_time(SERIAL_LINK_RETRANSMIT_TIMEOUT);
+    EXPECT_EQ(update().size(), 0);
+    advance_time(SERIAL_LINK_RETRANSMIT_TIMEOUT);
+    EXPECT_EQ(update().size(), 1);
+    EXPECT_EQ(transport_get_statistics()->retransmits, 2);
+}
+
+TEST_F(ReliableTransport, acknowledgements_of_older_frames_are_ignored) {
+    write_slave_to_master(7);
+    update();
+    write_slave_to_master(8);
+    update();
+    receive(0, {1 << SLAVE_TO_MASTER_ID, 0, 1, ACK_ID});
+    advance_time(SERIAL_LINK_RETRANSMIT_TIMEOUT);
+    auto frames = update();
+    ASSERT_EQ(frames.size(), 1);
+    EXPECT_THAT(frames[0].data, ElementsAre(8, 0, 0, 0, 2 | SEQ_RESTART, SLAVE_TO_MASTER_ID));
+}
+
+TEST_F(ReliableTransport, duplicates_are_acknowledged_but_not_applied) {
+    receive(0, {5, 0, 0, 0, 3, MASTER_TO_SLAVE_ID});
+    EXPECT_NE(read_master_to_slave(), nullptr);
+    update();
+    receive(0, {5, 0, 0, 0, 3, MASTER_TO_SLAVE_ID});
+    EXPECT_EQ(read_master_to_slave(), nullptr);
+    auto frames = update();
+    ASSERT_EQ(frames.size(), 1);
+    EXPECT_THAT(frames[0].data, ElementsAre(1 << MASTER_TO_SLAVE_ID, 0, 3, ACK_ID));
+    EXPECT_EQ(transport_get_statistics()->frames_received, 2);
+    EXPECT_EQ(transport_get_statistics()->duplicates, 1);
+}
+
+TEST_F(ReliableTransport, broadcasts_wait_for_every_known_slave) {
+    // Two slaves have been heard from
+    receive(1, {0, 0, 0, 0, 1, SLAVE_TO_MASTER_ID});
+    receive(2, {0, 0, 0, 0, 1, SLAVE_TO_MASTER_ID});
+    update();
+    write_master_to_slave(4);
+    auto frames = update();
+    ASSERT_EQ(frames.size(), 1);
+    EXPECT_EQ(frames[0].destination, 0xFF);
+    receive(1, {1 << MASTER_TO_SLAVE_ID, 0, 1, ACK_ID});
+    advance_time(SERIAL_LINK_RETRANSMIT_TIMEOUT);
+    EXPECT_EQ(update().size(), 1);
+    receive(2, {1 << MASTER_TO_SLAVE_ID, 0, 1, ACK_ID});
+    advance_time(SERIAL_LINK_RETRANSMIT_TIMEOUT);
+    EXPECT_EQ(update().size(), 0);
+}
+
+TEST_F(ReliableTransport, ignores_truncated_acknowledgements) {
+    write_slave_to_master(7);
+    update();
+    receive(0, {1 << SLAVE_TO_MASTER_ID, 0, ACK_ID});
+    receive(0, {ACK_ID});
+    advance_time(SERIAL_LINK_RETRANSMIT_TIMEOUT);
+    EXPECT_EQ(update().size(), 1);
+}
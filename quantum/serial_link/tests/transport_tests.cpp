@@ -186,3 +186,18 @@ TEST_F(Transport, ignores_object_with_size_too_big) {
     test_object1* obj2 = read_master_to_slave();
     EXPECT_EQ(obj2, nullptr);
 }
+
+TEST_F(Transport, ignores_slave_to_master_object_without_a_hop) {
+    update_transport();
+    test_object1* obj = begin_write_slave_to_master();
+    obj->test = 7;
+    EXPECT_CALL(*this, signal_data_written());
+    end_write_slave_to_master();
+    EXPECT_CALL(*this, router_send_frame(0));
+    update_transport();
+    transport_recv_frame(0, sent_data.data(), sent_data.size());
+    EXPECT_EQ(transport_get_statistics()->frames_received, 0);
+    for (uint8_t i = 0; i < NUM_SLAVES; i++) {
+        EXPECT_EQ(read_slave_to_master(i), nullptr);
+    }
+}
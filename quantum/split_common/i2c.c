@@ -5,7 +5,6 @@
 #include <util/twi.h>
 #include <stdbool.h>
 #include "i2c.h"
-#include "split_flags.h"
 
 #if defined(USE_I2C) || defined(EH)
 
@@ -20,9 +19,11 @@
 #define BUFFER_POS_INC() (slave_buffer_pos = (slave_buffer_pos+1)%SLAVE_BUFFER_SIZE)
 
 volatile uint8_t i2c_slave_buffer[SLAVE_BUFFER_SIZE];
+volatile bool i2c_slave_has_message = false;
 
 static volatile uint8_t slave_buffer_pos;
 static volatile bool slave_has_register_set = false;
+static volatile bool slave_has_data = false;
 
 // Wait for an i2c operation to finish
 inline static
@@ -138,6 +139,7 @@ ISR(TWI_vect) {
     case TW_SR_SLA_ACK:
       // this device has been addressed as a slave receiver
       slave_has_register_set = false;
+      slave_has_data = false;
       break;
 
     case TW_SR_DATA_ACK:
@@ -156,18 +158,25 @@ ISR(TWI_vect) {
         
         slave_has_register_set = true;
       } else {      
-        i2c_slave_buffer[slave_buffer_pos] = TWDR;
-        
-        if ( slave_buffer_pos == I2C_BACKLIT_START) {
-            BACKLIT_DIRTY = true;
-        } else if ( slave_buffer_pos == (I2C_RGB_START+3)) {
-            RGB_DIRTY = true;
+        if (slave_buffer_pos >= I2C_MASTER_MESSAGE_START) {
+          // a message that wasn't read yet can't be read while it's
+          // overwritten, the register write of a read leaves it alone
+          i2c_slave_has_message = false;
+          slave_has_data = true;
         }
-        
+        i2c_slave_buffer[slave_buffer_pos] = TWDR;
         BUFFER_POS_INC();
       }
       break;
 
+    case TW_SR_STOP:
+      // the master is done writing its message
+      if (slave_has_data) {
+        i2c_slave_has_message = true;
+        slave_has_data = false;
+      }
+      break;
+
     case TW_ST_SLA_ACK:
     case TW_ST_DATA_ACK:
       // master has addressed this device as a slave transmitter and is
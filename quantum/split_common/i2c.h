@@ -2,6 +2,8 @@
 #define I2C_H
 
 #include <stdint.h>
+#include <stdbool.h>
+#include "split_sync.h"
 
 #ifndef F_CPU
 #define F_CPU 16000000UL
@@ -13,24 +15,22 @@
 #define I2C_ACK 1
 #define I2C_NACK 0
 
-// Address location defines (Keymap should be last, as it's size is dynamic)
-#define I2C_BACKLIT_START   0x00
-// Need 4 bytes for RGB (32 bit)
-#define I2C_RGB_START       0x01
-#define I2C_KEYMAP_START    0x06
+// Address location defines. Each location holds the length of a split_sync
+// message, the message and a checksum.
+#define I2C_SLAVE_MESSAGE_START  0x00
+#define I2C_MASTER_MESSAGE_START (SPLIT_SYNC_BUFFER_SIZE + 2)
 
 // Slave buffer (8bit per)
-// Rows per hand + backlit space + rgb space
-// TODO : Make this dynamically sized
-#define SLAVE_BUFFER_SIZE 0x20
+#define SLAVE_BUFFER_SIZE (2 * (SPLIT_SYNC_BUFFER_SIZE + 2))
 
 // i2c SCL clock frequency
 #ifndef SCL_CLOCK
 #define SCL_CLOCK  100000L
 #endif
 
-// Support 8bits right now (8 cols) will need to edit to take higher (code exists in delta split?)
 extern volatile uint8_t i2c_slave_buffer[SLAVE_BUFFER_SIZE];
+// Set on the slave when the master wrote a message, clear it once it's read
+extern volatile bool i2c_slave_has_message;
 
 void i2c_master_init(void);
 uint8_t i2c_master_start(uint8_t address);
@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdint.h>
 #include <stdbool.h>
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include "wait.h"
 #include "print.h"
 #include "debug.h"
@@ -30,10 +31,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "pro_micro.h"
 #include "config.h"
 #include "timer.h"
-#include "split_flags.h"
+#include "split_sync.h"
+#include "debounce.h"
 
 #ifdef RGBLIGHT_ENABLE
 #   include "rgblight.h"
+    extern rgblight_config_t rgblight_config;
 #endif
 #ifdef BACKLIGHT_ENABLE
 #   include "backlight.h"
@@ -46,15 +49,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #  include "serial.h"
 #endif
 
-#ifndef DEBOUNCING_DELAY
-#   define DEBOUNCING_DELAY 5
-#endif
-
-#if (DEBOUNCING_DELAY > 0)
-    static uint16_t debouncing_time;
-    static bool debouncing = false;
-#endif
-
 #if (MATRIX_COLS <= 8)
 #    define print_matrix_header()  print("\nr/c 01234567\n")
 #    define print_matrix_row(row)  print_bin_reverse8(matrix_get_row(row))
@@ -63,6 +57,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #else
 #    error "Currently only supports 8 COLS"
 #endif
+#ifndef MATRIX_IO_DELAY
+#    define MATRIX_IO_DELAY 30
+#endif
+
 static matrix_row_t matrix_debouncing[MATRIX_ROWS];
 
 #define ERROR_DISCONNECT_COUNT 5
@@ -74,17 +72,31 @@ static uint8_t error_count = 0;
 static const uint8_t row_pins[MATRIX_ROWS] = MATRIX_ROW_PINS;
 static const uint8_t col_pins[MATRIX_COLS] = MATRIX_COL_PINS;
 
+/* A run of pins on the same port, where the port bits follow the matrix
+ * index order, so that the whole run is read with one PINx access and a shift.
+ */
+typedef struct {
+    uint8_t port;  /* PINx I/O address */
+    uint8_t bit;   /* port bit of the first pin */
+    uint8_t mask;  /* one bit per pin in the run, starting at bit 0 */
+    uint8_t index; /* matrix index of the first pin */
+} pin_run_t;
+
 /* matrix state(1:on, 0:off) */
 static matrix_row_t matrix[MATRIX_ROWS];
 static matrix_row_t matrix_debouncing[MATRIX_ROWS];
 
 #if (DIODE_DIRECTION == COL2ROW)
+    static pin_run_t col_runs[MATRIX_COLS];
+    static uint8_t col_run_count;
     static void init_cols(void);
     static bool read_cols_on_row(matrix_row_t current_matrix[], uint8_t current_row);
     static void unselect_rows(void);
     static void select_row(uint8_t row);
     static void unselect_row(uint8_t row);
 #elif (DIODE_DIRECTION == ROW2COL)
+    static pin_run_t row_runs[ROWS_PER_HAND];
+    static uint8_t row_run_count;
     static void init_rows(void);
     static bool read_rows_on_col(matrix_row_t current_matrix[], uint8_t current_col);
     static void unselect_cols(void);
@@ -92,6 +104,8 @@ static matrix_row_t matrix_debouncing[MATRIX_ROWS];
     static void select_col(uint8_t col);
 #endif
 
+static void split_sync_setup(void);
+
 __attribute__ ((weak))
 void matrix_init_kb(void) {
     matrix_init_user();
@@ -110,6 +124,11 @@ __attribute__ ((weak))
 void matrix_scan_user(void) {
 }
 
+__attribute__ ((weak))
+void matrix_io_delay(void) {
+    wait_us(MATRIX_IO_DELAY);
+}
+
 __attribute__ ((weak))
 void matrix_slave_scan_user(void) {
 }
@@ -151,7 +170,11 @@ void matrix_init(void)
         matrix[i] = 0;
         matrix_debouncing[i] = 0;
     }
-    
+
+    debounce_init(ROWS_PER_HAND);
+
+    split_sync_setup();
+
     matrix_init_quantum();
     
 }
@@ -159,144 +182,161 @@ void matrix_init(void)
 uint8_t _matrix_scan(void)
 {
     int offset = isLeftHand ? 0 : (ROWS_PER_HAND);
+    bool changed = false;
 #if (DIODE_DIRECTION == COL2ROW)
     // Set row, read cols
     for (uint8_t current_row = 0; current_row < ROWS_PER_HAND; current_row++) {
-#       if (DEBOUNCING_DELAY > 0)
-            bool matrix_changed = read_cols_on_row(matrix_debouncing+offset, current_row);
-
-            if (matrix_changed) {
-                debouncing = true;
-                debouncing_time = timer_read();
-            }
-
-#       else
-            read_cols_on_row(matrix+offset, current_row);
-#       endif
-
+        changed |= read_cols_on_row(matrix_debouncing+offset, current_row);
     }
-
 #elif (DIODE_DIRECTION == ROW2COL)
     // Set col, read rows
     for (uint8_t current_col = 0; current_col < MATRIX_COLS; current_col++) {
-#       if (DEBOUNCING_DELAY > 0)
-            bool matrix_changed = read_rows_on_col(matrix_debouncing+offset, current_col);
-            if (matrix_changed) {
-                debouncing = true;
-                debouncing_time = timer_read();
-            }
-#       else
-             read_rows_on_col(matrix+offset, current_col);
-#       endif
-
+        changed |= read_rows_on_col(matrix_debouncing+offset, current_col);
     }
 #endif
 
-#   if (DEBOUNCING_DELAY > 0)
-        if (debouncing && (timer_elapsed(debouncing_time) > DEBOUNCING_DELAY)) {
-            for (uint8_t i = 0; i < ROWS_PER_HAND; i++) {
-                matrix[i+offset] = matrix_debouncing[i+offset];
-            }
-            debouncing = false;
-        }
-#   endif
+    debounce(matrix_debouncing+offset, matrix+offset, ROWS_PER_HAND, changed);
 
     return 1;
 }
 
+/* The fields kept in sync with the other half, see split_sync.h. The master
+ * gets the rows of the slave, and sends the state of the lights.
+ */
+#ifdef BACKLIGHT_ENABLE
+static uint8_t split_backlight = 0;
+static uint8_t split_backlight_field;
+#endif
+#ifdef RGBLIGHT_ENABLE
+static uint32_t split_rgblight = 0;
+static uint8_t split_rgblight_field;
+#endif
+
+static void split_sync_setup(void)
+{
+    bool is_master = has_usb();
+    int slaveOffset = (isLeftHand == is_master) ? (ROWS_PER_HAND) : 0;
+    uint8_t *rows = (uint8_t *)&matrix[slaveOffset];
+
+    split_sync_init(is_master);
+    for (uint8_t i = 0; i < ROWS_PER_HAND * sizeof(matrix_row_t); i += SPLIT_SYNC_FIELD_MAX_SIZE) {
+        uint8_t size = ROWS_PER_HAND * sizeof(matrix_row_t) - i;
+        if (size > SPLIT_SYNC_FIELD_MAX_SIZE) {
+            size = SPLIT_SYNC_FIELD_MAX_SIZE;
+        }
+        split_sync_register(rows + i, size, SPLIT_SYNC_SLAVE_TO_MASTER);
+    }
+#ifdef BACKLIGHT_ENABLE
+    split_backlight_field = split_sync_register(&split_backlight, sizeof(split_backlight), SPLIT_SYNC_MASTER_TO_SLAVE);
+#endif
+#ifdef RGBLIGHT_ENABLE
+    split_rgblight_field = split_sync_register(&split_rgblight, sizeof(split_rgblight), SPLIT_SYNC_MASTER_TO_SLAVE);
+#endif
+}
+
+static uint8_t split_sync_build_master(uint8_t *buffer)
+{
+#ifdef BACKLIGHT_ENABLE
+    split_backlight = backlight_config.enable ? backlight_config.level : 0;
+#endif
+#ifdef RGBLIGHT_ENABLE
+    split_rgblight = rgblight_config.raw;
+#endif
+    return split_sync_build(buffer);
+}
+
+static void split_sync_apply_slave(void)
+{
+#ifdef BACKLIGHT_ENABLE
+    if (split_sync_updated(split_backlight_field)) {
+        backlight_set(split_backlight);
+    }
+#endif
+#ifdef RGBLIGHT_ENABLE
+    if (split_sync_updated(split_rgblight_field)) {
+        rgblight_update_dword(split_rgblight);
+    }
+#endif
+}
+
 #if defined(USE_I2C) || defined(EH)
 
-// Get rows from other half over i2c
+static uint8_t i2c_checksum(const uint8_t *data, uint8_t length)
+{
+    uint8_t checksum = length;
+    for (uint8_t i = 0; i < length; ++i) {
+        checksum += data[i];
+    }
+    return checksum;
+}
+
+// Exchanges a message with the other half over i2c. Each message is stored
+// with its length first and a checksum after it.
 int i2c_transaction(void) {
-    int slaveOffset = (isLeftHand) ? (ROWS_PER_HAND) : 0;
+    uint8_t buffer[SPLIT_SYNC_BUFFER_SIZE];
+    uint8_t length;
     int err = 0;
-    
-    // write backlight info
-    #ifdef BACKLIGHT_ENABLE
-        if (BACKLIT_DIRTY) {
-            err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_WRITE);
-            if (err) goto i2c_error;
-            
-            // Backlight location
-            err = i2c_master_write(I2C_BACKLIT_START);
-            if (err) goto i2c_error;
-            
-            // Write backlight 
-            i2c_master_write(get_backlight_level());
-            
-            BACKLIT_DIRTY = false;
-        }
-    #endif
 
     err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_WRITE);
     if (err) goto i2c_error;
 
-    // start of matrix stored at I2C_KEYMAP_START
-    err = i2c_master_write(I2C_KEYMAP_START);
+    // the message of the slave is read first, it's only replaced once the
+    // slave got the message of the master
+    err = i2c_master_write(I2C_SLAVE_MESSAGE_START);
     if (err) goto i2c_error;
 
     // Start read
     err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_READ);
     if (err) goto i2c_error;
 
-    if (!err) {
-        int i;
-        for (i = 0; i < ROWS_PER_HAND-1; ++i) {
-            matrix[slaveOffset+i] = i2c_master_read(I2C_ACK);
-        }
-        matrix[slaveOffset+i] = i2c_master_read(I2C_NACK);
-        i2c_master_stop();
-    } else {
-i2c_error: // the cable is disconnceted, or something else went wrong
-        i2c_reset_state();
-        return err;
+    length = i2c_master_read(I2C_ACK);
+    if (length > SPLIT_SYNC_BUFFER_SIZE) {
+        length = 0;
     }
-    
-    #ifdef RGBLIGHT_ENABLE
-        if (RGB_DIRTY) {
-            err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_WRITE);
-            if (err) goto i2c_error;
-            
-            // RGB Location
-            err = i2c_master_write(I2C_RGB_START);
-            if (err) goto i2c_error;
-            
-            uint32_t dword = eeconfig_read_rgblight();
-            
-            // Write RGB
-            err = i2c_master_write_data(&dword, 4);
-            if (err) goto i2c_error;
-            
-            RGB_DIRTY = false;
-            i2c_master_stop();
-        }
-    #endif
+    for (uint8_t i = 0; i < length; ++i) {
+        buffer[i] = i2c_master_read(I2C_ACK);
+    }
+    uint8_t checksum = i2c_master_read(I2C_NACK);
+    i2c_master_stop();
+
+    if (length && checksum == i2c_checksum(buffer, length)) {
+        split_sync_receive(buffer, length);
+    }
+
+    length = split_sync_build_master(buffer);
+    err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_WRITE);
+    if (err) goto i2c_error;
+
+    err = i2c_master_write(I2C_MASTER_MESSAGE_START);
+    if (err) goto i2c_error;
+
+    err = i2c_master_write(length);
+    if (err) goto i2c_error;
+
+    err = i2c_master_write_data(buffer, length);
+    if (err) goto i2c_error;
+
+    err = i2c_master_write(i2c_checksum(buffer, length));
+    if (err) goto i2c_error;
 
+    i2c_master_stop();
     return 0;
+
+i2c_error: // the cable is disconnceted, or something else went wrong
+    i2c_reset_state();
+    return err;
 }
 
 #else // USE_SERIAL
 
 int serial_transaction(void) {
-    int slaveOffset = (isLeftHand) ? (ROWS_PER_HAND) : 0;
+    serial_master_length = split_sync_build_master((uint8_t *)serial_master_buffer);
 
     if (serial_update_buffers()) {
         return 1;
     }
 
-    for (int i = 0; i < ROWS_PER_HAND; ++i) {
-        matrix[slaveOffset+i] = serial_slave_buffer[i];
-    }
-    
-    #ifdef RGBLIGHT_ENABLE
-        // Code to send RGB over serial goes here (not implemented yet)
-    #endif
-    
-    #ifdef BACKLIGHT_ENABLE
-        // Write backlight level for slave to read
-        serial_master_buffer[SERIAL_BACKLIT_START] = backlight_config.enable ? backlight_config.level : 0;
-    #endif
-
+    split_sync_receive((const uint8_t *)serial_slave_buffer, serial_slave_length);
     return 0;
 }
 #endif
@@ -319,6 +359,8 @@ uint8_t matrix_scan(void)
             for (int i = 0; i < ROWS_PER_HAND; ++i) {
                 matrix[slaveOffset+i] = 0;
             }
+            // and send everything again once it's back
+            split_sync_reset();
         }
     } else {
         error_count = 0;
@@ -328,25 +370,72 @@ uint8_t matrix_scan(void)
 }
 
 void matrix_slave_scan(void) {
-    _matrix_scan();
+    uint8_t buffer[SPLIT_SYNC_BUFFER_SIZE];
+    uint8_t length;
 
-    int offset = (isLeftHand) ? 0 : ROWS_PER_HAND;
+    _matrix_scan();
 
 #if defined(USE_I2C) || defined(EH)
-    for (int i = 0; i < ROWS_PER_HAND; ++i) {
-        i2c_slave_buffer[I2C_KEYMAP_START+i] = matrix[offset+i];
-    }   
+    // The master reads the message of the slave, and then writes its own. So
+    // once the message of the master is here, the previous one of the slave
+    // was read, and can be replaced.
+    if (i2c_slave_has_message) {
+        cli();
+        length = i2c_slave_buffer[I2C_MASTER_MESSAGE_START];
+        if (length > SPLIT_SYNC_BUFFER_SIZE) {
+            length = 0;
+        }
+        for (uint8_t i = 0; i < length; ++i) {
+            buffer[i] = i2c_slave_buffer[I2C_MASTER_MESSAGE_START + 1 + i];
+        }
+        uint8_t checksum = i2c_slave_buffer[I2C_MASTER_MESSAGE_START + 1 + length];
+        i2c_slave_has_message = false;
+        sei();
+
+        if (length && checksum == i2c_checksum(buffer, length)) {
+            split_sync_receive(buffer, length);
+            split_sync_apply_slave();
+        }
+
+        length = split_sync_build(buffer);
+        cli();
+        i2c_slave_buffer[I2C_SLAVE_MESSAGE_START] = length;
+        for (uint8_t i = 0; i < length; ++i) {
+            i2c_slave_buffer[I2C_SLAVE_MESSAGE_START + 1 + i] = buffer[i];
+        }
+        i2c_slave_buffer[I2C_SLAVE_MESSAGE_START + 1 + length] = i2c_checksum(buffer, length);
+        sei();
+    }
 #else // USE_SERIAL
-    for (int i = 0; i < ROWS_PER_HAND; ++i) {
-        serial_slave_buffer[i] = matrix[offset+i];
+    if (serial_master_length) {
+        cli();
+        length = serial_master_length;
+        for (uint8_t i = 0; i < length; ++i) {
+            buffer[i] = serial_master_buffer[i];
+        }
+        serial_master_length = 0;
+        sei();
+
+        split_sync_receive(buffer, length);
+        split_sync_apply_slave();
+    }
+
+    // the transfers copy the whole message from an interrupt, so it's always
+    // up to date with the last scan
+    length = split_sync_build(buffer);
+    cli();
+    for (uint8_t i = 0; i < length; ++i) {
+        serial_slave_buffer[i] = buffer[i];
     }
+    serial_slave_length = length;
+    sei();
 #endif
     matrix_slave_scan_user();
 }
 
 bool matrix_is_modified(void)
 {
-    if (debouncing) return false;
+    if (debounce_active()) return false;
     return true;
 }
 
@@ -381,6 +470,47 @@ uint8_t matrix_key_count(void)
     return count;
 }
 
+#if (DIODE_DIRECTION == COL2ROW) || (DIODE_DIRECTION == ROW2COL)
+
+/* Groups the pins into runs, sorted by port so that each port is only read
+ * once per scan of a row or col. Returns the number of runs.
+ */
+static uint8_t init_pin_runs(pin_run_t runs[], const uint8_t pins[], uint8_t count)
+{
+    uint8_t run_count = 0;
+
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t port = pins[i] >> 4;
+        uint8_t bit = pins[i] & 0xF;
+
+        if (run_count > 0) {
+            pin_run_t *run = &runs[run_count - 1];
+            if (run->port == port && run->bit + bitpop(run->mask) == bit) {
+                run->mask = (run->mask << 1) | 1;
+                continue;
+            }
+        }
+        runs[run_count].port = port;
+        runs[run_count].bit = bit;
+        runs[run_count].mask = 1;
+        runs[run_count].index = i;
+        run_count++;
+    }
+
+    for (uint8_t i = 1; i < run_count; i++) {
+        pin_run_t run = runs[i];
+        uint8_t j = i;
+        for (; j > 0 && runs[j - 1].port > run.port; j--) {
+            runs[j] = runs[j - 1];
+        }
+        runs[j] = run;
+    }
+
+    return run_count;
+}
+
+#endif
+
 #if (DIODE_DIRECTION == COL2ROW)
 
 static void init_cols(void)
@@ -390,6 +520,8 @@ static void init_cols(void)
         _SFR_IO8((pin >> 4) + 1) &= ~_BV(pin & 0xF); // IN
         _SFR_IO8((pin >> 4) + 2) |=  _BV(pin & 0xF); // HI
     }
+
+    col_run_count = init_pin_runs(col_runs, col_pins, MATRIX_COLS);
 }
 
 static bool read_cols_on_row(matrix_row_t current_matrix[], uint8_t current_row)
@@ -402,17 +534,22 @@ static bool read_cols_on_row(matrix_row_t current_matrix[], uint8_t current_row)
 
     // Select row and wait for row selecton to stabilize
     select_row(current_row);
-    wait_us(30);
-
-    // For each col...
-    for(uint8_t col_index = 0; col_index < MATRIX_COLS; col_index++) {
-
-        // Select the col pin to read (active low)
-        uint8_t pin = col_pins[col_index];
-        uint8_t pin_state = (_SFR_IO8(pin >> 4) & _BV(pin & 0xF));
+    matrix_io_delay();
+
+    // For each run of col pins, the ports are sorted so each is read once
+    uint8_t port = 0;
+    uint8_t port_state = 0;
+    for(uint8_t run_index = 0; run_index < col_run_count; run_index++) {
+        const pin_run_t *run = &col_runs[run_index];
+
+        // Read the port (active low)
+        if (run_index == 0 || run->port != port) {
+            port = run->port;
+            port_state = ~_SFR_IO8(port);
+        }
 
-        // Populate the matrix row with the state of the col pin
-        current_matrix[current_row] |=  pin_state ? 0 : (ROW_SHIFTER << col_index);
+        // Populate the matrix row with the state of the col pins
+        current_matrix[current_row] |= (matrix_row_t)((port_state >> run->bit) & run->mask) << run->index;
     }
 
     // Unselect row
@@ -453,6 +590,8 @@ static void init_rows(void)
         _SFR_IO8((pin >> 4) + 1) &= ~_BV(pin & 0xF); // IN
         _SFR_IO8((pin >> 4) + 2) |=  _BV(pin & 0xF); // HI
     }
+
+    row_run_count = init_pin_runs(row_runs, row_pins, ROWS_PER_HAND);
 }
 
 static bool read_rows_on_col(matrix_row_t current_matrix[], uint8_t current_col)
@@ -461,31 +600,46 @@ static bool read_rows_on_col(matrix_row_t current_matrix[], uint8_t current_col)
 
     // Select col and wait for col selecton to stabilize
     select_col(current_col);
-    wait_us(30);
+    matrix_io_delay();
 
-    // For each row...
-    for(uint8_t row_index = 0; row_index < ROWS_PER_HAND; row_index++)
+    // For each run of row pins, the ports are sorted so each is read once
+    uint8_t port = 0;
+    uint8_t port_state = 0;
+    for(uint8_t run_index = 0; run_index < row_run_count; run_index++)
     {
+        const pin_run_t *run = &row_runs[run_index];
 
-        // Store last value of row prior to reading
-        matrix_row_t last_row_value = current_matrix[row_index];
-
-        // Check row pin state
-        if ((_SFR_IO8(row_pins[row_index] >> 4) & _BV(row_pins[row_index] & 0xF)) == 0)
-        {
-            // Pin LO, set col bit
-            current_matrix[row_index] |= (ROW_SHIFTER << current_col);
-        }
-        else
+        // Read the port (active low)
+        if (run_index == 0 || run->port != port)
         {
-            // Pin HI, clear col bit
-            current_matrix[row_index] &= ~(ROW_SHIFTER << current_col);
+            port = run->port;
+            port_state = ~_SFR_IO8(port);
         }
+        uint8_t pins_low = (port_state >> run->bit) & run->mask;
 
-        // Determine if the matrix changed state
-        if ((last_row_value != current_matrix[row_index]) && !(matrix_changed))
+        // For each row in the run...
+        uint8_t row_index = run->index;
+        for(uint8_t row_mask = run->mask; row_mask; row_mask >>= 1, pins_low >>= 1, row_index++)
         {
-            matrix_changed = true;
+            // Store last value of row prior to reading
+            matrix_row_t last_row_value = current_matrix[row_index];
+
+            if (pins_low & 1)
+            {
+                // Pin LO, set col bit
+                current_matrix[row_index] |= (ROW_SHIFTER << current_col);
+            }
+            else
+            {
+                // Pin HI, clear col bit
+                current_matrix[row_index] &= ~(ROW_SHIFTER << current_col);
+            }
+
+            // Determine if the matrix changed state
+            if (last_row_value != current_matrix[row_index])
+            {
+                matrix_changed = true;
+            }
         }
     }
 
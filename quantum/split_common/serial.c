@@ -12,14 +12,22 @@
 #include <stdbool.h>
 #include "serial.h"
 
-#ifndef USE_I2C
+#if !defined(USE_I2C) && !defined(SERIAL_USE_USART)
 
 // Serial pulse period in microseconds. Its probably a bad idea to lower this
-// value.
+// value, both halves need to use the same one.
+#ifndef SERIAL_DELAY
 #define SERIAL_DELAY 24
+#endif
+
+uint8_t volatile serial_slave_buffer[SERIAL_BUFFER_LENGTH] = {0};
+uint8_t volatile serial_slave_length = 0;
+uint8_t volatile serial_master_buffer[SERIAL_BUFFER_LENGTH] = {0};
+uint8_t volatile serial_master_length = 0;
 
-uint8_t volatile serial_slave_buffer[SERIAL_SLAVE_BUFFER_LENGTH] = {0};
-uint8_t volatile serial_master_buffer[SERIAL_MASTER_BUFFER_LENGTH] = {0};
+// The slave receives here first, so a corrupt message doesn't overwrite the
+// previous one
+static uint8_t receive_buffer[SERIAL_BUFFER_LENGTH];
 
 #define SLAVE_DATA_CORRUPT (1<<0)
 volatile uint8_t status = 0;
@@ -124,8 +132,12 @@ void serial_write_byte(uint8_t data) {
 ISR(SERIAL_PIN_INTERRUPT) {
   sync_send();
 
-  uint8_t checksum = 0;
-  for (int i = 0; i < SERIAL_SLAVE_BUFFER_LENGTH; ++i) {
+  // each message is sent with its length first
+  uint8_t length = serial_slave_length;
+  uint8_t checksum = length;
+  serial_write_byte(length);
+  sync_send();
+  for (int i = 0; i < length; ++i) {
     serial_write_byte(serial_slave_buffer[i]);
     sync_send();
     checksum += serial_slave_buffer[i];
@@ -139,11 +151,16 @@ ISR(SERIAL_PIN_INTERRUPT) {
   // read the middle of pulses
   _delay_us(SERIAL_DELAY/2);
 
-  uint8_t checksum_computed = 0;
-  for (int i = 0; i < SERIAL_MASTER_BUFFER_LENGTH; ++i) {
-    serial_master_buffer[i] = serial_read_byte();
+  length = serial_read_byte();
+  sync_send();
+  uint8_t checksum_computed = length;
+  if (length > SERIAL_BUFFER_LENGTH) {
+    length = SERIAL_BUFFER_LENGTH;
+  }
+  for (int i = 0; i < length; ++i) {
+    receive_buffer[i] = serial_read_byte();
     sync_send();
-    checksum_computed += serial_master_buffer[i];
+    checksum_computed += receive_buffer[i];
   }
   uint8_t checksum_received = serial_read_byte();
   sync_send();
@@ -153,17 +170,20 @@ ISR(SERIAL_PIN_INTERRUPT) {
   if ( checksum_computed != checksum_received ) {
     status |= SLAVE_DATA_CORRUPT;
   } else {
+    for (int i = 0; i < length; ++i) {
+      serial_master_buffer[i] = receive_buffer[i];
+    }
+    serial_master_length = length;
     status &= ~SLAVE_DATA_CORRUPT;
   }
 }
 
-inline
-bool serial_slave_DATA_CORRUPT(void) {
+bool serial_slave_data_corrupt(void) {
   return status & SLAVE_DATA_CORRUPT;
 }
 
-// Copies the serial_slave_buffer to the master and sends the
-// serial_master_buffer to the slave.
+// Copies the message in serial_slave_buffer to the master and sends the one
+// in serial_master_buffer to the slave.
 //
 // Returns:
 // 0 => no error
@@ -192,9 +212,15 @@ int serial_update_buffers(void) {
   // if the slave is present syncronize with it
   sync_recv();
 
-  uint8_t checksum_computed = 0;
   // receive data from the slave
-  for (int i = 0; i < SERIAL_SLAVE_BUFFER_LENGTH; ++i) {
+  uint8_t length = serial_read_byte();
+  sync_recv();
+  if (length > SERIAL_BUFFER_LENGTH) {
+    sei();
+    return 1;
+  }
+  uint8_t checksum_computed = length;
+  for (int i = 0; i < length; ++i) {
     serial_slave_buffer[i] = serial_read_byte();
     sync_recv();
     checksum_computed += serial_slave_buffer[i];
@@ -206,10 +232,14 @@ int serial_update_buffers(void) {
     sei();
     return 1;
   }
+  serial_slave_length = length;
 
-  uint8_t checksum = 0;
   // send data to the slave
-  for (int i = 0; i < SERIAL_MASTER_BUFFER_LENGTH; ++i) {
+  length = serial_master_length;
+  uint8_t checksum = length;
+  serial_write_byte(length);
+  sync_recv();
+  for (int i = 0; i < length; ++i) {
     serial_write_byte(serial_master_buffer[i]);
     sync_recv();
     checksum += serial_master_buffer[i];
@@ -3,6 +3,7 @@
 
 #include "config.h"
 #include <stdbool.h>
+#include "split_sync.h"
 
 /* TODO:  some defines for interrupt setup */
 #define SERIAL_PIN_DDR DDRD
@@ -11,15 +12,15 @@
 #define SERIAL_PIN_MASK _BV(PD0)
 #define SERIAL_PIN_INTERRUPT INT0_vect
 
-#define SERIAL_SLAVE_BUFFER_LENGTH MATRIX_ROWS/2
-#define SERIAL_MASTER_BUFFER_LENGTH 1
+#define SERIAL_BUFFER_LENGTH SPLIT_SYNC_BUFFER_SIZE
 
-// Address location defines 
-#define SERIAL_BACKLIT_START   0x00
-
-// Buffers for master - slave communication
-extern volatile uint8_t serial_slave_buffer[SERIAL_SLAVE_BUFFER_LENGTH];
-extern volatile uint8_t serial_master_buffer[SERIAL_MASTER_BUFFER_LENGTH];
+// Buffers for master - slave communication, each one holds a split_sync
+// message. On the slave serial_master_length is set when a message from the
+// master arrives, and has to be cleared once it's read.
+extern volatile uint8_t serial_slave_buffer[SERIAL_BUFFER_LENGTH];
+extern volatile uint8_t serial_slave_length;
+extern volatile uint8_t serial_master_buffer[SERIAL_BUFFER_LENGTH];
+extern volatile uint8_t serial_master_length;
 
 void serial_master_init(void);
 void serial_slave_init(void);
@@ -0,0 +1,252 @@
+/*
+ * Split keyboard transport using the hardware USART
+ *
+ * The whole exchange runs from the USART interrupts, so neither half ever
+ * disables interrupts, and the master doesn't wait for the slave during the
+ * scan. Uses USART1, RXD1 (D2) and TXD1 (D3) on the ATmega32U4.
+ *
+ * The master sends its message, and the slave answers with its own. Both
+ * frames start with a sync byte and the length of the message, and end with
+ * a checksum:
+ *
+ *   master: SYNC, serial_master_length, serial_master_buffer..., checksum
+ *   slave:  SYNC, serial_slave_length, serial_slave_buffer..., checksum
+ *
+ * The received message goes to a separate buffer first, and is only copied to
+ * serial_slave_buffer or serial_master_buffer when the checksum matches.
+ *
+ * In full duplex mode TXD1 of each half is connected to RXD1 of the other.
+ * With SERIAL_USART_HALF_DUPLEX, TXD1 and RXD1 of each half are connected
+ * together, and to the same pins of the other half, a single wire like the
+ * bit-banged transport. The transmitter only drives the line while a frame
+ * is sent, and the receiver is off meanwhile.
+ *
+ * Half duplex turnaround: the receiver gets the checksum in the middle of its
+ * stop bit, while the sender still drives the line until the end of that bit,
+ * and until its TX complete interrupt has run, which other interrupts (USB on
+ * the master) can delay by several microseconds. So before driving the line,
+ * each half waits SERIAL_USART_TURNAROUND_US: by default four bit times, 8 us
+ * at 500000 baud, plus 10 us for the interrupt latency of the other half. The
+ * slave waits in its receive interrupt, the master in serial_update_buffers,
+ * so an exchange takes about 36 us more than in full duplex.
+ */
+
+#ifndef F_CPU
+#define F_CPU 16000000
+#endif
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+#include <stdbool.h>
+#include "serial.h"
+#include "timer.h"
+
+#if defined(SERIAL_USE_USART) && !defined(USE_I2C)
+
+#ifndef SERIAL_USART_SPEED
+#define SERIAL_USART_SPEED 500000
+#endif
+
+// Milliseconds the master waits for the answer of the slave
+#ifndef SERIAL_USART_TIMEOUT
+#define SERIAL_USART_TIMEOUT 5
+#endif
+
+#ifndef SERIAL_USART_TURNAROUND_US
+#define SERIAL_USART_TURNAROUND_US (4000000UL / SERIAL_USART_SPEED + 10)
+#endif
+
+// Double speed mode, 8 samples per bit
+#define SERIAL_USART_UBRR ((F_CPU + 4UL * SERIAL_USART_SPEED) / (8UL * SERIAL_USART_SPEED) - 1)
+
+#if SERIAL_USART_UBRR > 4095
+#  error "SERIAL_USART_SPEED is too low"
+#endif
+
+#define SERIAL_SYNC 0xA5
+
+uint8_t volatile serial_slave_buffer[SERIAL_BUFFER_LENGTH] = {0};
+uint8_t volatile serial_slave_length = 0;
+uint8_t volatile serial_master_buffer[SERIAL_BUFFER_LENGTH] = {0};
+uint8_t volatile serial_master_length = 0;
+
+// The frame being sent, and the message being received
+static uint8_t tx_buffer[SERIAL_BUFFER_LENGTH + 3];
+static uint8_t rx_buffer[SERIAL_BUFFER_LENGTH];
+static volatile uint8_t tx_pos = 0;
+static uint8_t tx_length = 0;
+static volatile uint8_t rx_pos = 0;
+static uint8_t rx_length = 0;
+static uint8_t rx_checksum = 0;
+static bool is_master = false;
+
+enum {
+  TRANSFER_IDLE,
+  TRANSFER_BUSY,
+  TRANSFER_DONE,
+  TRANSFER_ERROR
+};
+static volatile uint8_t transfer_state = TRANSFER_IDLE;
+static uint16_t transfer_start = 0;
+
+#define SLAVE_DATA_CORRUPT (1<<0)
+static volatile uint8_t status = 0;
+
+static void serial_usart_init(void) {
+  UBRR1 = SERIAL_USART_UBRR;
+  UCSR1A = _BV(U2X1);
+  // 8 data bits, no parity, one stop bit
+  UCSR1C = _BV(UCSZ11) | _BV(UCSZ10);
+#ifdef SERIAL_USART_HALF_DUPLEX
+  // TXD1 is an input with pull-up while the transmitter is off
+  DDRD &= ~_BV(PD3);
+  PORTD |= _BV(PD3);
+  UCSR1B = _BV(RXCIE1) | _BV(RXEN1) | _BV(TXCIE1);
+#else
+  UCSR1B = _BV(RXCIE1) | _BV(RXEN1) | _BV(TXEN1);
+#endif
+  PORTD |= _BV(PD2);
+}
+
+void serial_master_init(void) {
+  is_master = true;
+  serial_usart_init();
+}
+
+void serial_slave_init(void) {
+  is_master = false;
+  serial_usart_init();
+}
+
+// Sends the frame in tx_buffer from the data register empty interrupt
+static void serial_send_frame(const volatile uint8_t *data, uint8_t length) {
+  uint8_t checksum = length;
+  tx_buffer[0] = SERIAL_SYNC;
+  tx_buffer[1] = length;
+  for (uint8_t i = 0; i < length; ++i) {
+    tx_buffer[i + 2] = data[i];
+    checksum += data[i];
+  }
+  tx_buffer[length + 2] = checksum;
+  tx_length = length + 3;
+  tx_pos = 0;
+#ifdef SERIAL_USART_HALF_DUPLEX
+  // let the other half release the line, see the top of the file
+  _delay_us(SERIAL_USART_TURNAROUND_US);
+  UCSR1B = (UCSR1B & ~(_BV(RXEN1) | _BV(RXCIE1))) | _BV(TXEN1);
+#endif
+  UCSR1B |= _BV(UDRIE1);
+}
+
+ISR(USART1_UDRE_vect) {
+  UDR1 = tx_buffer[tx_pos++];
+  if (tx_pos == tx_length) {
+    UCSR1B &= ~_BV(UDRIE1);
+  }
+}
+
+#ifdef SERIAL_USART_HALF_DUPLEX
+// Releases the line once the last byte is out, to listen to the other half
+ISR(USART1_TX_vect) {
+  UCSR1B = (UCSR1B & ~_BV(TXEN1)) | _BV(RXEN1) | _BV(RXCIE1);
+}
+#endif
+
+ISR(USART1_RX_vect) {
+  bool framing_error = UCSR1A & (_BV(FE1) | _BV(DOR1));
+  uint8_t data = UDR1;
+
+  if (framing_error) {
+    rx_pos = 0;
+    return;
+  }
+  if (rx_pos == 0) {
+    // waiting for the start of a frame
+    if (data == SERIAL_SYNC) {
+      rx_pos = 1;
+    }
+    return;
+  }
+  if (rx_pos == 1) {
+    if (data > SERIAL_BUFFER_LENGTH) {
+      rx_pos = 0;
+      return;
+    }
+    rx_length = data;
+    rx_checksum = data;
+    rx_pos = 2;
+    return;
+  }
+  if (rx_pos < rx_length + 2) {
+    rx_buffer[rx_pos - 2] = data;
+    rx_checksum += data;
+    rx_pos++;
+    return;
+  }
+
+  // the checksum ends the frame
+  rx_pos = 0;
+  bool valid = data == rx_checksum;
+  if (is_master) {
+    if (transfer_state == TRANSFER_BUSY) {
+      transfer_state = valid ? TRANSFER_DONE : TRANSFER_ERROR;
+    }
+  } else {
+    if (valid) {
+      for (uint8_t i = 0; i < rx_length; ++i) {
+        serial_master_buffer[i] = rx_buffer[i];
+      }
+      serial_master_length = rx_length;
+      status &= ~SLAVE_DATA_CORRUPT;
+    } else {
+      status |= SLAVE_DATA_CORRUPT;
+    }
+    serial_send_frame(serial_slave_buffer, serial_slave_length);
+  }
+}
+
+bool serial_slave_data_corrupt(void) {
+  return status & SLAVE_DATA_CORRUPT;
+}
+
+// Takes the answer to the previous transaction, and starts the next one.
+// Doesn't wait for the slave, its answer is read by the next call.
+//
+// Returns:
+// 0 => no error, the slave buffer is up to date or the slave is still answering
+// 1 => slave did not respond, or sent corrupt data
+int serial_update_buffers(void) {
+  int ret = 0;
+
+  switch (transfer_state) {
+    case TRANSFER_BUSY:
+      if (timer_elapsed(transfer_start) < SERIAL_USART_TIMEOUT) {
+        return 0;
+      }
+      // the slave is not there, or the frame got lost
+      UCSR1B &= ~_BV(RXCIE1);
+      transfer_state = TRANSFER_IDLE;
+      rx_pos = 0;
+      UCSR1B |= _BV(RXCIE1);
+      ret = 1;
+      break;
+    case TRANSFER_DONE:
+      // the interrupts are done with rx_buffer until the next frame is sent
+      for (uint8_t i = 0; i < rx_length; ++i) {
+        serial_slave_buffer[i] = rx_buffer[i];
+      }
+      serial_slave_length = rx_length;
+      break;
+    case TRANSFER_ERROR:
+      ret = 1;
+      break;
+  }
+
+  transfer_state = TRANSFER_BUSY;
+  transfer_start = timer_read();
+  serial_send_frame(serial_master_buffer, serial_master_length);
+  return ret;
+}
+
+#endif
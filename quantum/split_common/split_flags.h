@@ -1,20 +0,0 @@
-#ifndef SPLIT_FLAGS_H
-#define SPLIT_FLAGS_H
-
-#include <stdbool.h>
-#include <stdint.h>
-
-/** 
-* Global Flags
-**/
-
-//RGB Stuff
-extern volatile bool RGB_DIRTY;
-
-
-//Backlight Stuff
-extern volatile bool BACKLIT_DIRTY;
-
-
-
-#endif
\ No newline at end of file
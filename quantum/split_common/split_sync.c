@@ -0,0 +1,301 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Keeps registered fields in sync between the halves of a split keyboard,
+ * sending only the bytes that changed.
+ *
+ * A message starts with a header byte, the sequence number of the message in
+ * the high nibble, and the sequence number of the last message applied from
+ * the other half in the low nibble. It's followed by a record for each field
+ * that changed:
+ *
+ *   field id, bit mask of the changed bytes (fields bigger than a byte only),
+ *   the changed bytes
+ *
+ * When nothing changed the message is only the header, with a sequence number
+ * of 0. The sequence numbers of the messages with records go from 1 to 15.
+ *
+ * Each half keeps a snapshot of the fields it sends, what the latest message
+ * was built from. It gets a new sequence number whenever the fields change,
+ * and the bytes that changed are added to the dirty mask of their field. The
+ * messages contain every dirty byte, so a lost message only delays the
+ * changes, and the same message can be applied more than once. The masks are
+ * only cleared when the other half acknowledges the sequence number of the
+ * snapshot. A byte that changes back before that is still sent, since the
+ * other half may have applied the value in between.
+ *
+ * An acknowledgement of 0 means the other half has nothing, because it just
+ * started or lost the connection. The next messages then contain all the
+ * fields, marked with SPLIT_SYNC_FULL after the header, and only those are
+ * applied until the halves are in sync again. A full message with an
+ * acknowledgement of 0 is always applied, since the sequence numbers of a
+ * half that restarted begin again from 1.
+ */
+
+#include "split_sync.h"
+
+#if SPLIT_SYNC_MAX_FIELDS > 16
+#   error "SPLIT_SYNC_MAX_FIELDS has to be 16 or less"
+#endif
+
+#if SPLIT_SYNC_BUFFER_SIZE < 2 || SPLIT_SYNC_BUFFER_SIZE > 255
+#   error "SPLIT_SYNC_BUFFER_SIZE must be between 2 and 255"
+#endif
+
+#define SPLIT_SYNC_FULL 0xFF
+
+typedef struct {
+    uint8_t *data;
+    uint8_t size;
+    uint8_t direction;
+    /* offset of the snapshot in shadow */
+    uint8_t shadow;
+    /* bytes changed since the last acknowledged snapshot */
+    uint8_t dirty;
+} field_t;
+
+static field_t fields[SPLIT_SYNC_MAX_FIELDS];
+static uint8_t field_count = 0;
+static uint8_t shadow[SPLIT_SYNC_SHADOW_SIZE];
+static uint8_t shadow_used = 0;
+/* length of a message with all the fields, for each direction */
+static uint8_t full_length[2];
+static bool is_master = false;
+
+/* sequence number of the snapshot, 0 before the first one */
+static uint8_t tx_seq = 0;
+static bool acked_valid = false;
+/* the last acknowledgement from the other half */
+static uint8_t peer_ack = 0;
+/* sequence number of the last message applied, 0 when out of sync */
+static uint8_t rx_seq = 0;
+static uint16_t updated = 0;
+
+static bool is_sent(const field_t *field) {
+    return (field->direction == SPLIT_SYNC_MASTER_TO_SLAVE) == is_master;
+}
+
+static uint8_t count_bits(uint8_t mask) {
+    uint8_t count = 0;
+    for (; mask; mask &= mask - 1) {
+        count++;
+    }
+    return count;
+}
+
+void split_sync_init(bool master) {
+    is_master = master;
+    field_count = 0;
+    shadow_used = 0;
+    full_length[SPLIT_SYNC_MASTER_TO_SLAVE] = 2;
+    full_length[SPLIT_SYNC_SLAVE_TO_MASTER] = 2;
+    tx_seq = 0;
+    peer_ack = 0;
+    updated = 0;
+    split_sync_reset();
+}
+
+uint8_t split_sync_register(void *data, uint8_t size, split_sync_direction_t direction) {
+    uint8_t length = 1 + (size > 1) + size;
+
+    if (field_count == SPLIT_SYNC_MAX_FIELDS || size == 0 || size > SPLIT_SYNC_FIELD_MAX_SIZE) {
+        return SPLIT_SYNC_NO_FIELD;
+    }
+    if (full_length[direction] + length > SPLIT_SYNC_BUFFER_SIZE) {
+        return SPLIT_SYNC_NO_FIELD;
+    }
+
+    field_t *field = &fields[field_count];
+    field->data = data;
+    field->size = size;
+    field->direction = direction;
+    field->shadow = shadow_used;
+    field->dirty = 0;
+    if (is_sent(field)) {
+        if (shadow_used + size > SPLIT_SYNC_SHADOW_SIZE) {
+            return SPLIT_SYNC_NO_FIELD;
+        }
+        shadow_used += size;
+    }
+    full_length[direction] += length;
+    // the new field has to be sent
+    tx_seq = 0;
+    return field_count++;
+}
+
+/* Takes a new snapshot when the fields changed since the last one */
+static void take_snapshot(void) {
+    bool changed = tx_seq == 0;
+
+    for (uint8_t i = 0; i < field_count; i++) {
+        field_t *field = &fields[i];
+        if (!is_sent(field)) {
+            continue;
+        }
+        uint8_t *snapshot = &shadow[field->shadow];
+        for (uint8_t b = 0; b < field->size; b++) {
+            if (snapshot[b] != field->data[b]) {
+                snapshot[b] = field->data[b];
+                field->dirty |= 1 << b;
+                changed = true;
+            }
+        }
+    }
+    if (changed) {
+        // never reuse the number the other half still acknowledges
+        do {
+            tx_seq = tx_seq % 15 + 1;
+        } while (tx_seq == peer_ack);
+    }
+}
+
+uint8_t split_sync_build(uint8_t *buffer) {
+    uint8_t length = 1;
+
+    take_snapshot();
+    if (!acked_valid) {
+        buffer[length++] = SPLIT_SYNC_FULL;
+    }
+    for (uint8_t i = 0; i < field_count; i++) {
+        field_t *field = &fields[i];
+        if (!is_sent(field)) {
+            continue;
+        }
+        const uint8_t *snapshot = &shadow[field->shadow];
+        uint8_t mask = acked_valid ? field->dirty : (uint8_t)(0xFF >> (8 - field->size));
+        if (!mask) {
+            continue;
+        }
+        buffer[length++] = i;
+        if (field->size > 1) {
+            buffer[length++] = mask;
+        }
+        for (uint8_t b = 0; b < field->size; b++) {
+            if (mask & (1 << b)) {
+                buffer[length++] = snapshot[b];
+            }
+        }
+    }
+    buffer[0] = ((length > 1) ? tx_seq << 4 : 0) | rx_seq;
+    return length;
+}
+
+/* Checks that the records only contain fields sent by the other half, and
+ * that they fit in the message
+ */
+static bool validate_records(const uint8_t *buffer, uint8_t pos, uint8_t length) {
+    while (pos < length) {
+        uint8_t id = buffer[pos++];
+        if (id >= field_count || is_sent(&fields[id])) {
+            return false;
+        }
+        uint8_t size = fields[id].size;
+        uint8_t mask = 1;
+        if (size > 1) {
+            if (pos == length) {
+                return false;
+            }
+            mask = buffer[pos++];
+            if (!mask || (size < 8 && (mask >> size))) {
+                return false;
+            }
+        }
+        uint8_t count = count_bits(mask);
+        if (count > length - pos) {
+            return false;
+        }
+        pos += count;
+    }
+    return true;
+}
+
+/* Writes the fields, and marks the ones that changed as updated. A full
+ * message marks all of them, the other half could have had other values
+ * before it started.
+ */
+static void apply_records(const uint8_t *buffer, uint8_t pos, uint8_t length, bool full) {
+    while (pos < length) {
+        uint8_t id = buffer[pos++];
+        field_t *field = &fields[id];
+        uint8_t mask = (field->size > 1) ? buffer[pos++] : 1;
+        if (full) {
+            updated |= 1 << id;
+        }
+        for (uint8_t b = 0; b < field->size; b++) {
+            if ((mask & (1 << b)) && field->data[b] != buffer[pos++]) {
+                field->data[b] = buffer[pos - 1];
+                updated |= 1 << id;
+            }
+        }
+    }
+}
+
+bool split_sync_receive(const uint8_t *buffer, uint8_t length) {
+    if (length == 0 || length > SPLIT_SYNC_BUFFER_SIZE) {
+        return false;
+    }
+    uint8_t seq = buffer[0] >> 4;
+    uint8_t ack = buffer[0] & 0x0F;
+    uint8_t pos = 1;
+    bool full = false;
+
+    if (length > 1 && seq == 0) {
+        return false;
+    }
+    if (pos < length && buffer[pos] == SPLIT_SYNC_FULL) {
+        full = true;
+        pos++;
+    }
+    if (!validate_records(buffer, pos, length)) {
+        return false;
+    }
+
+    peer_ack = ack;
+    if (ack == 0) {
+        acked_valid = false;
+        if (full) {
+            // the other half restarted, and its sequence numbers start over,
+            // so the last one applied no longer tells a duplicate apart
+            rx_seq = 0;
+        }
+    } else if (ack == tx_seq) {
+        for (uint8_t i = 0; i < field_count; i++) {
+            fields[i].dirty = 0;
+        }
+        acked_valid = true;
+    }
+
+    // the same message can arrive more than once, it's only applied once
+    if (length > 1 && seq != rx_seq && (full || rx_seq != 0)) {
+        apply_records(buffer, pos, length, full);
+        rx_seq = seq;
+    }
+    return true;
+}
+
+bool split_sync_updated(uint8_t field) {
+    if (field >= field_count || !(updated & (1 << field))) {
+        return false;
+    }
+    updated &= ~(1 << field);
+    return true;
+}
+
+void split_sync_reset(void) {
+    acked_valid = false;
+    rx_seq = 0;
+}
@@ -0,0 +1,74 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPLIT_SYNC_H
+#define SPLIT_SYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// The largest message in either direction, including its header
+#ifndef SPLIT_SYNC_BUFFER_SIZE
+#   define SPLIT_SYNC_BUFFER_SIZE 24
+#endif
+
+#ifndef SPLIT_SYNC_MAX_FIELDS
+#   define SPLIT_SYNC_MAX_FIELDS 8
+#endif
+
+// Bytes for the snapshots of the fields sent by this half
+#ifndef SPLIT_SYNC_SHADOW_SIZE
+#   define SPLIT_SYNC_SHADOW_SIZE 32
+#endif
+
+// The fields are sent a byte at a time, with a bit mask of the changed bytes
+#define SPLIT_SYNC_FIELD_MAX_SIZE 8
+
+#define SPLIT_SYNC_NO_FIELD 0xFF
+
+typedef enum {
+    SPLIT_SYNC_MASTER_TO_SLAVE,
+    SPLIT_SYNC_SLAVE_TO_MASTER
+} split_sync_direction_t;
+
+// Forgets all the fields, call before registering them
+void split_sync_init(bool is_master);
+
+// Registers a field kept in sync between the halves. The half it comes from
+// sends the bytes that changed, and the other half writes them to data. Both
+// halves have to register the same fields in the same order.
+// Returns the id of the field, or SPLIT_SYNC_NO_FIELD when it's bigger than
+// SPLIT_SYNC_FIELD_MAX_SIZE, or there's no room left for it.
+uint8_t split_sync_register(void *data, uint8_t size, split_sync_direction_t direction);
+
+// Writes the next message for the other half to buffer, which has room for
+// SPLIT_SYNC_BUFFER_SIZE bytes, and returns its length. A single byte when
+// nothing changed. Messages that get lost are harmless, the changes are sent
+// again until the other half acknowledges them.
+uint8_t split_sync_build(uint8_t *buffer);
+
+// Applies a message from the other half. Returns false, and ignores it, when
+// it's malformed.
+bool split_sync_receive(const uint8_t *buffer, uint8_t length);
+
+// Returns true, once, after a field was written by split_sync_receive
+bool split_sync_updated(uint8_t field);
+
+// Call when the connection to the other half was lost. The fields are sent
+// in full again, in both directions.
+void split_sync_reset(void);
+
+#endif
@@ -9,7 +9,6 @@
 #include "keyboard.h"
 #include "config.h"
 #include "timer.h"
-#include "split_flags.h"
 
 #ifdef RGBLIGHT_ENABLE
 #   include "rgblight.h"
@@ -60,10 +59,6 @@ static void keyboard_master_setup(void) {
 #else
   serial_master_init();
 #endif
-
-    // For master the Backlight info needs to be sent on startup
-    // Otherwise the salve won't start with the proper info until an update
-    BACKLIT_DIRTY = true;
 }
 
 static void keyboard_slave_setup(void) {
@@ -101,45 +96,8 @@ void keyboard_slave_loop(void) {
    #endif
 
    while (1) {
-    // Matrix Slave Scan
+    // Matrix Slave Scan, also gets the state of the lights from the master
     matrix_slave_scan();
-    
-    // Read Backlight Info
-    #ifdef BACKLIGHT_ENABLE
-        if (BACKLIT_DIRTY) {
-            #ifdef USE_I2C
-                backlight_set(i2c_slave_buffer[I2C_BACKLIT_START]);
-            #else // USE_SERIAL
-                backlight_set(serial_master_buffer[SERIAL_BACKLIT_START]);
-            #endif
-            BACKLIT_DIRTY = false;
-        }
-    #endif
-    // Read RGB Info
-    #ifdef RGBLIGHT_ENABLE
-        #ifdef USE_I2C
-            if (RGB_DIRTY) {
-                // Disable interupts (RGB data is big)
-                cli();
-                // Create new DWORD for RGB data
-                uint32_t dword; 
-                
-                // Fill the new DWORD with the data that was sent over
-                uint8_t *dword_dat = (uint8_t *)(&dword);
-                for (int i = 0; i < 4; i++) {
-                    dword_dat[i] = i2c_slave_buffer[I2C_RGB_START+i];
-                }
-                
-                // Update the RGB now with the new data and set RGB_DIRTY to false
-                rgblight_update_dword(dword);
-                RGB_DIRTY = false;
-                // Re-enable interupts now that RGB is set
-                sei();
-            }
-        #else // USE_SERIAL
-            // Add serial implementation for RGB here
-        #endif
-    #endif
    }
 }
 
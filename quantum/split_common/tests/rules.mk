@@ -0,0 +1,21 @@
+# Copyright 2018 QMK Contributors
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+SPLIT_COMMON_PATH := $(QUANTUM_PATH)/split_common
+
+split_sync_SRC := \
+	$(SPLIT_COMMON_PATH)/tests/split_sync_tests.cpp \
+	$(SPLIT_COMMON_PATH)/split_sync.c
@@ -0,0 +1,219 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include <vector>
+#include <string.h>
+
+extern "C" {
+#include "split_common/split_sync.h"
+}
+
+using testing::ElementsAre;
+
+// The master half, the messages of the slave are written by the tests
+class SplitSync : public ::testing::Test {
+public:
+    SplitSync() {
+        memset(matrix, 0, sizeof(matrix));
+        backlight = 0;
+        rgb = 0;
+        split_sync_init(true);
+        matrix_field = split_sync_register(matrix, sizeof(matrix), SPLIT_SYNC_SLAVE_TO_MASTER);
+        backlight_field = split_sync_register(&backlight, sizeof(backlight), SPLIT_SYNC_MASTER_TO_SLAVE);
+        rgb_field = split_sync_register(&rgb, sizeof(rgb), SPLIT_SYNC_MASTER_TO_SLAVE);
+    }
+
+    std::vector<uint8_t> build() {
+        uint8_t buffer[SPLIT_SYNC_BUFFER_SIZE];
+        uint8_t length = split_sync_build(buffer);
+        return std::vector<uint8_t>(buffer, buffer + length);
+    }
+
+    bool receive(std::vector<uint8_t> message) {
+        return split_sync_receive(message.data(), message.size());
+    }
+
+    // Acknowledges the last message of the master, without any records
+    void acknowledge(uint8_t seq) {
+        EXPECT_TRUE(receive({seq}));
+    }
+
+    uint8_t matrix[4];
+    uint8_t backlight;
+    uint32_t rgb;
+    uint8_t matrix_field;
+    uint8_t backlight_field;
+    uint8_t rgb_field;
+};
+
+TEST_F(SplitSync, FirstMessageContainsAllFields) {
+    backlight = 3;
+    rgb = 0x04030201;
+    EXPECT_THAT(build(), ElementsAre(0x10, 0xFF, backlight_field, 3, rgb_field, 0x0F, 1, 2, 3, 4));
+}
+
+TEST_F(SplitSync, MessageIsAHeartbeatWhenNothingChanged) {
+    build();
+    acknowledge(1);
+    EXPECT_THAT(build(), ElementsAre(0x00));
+}
+
+TEST_F(SplitSync, OnlyChangedBytesAreSent) {
+    build();
+    acknowledge(1);
+    rgb = 0x00AA0000;
+    EXPECT_THAT(build(), ElementsAre(0x20, rgb_field, 0x04, 0xAA));
+}
+
+TEST_F(SplitSync, ChangesAreSentUntilAcknowledged) {
+    build();
+    acknowledge(1);
+    backlight = 1;
+    EXPECT_THAT(build(), ElementsAre(0x20, backlight_field, 1));
+    // the message got lost, it's sent again together with the next change
+    EXPECT_THAT(build(), ElementsAre(0x20, backlight_field, 1));
+    rgb = 0x01;
+    EXPECT_THAT(build(), ElementsAre(0x30, backlight_field, 1, rgb_field, 0x01, 0x01));
+    // an acknowledgement of an older message doesn't help
+    acknowledge(2);
+    EXPECT_THAT(build(), ElementsAre(0x30, backlight_field, 1, rgb_field, 0x01, 0x01));
+    acknowledge(3);
+    EXPECT_THAT(build(), ElementsAre(0x00));
+}
+
+TEST_F(SplitSync, ChangeUndoneBeforeTheAcknowledgementIsSent) {
+    build();
+    acknowledge(1);
+    // a key pressed, and released before the slave acknowledged the press
+    backlight = 1;
+    EXPECT_THAT(build(), ElementsAre(0x20, backlight_field, 1));
+    backlight = 0;
+    EXPECT_THAT(build(), ElementsAre(0x30, backlight_field, 0));
+    // the slave applied the press, the release is still sent
+    acknowledge(2);
+    EXPECT_THAT(build(), ElementsAre(0x30, backlight_field, 0));
+    acknowledge(3);
+    EXPECT_THAT(build(), ElementsAre(0x00));
+}
+
+TEST_F(SplitSync, ReceivedFieldsAreWrittenAndMarkedUpdated) {
+    EXPECT_TRUE(receive({0x10, 0xFF, matrix_field, 0x0F, 1, 2, 3, 4}));
+    EXPECT_THAT(matrix, ElementsAre(1, 2, 3, 4));
+    EXPECT_TRUE(split_sync_updated(matrix_field));
+    EXPECT_FALSE(split_sync_updated(matrix_field));
+    EXPECT_FALSE(split_sync_updated(backlight_field));
+
+    EXPECT_TRUE(receive({0x20, matrix_field, 0x02, 9}));
+    EXPECT_THAT(matrix, ElementsAre(1, 9, 3, 4));
+    EXPECT_TRUE(split_sync_updated(matrix_field));
+    // the next message acknowledges the one applied
+    EXPECT_EQ(build()[0] & 0x0F, 2);
+}
+
+TEST_F(SplitSync, SameMessageIsOnlyAppliedOnce) {
+    build();
+    EXPECT_TRUE(receive({0x11, 0xFF, matrix_field, 0x0F, 1, 2, 3, 4}));
+    split_sync_updated(matrix_field);
+    matrix[0] = 0;
+    EXPECT_TRUE(receive({0x11, 0xFF, matrix_field, 0x0F, 1, 2, 3, 4}));
+    EXPECT_EQ(matrix[0], 0);
+    EXPECT_FALSE(split_sync_updated(matrix_field));
+}
+
+TEST_F(SplitSync, MasterRestartsWhileTheSlaveKeepsItsState) {
+    // this test is the slave
+    split_sync_init(false);
+    matrix_field = split_sync_register(matrix, sizeof(matrix), SPLIT_SYNC_SLAVE_TO_MASTER);
+    backlight_field = split_sync_register(&backlight, sizeof(backlight), SPLIT_SYNC_MASTER_TO_SLAVE);
+    rgb_field = split_sync_register(&rgb, sizeof(rgb), SPLIT_SYNC_MASTER_TO_SLAVE);
+    EXPECT_TRUE(receive({0x10, 0xFF, backlight_field, 3, rgb_field, 0x0F, 0, 0, 0, 0}));
+    EXPECT_EQ(backlight, 3);
+    EXPECT_EQ(build()[0] & 0x0F, 1);
+    // the master restarts, and its first message has the same number
+    EXPECT_TRUE(receive({0x10, 0xFF, backlight_field, 5, rgb_field, 0x0F, 0, 0, 0, 0}));
+    EXPECT_EQ(backlight, 5);
+    EXPECT_TRUE(split_sync_updated(backlight_field));
+    EXPECT_EQ(build()[0] & 0x0F, 1);
+}
+
+TEST_F(SplitSync, ChangesAreIgnoredUntilAFullMessage) {
+    EXPECT_TRUE(receive({0x20, matrix_field, 0x02, 9}));
+    EXPECT_THAT(matrix, ElementsAre(0, 0, 0, 0));
+    EXPECT_EQ(build()[0] & 0x0F, 0);
+    EXPECT_TRUE(receive({0x30, 0xFF, matrix_field, 0x0F, 1, 2, 3, 4}));
+    EXPECT_THAT(matrix, ElementsAre(1, 2, 3, 4));
+}
+
+TEST_F(SplitSync, ResetAsksForAFullMessage) {
+    EXPECT_TRUE(receive({0x10, 0xFF, matrix_field, 0x0F, 1, 2, 3, 4}));
+    build();
+    acknowledge(0x11);
+    EXPECT_THAT(build(), ElementsAre(0x01));
+
+    split_sync_reset();
+    EXPECT_THAT(build(), ElementsAre(0x10, 0xFF, backlight_field, 0, rgb_field, 0x0F, 0, 0, 0, 0));
+    EXPECT_TRUE(receive({0x10, 0xFF, matrix_field, 0x0F, 1, 2, 3, 4}));
+    EXPECT_EQ(build()[0] & 0x0F, 1);
+}
+
+TEST_F(SplitSync, FieldsAreSentInFullWhenTheOtherHalfRestarts) {
+    build();
+    acknowledge(1);
+    EXPECT_THAT(build(), ElementsAre(0x00));
+    acknowledge(0);
+    EXPECT_THAT(build(), ElementsAre(0x10, 0xFF, backlight_field, 0, rgb_field, 0x0F, 0, 0, 0, 0));
+}
+
+TEST_F(SplitSync, SequenceNumberSkipsTheLastAcknowledgement) {
+    build();
+    acknowledge(1);
+    for (uint8_t i = 0; i < 15; i++) {
+        backlight++;
+        uint8_t seq = build()[0] >> 4;
+        EXPECT_NE(seq, 0);
+        EXPECT_NE(seq, 1);
+    }
+}
+
+TEST_F(SplitSync, MalformedMessagesAreIgnored) {
+    EXPECT_FALSE(receive({}));
+    // a field sent by the master
+    EXPECT_FALSE(receive({0x10, 0xFF, backlight_field, 1}));
+    // an unknown field
+    EXPECT_FALSE(receive({0x10, 0xFF, 7, 1}));
+    // bytes past the end of the field
+    EXPECT_FALSE(receive({0x10, 0xFF, matrix_field, 0x10, 1}));
+    // truncated
+    EXPECT_FALSE(receive({0x10, 0xFF, matrix_field, 0x0F, 1, 2, 3}));
+    // records without a sequence number
+    EXPECT_FALSE(receive({0x00, 0xFF, matrix_field, 0x01, 1}));
+    EXPECT_THAT(matrix, ElementsAre(0, 0, 0, 0));
+}
+
+TEST_F(SplitSync, RegisterChecksTheLimits) {
+    uint8_t big[SPLIT_SYNC_FIELD_MAX_SIZE + 1];
+    EXPECT_EQ(split_sync_register(big, sizeof(big), SPLIT_SYNC_MASTER_TO_SLAVE), SPLIT_SYNC_NO_FIELD);
+    EXPECT_EQ(split_sync_register(big, 0, SPLIT_SYNC_MASTER_TO_SLAVE), SPLIT_SYNC_NO_FIELD);
+    // the fields sent by the master have to fit in a message
+    uint8_t registered = 0;
+    while (split_sync_register(big, SPLIT_SYNC_FIELD_MAX_SIZE, SPLIT_SYNC_MASTER_TO_SLAVE) != SPLIT_SYNC_NO_FIELD) {
+        registered++;
+    }
+    EXPECT_LT(registered, SPLIT_SYNC_MAX_FIELDS - 3);
+    EXPECT_LE(build().size(), (size_t)SPLIT_SYNC_BUFFER_SIZE);
+}
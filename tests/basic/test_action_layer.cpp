@@ -18,6 +18,7 @@
 
 using testing::_;
 using testing::Return;
+using testing::AnyNumber;
 
 class ActionLayer : public TestFixture {};
 
@@ -90,3 +91,57 @@ TEST_F(ActionLayer, LayerStateCmp) {
 //     layer_off(2);
 //     EXPECT_EQ(layer_state, 0b1000);
 // }
+
+TEST_F(ActionLayer, SwitchGetLayerReturnsTopmostNonTransparentLayer) {
+    TestDriver driver;
+    // Changing the layer state clears the keyboard
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+    keypos_t c = {.col = 0, .row = 3};
+    keypos_t d = {.col = 1, .row = 3};
+
+    EXPECT_EQ(layer_switch_get_layer(c), 0);
+    EXPECT_EQ(layer_switch_get_layer(d), 0);
+    layer_on(1);
+    EXPECT_EQ(layer_switch_get_layer(c), 1);
+    EXPECT_EQ(layer_switch_get_layer(d), 0);
+    layer_on(2);
+    EXPECT_EQ(layer_switch_get_layer(c), 2);
+    EXPECT_EQ(layer_switch_get_layer(d), 2);
+    layer_off(2);
+    EXPECT_EQ(layer_switch_get_layer(c), 1);
+    EXPECT_EQ(layer_switch_get_layer(d), 0);
+    layer_move(2);
+    EXPECT_EQ(layer_switch_get_layer(c), 2);
+    EXPECT_EQ(layer_switch_get_layer(d), 2);
+    layer_clear();
+    EXPECT_EQ(layer_switch_get_layer(c), 0);
+    EXPECT_EQ(layer_switch_get_layer(d), 0);
+}
+
+TEST_F(ActionLayer, SwitchGetLayerFollowsDefaultLayerAndDirectWrites) {
+    TestDriver driver;
+    // Changing the layer state clears the keyboard
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+    keypos_t c = {.col = 0, .row = 3};
+    uint32_t saved_default_layer_state = default_layer_state;
+
+    default_layer_set(1UL << 1);
+    EXPECT_EQ(layer_switch_get_layer(c), 1);
+    layer_state = 1UL << 2;
+    EXPECT_EQ(layer_switch_get_layer(c), 2);
+    layer_state = 0;
+    EXPECT_EQ(layer_switch_get_layer(c), 1);
+    default_layer_set(saved_default_layer_state);
+    EXPECT_EQ(layer_switch_get_layer(c), 0);
+}
+
+TEST_F(ActionLayer, KeyOnActiveLayerIsReported) {
+    TestDriver driver;
+    layer_on(1);
+    press_key(0, 3);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_E)));
+    keyboard_task();
+    release_key(0, 3);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    keyboard_task();
+}
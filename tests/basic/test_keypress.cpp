@@ -18,6 +18,7 @@
 
 using testing::_;
 using testing::Return;
+using testing::InSequence;
 
 class KeyPress : public TestFixture {};
 
@@ -39,19 +40,33 @@ TEST_F(KeyPress, CorrectKeyIsReportedWhenPressed) {
 
 TEST_F(KeyPress, CorrectKeysAreReportedWhenTwoKeysArePressed) {
     TestDriver driver;
+    InSequence s;
     press_key(1, 0);
     press_key(0, 3);
-    //Note that QMK only processes one key at a time
-    //See issue #1476 for more information
+    // All keys that changed during the scan are processed, in matrix order
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_B)));
-    keyboard_task();
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_B, KC_C)));
     keyboard_task();
     release_key(1, 0);
     release_key(0, 3);
     //Note that the first key released is the first one in the matrix order
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_C)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    keyboard_task();
+}
+
+TEST_F(KeyPress, ReleasesAreProcessedBeforePressesInTheSameScan) {
+    TestDriver driver;
+    InSequence s;
+    press_key(1, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_B)));
     keyboard_task();
+    release_key(1, 0);
+    press_key(0, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_A)));
+    keyboard_task();
+    release_key(0, 0);
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
     keyboard_task();
 }
@@ -66,12 +81,12 @@ TEST_F(KeyPress, ANonMappedKeyDoesNothing) {
 
 TEST_F(KeyPress, LeftShiftIsReportedCorrectly) {
     TestDriver driver;
+    InSequence s;
     press_key(3, 0);
     press_key(0, 0);
     // Unfortunately modifiers are also processed in the wrong order
     // See issue #1476 for more information
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_A)));
-    keyboard_task();
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_A, KC_LSFT)));
     keyboard_task();
     release_key(0, 0);
@@ -84,24 +99,24 @@ TEST_F(KeyPress, LeftShiftIsReportedCorrectly) {
 
 TEST_F(KeyPress, PressLeftShiftAndControl) {
     TestDriver driver;
+    InSequence s;
     press_key(3, 0);
     press_key(5, 0);
     // Unfortunately modifiers are also processed in the wrong order
     // See issue #1476 for more information
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LSFT)));
-    keyboard_task();
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LSFT, KC_LCTRL)));
     keyboard_task();
 }
 
 TEST_F(KeyPress, LeftAndRightShiftCanBePressedAtTheSameTime) {
     TestDriver driver;
+    InSequence s;
     press_key(3, 0);
     press_key(4, 0);
     // Unfortunately modifiers are also processed in the wrong order
     // See issue #1476 for more information
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LSFT)));
-    keyboard_task();
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LSFT, KC_RSFT)));
     keyboard_task();
 }
@@ -121,4 +136,42 @@ TEST_F(KeyPress, RightShiftLeftControlAndCharWithTheSameKey) {
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_RSFT, KC_RCTRL)));
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
     keyboard_task();
-}
\ No newline at end of file
+}
+
+TEST_F(KeyPress, KeymapConfigChangesAreAppliedToTheNextPress) {
+    TestDriver driver;
+    press_key(5, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LCTRL)));
+    keyboard_task();
+    release_key(5, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    keyboard_task();
+    keymap_config.swap_control_capslock = true;
+    press_key(5, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_CAPSLOCK)));
+    keyboard_task();
+    release_key(5, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    keyboard_task();
+    keymap_config.swap_control_capslock = false;
+}
+
+TEST_F(KeyPress, ClearKeyboardResendsTheEmptyReport) {
+    TestDriver driver;
+    // The driver may have dropped the previous report, so outside of a
+    // transaction a repeated report still goes to the host
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    clear_keyboard();
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    clear_keyboard();
+}
+
+TEST_F(KeyPress, RepeatedReportsAreDroppedInATransaction) {
+    TestDriver driver;
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    clear_keyboard();
+    host_keyboard_begin();
+    clear_keyboard();
+    host_keyboard_commit();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+}
@@ -33,28 +33,23 @@ TEST_F(Macro, PlayASimpleMacro) {
         .AT_TIME(0);
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LSFT, KC_H)))
         .AT_TIME(0);
-    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LSFT)))
-        .AT_TIME(0);
+    // Without a wait or an interval the reports are merged when the host
+    // doesn't need to see the states in between, so the shift is released
+    // together with the H, and each release together with the next press
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()))
         .AT_TIME(0);
+    // But the release of shift can't be merged with the next press
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_E)))
         .AT_TIME(0);
-    // The macro system could actually skip these empty keyboard reports
-    // it should be enough to just send a report with the next key down
-    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()))
-        .AT_TIME(0);
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_L)))
         .AT_TIME(0);
+    // And the same key has to be released before it's pressed again
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()))
         .AT_TIME(0);
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_L)))
         .AT_TIME(0);
-    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()))
-        .AT_TIME(0);
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_O)))
         .AT_TIME(0);
-    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()))
-        .AT_TIME(0);
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_SPACE)))
         .AT_TIME(0);
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()))
@@ -63,8 +58,6 @@ TEST_F(Macro, PlayASimpleMacro) {
         .AT_TIME(100);
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LSFT, KC_W)))
         .AT_TIME(100);
-    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LSFT)))
-        .AT_TIME(100);
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()))
         .AT_TIME(100);
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_O)))
@@ -0,0 +1,129 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+
+extern "C" {
+#include "quantum.h"
+}
+
+using testing::_;
+using testing::InSequence;
+
+class SendStringAsync : public TestFixture {};
+
+TEST_F(SendStringAsync, TypesOneReportPerScan) {
+    TestDriver driver;
+    InSequence s;
+    send_string_async("ab");
+    EXPECT_TRUE(send_string_async_active());
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(0);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_A)));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+    // The release of a is sent together with the press of b
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_B)));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+    EXPECT_FALSE(send_string_async_active());
+}
+
+TEST_F(SendStringAsync, ConsecutiveCapitalsShareShift) {
+    TestDriver driver;
+    InSequence s;
+    send_string_async_P("ABc");
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LSFT)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LSFT, KC_A)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LSFT, KC_B)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_C)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    idle_for(10);
+    EXPECT_FALSE(send_string_async_active());
+}
+
+TEST_F(SendStringAsync, RepeatedKeysAreReleasedInBetween) {
+    TestDriver driver;
+    InSequence s;
+    send_string_async_P("oo");
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_O)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_O)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    idle_for(10);
+}
+
+TEST_F(SendStringAsync, SupportsTapDownAndUp) {
+    TestDriver driver;
+    InSequence s;
+    send_string_async_P("A" SS_LCTRL("c") SS_TAP(X_ENTER));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LSFT)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LSFT, KC_A)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LCTL)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LCTL, KC_C)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LCTL)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_ENTER)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    idle_for(20);
+}
+
+TEST_F(SendStringAsync, KeepsScanningWhileTyping) {
+    TestDriver driver;
+    InSequence s;
+    send_string_async_P("c");
+    press_key(1, 0);
+    // The character and the key press go out in the same scan
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_C)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_B, KC_C)));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+    release_key(1, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_B)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+}
+
+TEST_F(SendStringAsync, LongerThanTheBuffer) {
+    TestDriver driver;
+    InSequence s;
+    // The reports sent while waiting for room are not checked here
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(testing::AnyNumber());
+    for (int i = 0; i < 5; i++) {
+        send_string_async("abcdefghijklmnopqrstuvwxyz");
+    }
+    idle_for(200);
+    EXPECT_FALSE(send_string_async_active());
+}
+
+TEST_F(SendStringAsync, SyncSendStringWaitsForAsync) {
+    TestDriver driver;
+    InSequence s;
+    send_string_async_P("a");
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_A)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_B)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    send_string("b");
+    EXPECT_FALSE(send_string_async_active());
+}
@@ -95,3 +95,37 @@ TEST_F(Tapping, ANewTapWithinTappingTermIsBuggy) {
     EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LSFT))).Times(1);
     idle_for(TAPPING_TERM);
 }
+
+TEST_F(Tapping, TypingMoreKeysThanFitInTheBufferHoldsTheTappingKey) {
+    TestDriver driver;
+    InSequence s;
+
+    press_key(7, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(0);
+    run_one_scan_loop();
+    // Each press and release waits for the tapping key to settle
+    for (int i = 0; i < WAITING_BUFFER_SIZE / 2; i++) {
+        press_key(i % 2, 0);
+        run_one_scan_loop();
+        release_key(i % 2, 0);
+        run_one_scan_loop();
+    }
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    // One more doesn't fit, so the tapping key is held, and nothing is lost
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LSFT)));
+    for (int i = 0; i < WAITING_BUFFER_SIZE / 2; i++) {
+        EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LSFT, i % 2 ? KC_B : KC_A)));
+        EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LSFT)));
+    }
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LSFT, KC_A)));
+    press_key(0, 0);
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    release_key(0, 0);
+    release_key(7, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LSFT)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    run_one_scan_loop();
+}
@@ -0,0 +1,55 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "quantum.h"
+
+// The benchmark scripts refer to keys by position, so don't rearrange them
+// without updating test_scan_benchmark.cpp and the baseline
+
+enum layers {
+    _BASE,
+    _NUM,
+    _NAV,
+    _FN,
+};
+
+const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
+    [_BASE] = {
+        // 0      1       2       3           4       5       6       7       8       9
+        {KC_A,    KC_B,   KC_C,   KC_D,       KC_E,   KC_F,   KC_G,   KC_H,   KC_I,   KC_J},
+        {KC_K,    KC_L,   KC_M,   KC_N,       KC_O,   KC_P,   KC_Q,   KC_R,   KC_S,   KC_T},
+        {KC_U,    KC_V,   KC_W,   KC_X,       KC_Y,   KC_Z,   KC_COMM,KC_DOT, KC_SLSH,KC_SCLN},
+        {KC_LSFT, KC_LCTL,MO(_NUM),LT(_NAV, KC_SPC),MO(_FN),KC_ENT,KC_BSPC,KC_TAB,KC_ESC, KC_RSFT},
+    },
+    [_NUM] = {
+        {KC_1,    KC_2,   KC_3,   KC_4,       KC_5,   KC_6,   KC_7,   KC_8,   KC_9,   KC_0},
+        {_______, _______,_______,_______,    _______,_______,_______,_______,_______,_______},
+        {_______, _______,_______,_______,    _______,_______,_______,_______,_______,_______},
+        {_______, _______,_______,_______,    _______,_______,_______,_______,_______,_______},
+    },
+    [_NAV] = {
+        {_______, _______,_______,_______,    _______,_______,_______,_______,_______,_______},
+        {KC_HOME, KC_PGDN,KC_PGUP,KC_END,     _______,KC_LEFT,KC_DOWN,KC_UP,  KC_RGHT,_______},
+        {_______, _______,_______,_______,    _______,_______,_______,_______,_______,_______},
+        {_______, _______,_______,_______,    _______,_______,_______,_______,_______,_______},
+    },
+    [_FN] = {
+        {_______, _______,_______,_______,    _______,_______,_______,_______,_______,_______},
+        {KC_F1,   KC_F2,  KC_F3,  KC_F4,      KC_F5,  KC_F6,  KC_F7,  KC_F8,  KC_F9,  KC_F10},
+        {_______, _______,_______,_______,    _______,_______,_______,_______,_______,_______},
+        {_______, _______,_______,_______,    _______,_______,_______,_______,_______,_______},
+    },
+};
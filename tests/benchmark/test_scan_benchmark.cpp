@@ -0,0 +1,98 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+#include "scan_benchmark.hpp"
+#include "action_tapping.h"
+
+class ScanLoopBenchmark : public TestFixture {
+protected:
+    void run(const std::string& name, const KeyScript& script, uint32_t repeat) {
+        ScanBenchmark benchmark;
+        BenchmarkResult result = benchmark.run(name, script, repeat);
+        ScanBenchmark::check_baseline(result, ScanBenchmark::baseline_next_to(__FILE__));
+    }
+};
+
+namespace
+{
+    const uint8_t letters[2][MATRIX_COLS] = {
+        {KC_A, KC_B, KC_C, KC_D, KC_E, KC_F, KC_G, KC_H, KC_I, KC_J},
+        {KC_K, KC_L, KC_M, KC_N, KC_O, KC_P, KC_Q, KC_R, KC_S, KC_T},
+    };
+    const uint8_t numbers[MATRIX_COLS] = {KC_1, KC_2, KC_3, KC_4, KC_5, KC_6, KC_7, KC_8, KC_9, KC_0};
+    const uint8_t fkeys[MATRIX_COLS] = {KC_F1, KC_F2, KC_F3, KC_F4, KC_F5, KC_F6, KC_F7, KC_F8, KC_F9, KC_F10};
+    const uint8_t nav[] = {KC_LEFT, KC_DOWN, KC_UP, KC_RGHT};
+    const uint8_t burst[] = {KC_U, KC_V, KC_W, KC_X, KC_Y, KC_Z};
+}
+
+// 100 letters at 15ms intervals, each held for 35ms so that up to three keys
+// are down at the same time
+TEST_F(ScanLoopBenchmark, FastTyping) {
+    KeyScript script;
+    for (uint32_t i=0; i<100; i++) {
+        uint8_t key = (i * 7) % 20;
+        script.tap(i * 15, 35, key % MATRIX_COLS, key / MATRIX_COLS, letters[key / MATRIX_COLS][key % MATRIX_COLS]);
+    }
+    run("fast_typing", script, 5);
+}
+
+// Six keys hitting the matrix in the same scan, followed by a shifted burst
+TEST_F(ScanLoopBenchmark, RolloverBurst) {
+    KeyScript script;
+    for (uint32_t i=0; i<10; i++) {
+        uint32_t t = i * 80;
+        for (uint8_t col=0; col<6; col++) {
+            script.tap(t, 40, col, 2, burst[col]);
+        }
+    }
+    script.press(800, 0, 3, KC_LSFT);
+    for (uint8_t col=0; col<5; col++) {
+        script.tap(810, 40, col, 0, letters[0][col]);
+    }
+    script.release(860, 0, 3, KC_LSFT);
+    run("rollover_burst", script, 5);
+}
+
+// Momentary layers stacked on top of each other, and a layer tap key used
+// both as a tap and a hold, so that most lookups fall through transparent keys
+TEST_F(ScanLoopBenchmark, LayerChords) {
+    KeyScript script;
+    uint32_t t = 0;
+    script.press(t, 2, 3);
+    for (uint8_t col=0; col<MATRIX_COLS; col++) {
+        script.tap(t + 10 + col * 20, 10, col, 0, numbers[col]);
+    }
+    t += 220;
+    script.press(t, 4, 3);
+    for (uint8_t col=0; col<MATRIX_COLS; col++) {
+        script.tap(t + 10 + col * 20, 10, col, 1, fkeys[col]);
+    }
+    t += 220;
+    script.release(t, 4, 3);
+    script.release(t, 2, 3);
+    t += 10;
+    script.press(t, 3, 3);
+    script.tap_on_release(t + 50, 3, 3, KC_SPC);
+    // Wait for the tap to expire, otherwise holding the key would repeat the tap
+    t += TAPPING_TERM + 100;
+    script.press(t, 3, 3);
+    for (uint8_t i=0; i<4; i++) {
+        script.tap(t + TAPPING_TERM + 10 + i * 20, 10, 5 + i, 1, nav[i]);
+    }
+    script.release(t + TAPPING_TERM + 100, 3, 3);
+    run("layer_chords", script, 5);
+}
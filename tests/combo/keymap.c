@@ -0,0 +1,74 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "quantum.h"
+
+// The tests refer to keys by position, so don't rearrange them
+
+const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
+    [0] = {
+        // 0    1      2      3      4      5      6      7      8      9
+        {KC_A,  KC_B,  KC_C,  KC_D,  KC_E,  KC_F,  KC_G,  KC_H,  KC_I,  KC_J},
+        {KC_K,  KC_L,  KC_M,  KC_N,  KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO},
+        {KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO},
+        {KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO},
+    },
+};
+
+enum combos {
+    AB_ESC,
+    DC_TAB,
+    EF_EVENT,
+    GH_DEL,
+    KL_1,
+    KLM_2,
+};
+
+// The keys are deliberately not in keycode order
+const uint16_t PROGMEM ab_combo[] = {KC_A, KC_B, COMBO_END};
+const uint16_t PROGMEM dc_combo[] = {KC_D, KC_C, COMBO_END};
+const uint16_t PROGMEM ef_combo[] = {KC_F, KC_E, COMBO_END};
+const uint16_t PROGMEM gh_combo[] = {KC_G, KC_H, COMBO_END};
+const uint16_t PROGMEM kl_combo[] = {KC_K, KC_L, COMBO_END};
+const uint16_t PROGMEM klm_combo[] = {KC_M, KC_L, KC_K, COMBO_END};
+// For combo_set_keys
+const uint16_t PROGMEM ji_combo[] = {KC_J, KC_I, COMBO_END};
+
+combo_t key_combos[COMBO_COUNT] = {
+    [AB_ESC] = COMBO(ab_combo, KC_ESC),
+    [DC_TAB] = COMBO(dc_combo, KC_TAB),
+    [EF_EVENT] = COMBO_ACTION(ef_combo),
+    [GH_DEL] = COMBO(gh_combo, KC_DEL),
+    [KL_1] = COMBO(kl_combo, KC_1),
+    [KLM_2] = COMBO(klm_combo, KC_2),
+};
+
+uint8_t combo_event_count = 0;
+uint8_t last_combo_event = 0xFF;
+bool last_combo_event_pressed = false;
+
+void process_combo_event(uint8_t combo_index, bool pressed) {
+    combo_event_count++;
+    last_combo_event = combo_index;
+    last_combo_event_pressed = pressed;
+}
+
+const macro_t *action_get_macro(keyrecord_t *record, uint8_t id, uint8_t opt) {
+    return MACRO_NONE;
+};
+
+void action_function(keyrecord_t *record, uint8_t id, uint8_t opt) {
+}
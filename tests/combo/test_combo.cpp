@@ -0,0 +1,341 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+
+using testing::_;
+using testing::InSequence;
+
+extern "C" {
+    extern uint8_t combo_event_count;
+    extern uint8_t last_combo_event;
+    extern bool last_combo_event_pressed;
+    extern const uint16_t ab_combo[];
+    extern const uint16_t ji_combo[];
+}
+
+class Combo : public TestFixture {};
+
+TEST_F(Combo, PressingAllKeysSendsTheCombo) {
+    TestDriver driver;
+    InSequence s;
+    press_key(0, 0);
+    press_key(1, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_ESC)));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    release_key(0, 0);
+    release_key(1, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+}
+
+TEST_F(Combo, KeysInAnyOrder) {
+    TestDriver driver;
+    InSequence s;
+    press_key(3, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(0);
+    idle_for(10);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    press_key(2, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_TAB)));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    release_key(2, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+    // The other key doesn't do anything on its own after the combo
+    release_key(3, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(0);
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+}
+
+TEST_F(Combo, TappingAComboKeySendsTheKey) {
+    TestDriver driver;
+    InSequence s;
+    press_key(0, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(0);
+    idle_for(10);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    release_key(0, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_A)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+}
+
+TEST_F(Combo, HoldingAComboKeyPressesItAfterTheTerm) {
+    TestDriver driver;
+    InSequence s;
+    press_key(1, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(0);
+    idle_for(COMBO_TERM);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_B)));
+    idle_for(2);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    // The other key waits for the combo again, but the held key can't
+    // complete it
+    press_key(0, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(0);
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    release_key(0, 0);
+    release_key(1, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_A, KC_B)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_B)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+}
+
+TEST_F(Combo, KeysOfDifferentCombosKeepTheirOrder) {
+    TestDriver driver;
+    InSequence s;
+    press_key(0, 0);
+    idle_for(10);
+    // C can't complete a combo with A, so A is pressed first
+    press_key(2, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_A)));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(0);
+    idle_for(COMBO_TERM - 1);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_A, KC_C)));
+    idle_for(2);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    release_key(0, 0);
+    release_key(2, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_C)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+}
+
+TEST_F(Combo, FastTypingThroughComboKeysKeepsTheOrder) {
+    TestDriver driver;
+    InSequence s;
+    press_key(0, 0);
+    run_one_scan_loop();
+    press_key(8, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_A)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_A, KC_I)));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    release_key(0, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_I)));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+    // A combo key pressed before the other one is released
+    press_key(1, 0);
+    run_one_scan_loop();
+    release_key(8, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_B, KC_I)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_B)));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    release_key(1, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+}
+
+TEST_F(Combo, TheLongerComboWins) {
+    TestDriver driver;
+    InSequence s;
+    press_key(0, 1);
+    press_key(1, 1);
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(0);
+    idle_for(10);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    press_key(2, 1);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_2)));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    release_key(0, 1);
+    release_key(1, 1);
+    release_key(2, 1);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+}
+
+TEST_F(Combo, TheShorterComboIsPressedAfterTheTerm) {
+    TestDriver driver;
+    InSequence s;
+    press_key(0, 1);
+    press_key(1, 1);
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(0);
+    idle_for(COMBO_TERM);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_1)));
+    idle_for(2);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    // Too late for the longer combo
+    press_key(2, 1);
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(0);
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    release_key(0, 1);
+    release_key(1, 1);
+    release_key(2, 1);
+    // The release ends the wait for a combo with the new key first
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_1, KC_M)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_M)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+}
+
+TEST_F(Combo, TheShorterComboIsPressedOnRelease) {
+    TestDriver driver;
+    InSequence s;
+    press_key(0, 1);
+    press_key(1, 1);
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(0);
+    idle_for(10);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    release_key(1, 1);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_1)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    release_key(0, 1);
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(0);
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+}
+
+TEST_F(Combo, AnotherKeyEndsTheWaitForTheLongerCombo) {
+    TestDriver driver;
+    InSequence s;
+    press_key(0, 1);
+    press_key(1, 1);
+    run_one_scan_loop();
+    press_key(3, 1);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_1)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_1, KC_N)));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    release_key(0, 1);
+    release_key(1, 1);
+    release_key(3, 1);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_N)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+}
+
+TEST_F(Combo, ComboActionCallsProcessComboEvent) {
+    TestDriver driver;
+    InSequence s;
+    uint8_t events = combo_event_count;
+    press_key(4, 0);
+    press_key(5, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(0);
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+    EXPECT_EQ(combo_event_count, events + 1);
+    EXPECT_EQ(last_combo_event, 2);
+    EXPECT_TRUE(last_combo_event_pressed);
+
+    release_key(4, 0);
+    release_key(5, 0);
+    run_one_scan_loop();
+    EXPECT_EQ(combo_event_count, events + 2);
+    EXPECT_EQ(last_combo_event, 2);
+    EXPECT_FALSE(last_combo_event_pressed);
+}
+
+TEST_F(Combo, CombosOutsideOfTheIndexWork) {
+    TestDriver driver;
+    InSequence s;
+    press_key(6, 0);
+    press_key(7, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_DEL)));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    release_key(6, 0);
+    release_key(7, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+}
+
+TEST_F(Combo, OtherKeysAreNotDelayed) {
+    TestDriver driver;
+    InSequence s;
+    press_key(8, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_I)));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+    release_key(8, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+}
+
+TEST_F(Combo, ChangedKeysAreUsed) {
+    TestDriver driver;
+    InSequence s;
+    combo_set_keys(0, ji_combo);
+    press_key(8, 0);
+    press_key(9, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_ESC)));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    release_key(8, 0);
+    release_key(9, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    // The old keys are no longer a combo
+    press_key(0, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_A)));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+    release_key(0, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+    combo_set_keys(0, ab_combo);
+}
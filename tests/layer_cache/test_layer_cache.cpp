@@ -0,0 +1,93 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+
+using testing::_;
+using testing::AnyNumber;
+
+extern "C" {
+    extern uint16_t layer_cache_dynamic_key;
+    extern uint16_t layer_cache_lookups;
+}
+
+class LayerCache : public TestFixture {
+public:
+    LayerCache() {
+        layer_cache_dynamic_key = KC_TRNS;
+        clear_layer_cache();
+    }
+};
+
+TEST_F(LayerCache, ReturnsTopmostNonTransparentLayer) {
+    TestDriver driver;
+    // Changing the layer state clears the keyboard
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+    keypos_t a = {.col = 0, .row = 0};
+    keypos_t b = {.col = 1, .row = 0};
+
+    EXPECT_EQ(layer_switch_get_layer(a), 0);
+    EXPECT_EQ(layer_switch_get_layer(b), 0);
+    layer_on(1);
+    EXPECT_EQ(layer_switch_get_layer(a), 1);
+    EXPECT_EQ(layer_switch_get_layer(b), 0);
+    layer_on(2);
+    EXPECT_EQ(layer_switch_get_layer(a), 2);
+    EXPECT_EQ(layer_switch_get_layer(b), 2);
+    layer_off(2);
+    EXPECT_EQ(layer_switch_get_layer(a), 1);
+    EXPECT_EQ(layer_switch_get_layer(b), 0);
+    layer_state = 1UL << 2;
+    EXPECT_EQ(layer_switch_get_layer(a), 2);
+    layer_clear();
+    EXPECT_EQ(layer_switch_get_layer(a), 0);
+    EXPECT_EQ(layer_switch_get_layer(b), 0);
+}
+
+TEST_F(LayerCache, OnlyLooksUpTheKeysThatAreUsed) {
+    TestDriver driver;
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+    keypos_t a = {.col = 0, .row = 0};
+
+    layer_cache_lookups = 0;
+    layer_on(2);
+    EXPECT_EQ(layer_cache_lookups, 0);
+    EXPECT_EQ(layer_switch_get_layer(a), 2);
+    uint16_t lookups = layer_cache_lookups;
+    EXPECT_GT(lookups, 0);
+    EXPECT_EQ(layer_switch_get_layer(a), 2);
+    EXPECT_EQ(layer_cache_lookups, lookups);
+}
+
+TEST_F(LayerCache, ClearPicksUpKeymapChanges) {
+    TestDriver driver;
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+    keypos_t b = {.col = 1, .row = 0};
+
+    layer_on(1);
+    EXPECT_EQ(layer_switch_get_layer(b), 0);
+    layer_cache_dynamic_key = KC_F;
+    EXPECT_EQ(layer_switch_get_layer(b), 0);
+    clear_layer_cache();
+    EXPECT_EQ(layer_switch_get_layer(b), 1);
+
+    press_key(1, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_F)));
+    keyboard_task();
+    release_key(1, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    keyboard_task();
+}
@@ -0,0 +1,51 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "quantum.h"
+
+// The tests refer to keys by position, so don't rearrange them
+
+const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
+    [0] = {
+        // 0      1      2      3      4      5      6      7      8      9
+        {KC_LEAD, KC_A,  KC_B,  KC_C,  KC_D,  KC_E,  KC_F,  KC_G,  KC_H,  KC_I},
+        {KC_NO,   KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO},
+        {KC_NO,   KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO},
+        {KC_NO,   KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO},
+    },
+};
+
+uint8_t leader_action_count = 0;
+
+static void leader_action(void) {
+    leader_action_count++;
+}
+
+// Deliberately not sorted
+LEADER_SEQUENCES(
+    LEADER_SEQ_KEY(KC_1, KC_A),
+    LEADER_SEQ_KEY(KC_2, KC_B, KC_C),
+    LEADER_SEQ_KEY(KC_3, KC_B),
+    LEADER_SEQ(leader_action, KC_D, KC_E, KC_F, KC_G, KC_H, KC_I),
+    LEADER_SEQ_KEY(KC_4, KC_B, KC_C, KC_D),
+);
+
+const macro_t *action_get_macro(keyrecord_t *record, uint8_t id, uint8_t opt) {
+    return MACRO_NONE;
+};
+
+void action_function(keyrecord_t *record, uint8_t id, uint8_t opt) {
+}
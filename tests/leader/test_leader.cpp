@@ -0,0 +1,125 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+
+using testing::AnyNumber;
+using testing::AtLeast;
+using testing::InSequence;
+
+extern "C" {
+    extern bool leading;
+    extern uint8_t leader_action_count;
+}
+
+class Leader : public TestFixture {
+protected:
+    void tap(uint8_t col) {
+        press_key(col, 0);
+        run_one_scan_loop();
+        release_key(col, 0);
+        run_one_scan_loop();
+    }
+};
+
+TEST_F(Leader, AUniqueSequenceFiresWithoutWaiting) {
+    TestDriver driver;
+    InSequence s;
+    // The releases pass through, but nothing is pressed
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport())).Times(AnyNumber());
+    tap(0);
+    EXPECT_TRUE(leading);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_1)));
+    // The release of the last key of the sequence sends the empty report again
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport())).Times(AtLeast(1));
+    tap(1);
+    EXPECT_FALSE(leading);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+}
+
+TEST_F(Leader, AnAmbiguousSequenceFiresAfterTheTimeout) {
+    TestDriver driver;
+    InSequence s;
+    // The releases pass through, but nothing is pressed
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport())).Times(AnyNumber());
+    tap(0);
+    tap(2);
+    idle_for(LEADER_TIMEOUT - 10);
+    EXPECT_TRUE(leading);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_3)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    idle_for(10);
+    EXPECT_FALSE(leading);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+}
+
+TEST_F(Leader, TheLongestSequenceFiresWhenItsComplete) {
+    TestDriver driver;
+    InSequence s;
+    // The releases pass through, but nothing is pressed
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport())).Times(AnyNumber());
+    tap(0);
+    tap(2);
+    tap(3);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_4)));
+    // The release of the last key of the sequence sends the empty report again
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport())).Times(AtLeast(1));
+    tap(4);
+    EXPECT_FALSE(leading);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+}
+
+TEST_F(Leader, ADeadPrefixEndsTheLeaderWithoutWaiting) {
+    TestDriver driver;
+    InSequence s;
+    // The releases pass through, but nothing is pressed
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport())).Times(AnyNumber());
+    tap(0);
+    tap(2);
+    tap(1);
+    EXPECT_FALSE(leading);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    // Keys work normally again
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_A)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    tap(1);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+}
+
+TEST_F(Leader, SequencesCanBeLongerThanFiveKeys) {
+    TestDriver driver;
+    InSequence s;
+    // The releases pass through, but nothing is pressed
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport())).Times(AnyNumber());
+    uint8_t count = leader_action_count;
+    tap(0);
+    for (uint8_t col = 4; col <= 8; col++) {
+        tap(col);
+    }
+    EXPECT_TRUE(leading);
+    EXPECT_EQ(leader_action_count, count);
+    tap(9);
+    EXPECT_FALSE(leading);
+    EXPECT_EQ(leader_action_count, count + 1);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+}
@@ -0,0 +1,89 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+
+extern "C" {
+#include "action_tapping.h"
+}
+
+using testing::_;
+using testing::InSequence;
+
+class TappingPerKey : public TestFixture {};
+
+TEST_F(TappingPerKey, HoldingAKeyWithAShorterTappingTerm) {
+    TestDriver driver;
+    InSequence s;
+
+    press_key(1, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(0);
+    idle_for(99);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+    // The timeout is only seen by the next scan
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LCTL)));
+    idle_for(2);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+    release_key(1, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    run_one_scan_loop();
+}
+
+TEST_F(TappingPerKey, KeysWithoutATermInTheTableUseTappingTerm) {
+    TestDriver driver;
+    InSequence s;
+
+    press_key(0, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(0);
+    idle_for(TAPPING_TERM - 10);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+    release_key(0, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_P)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    run_one_scan_loop();
+}
+
+TEST_F(TappingPerKey, ALongTermActsAsPermissiveHold) {
+    TestDriver driver;
+    InSequence s;
+
+    press_key(2, 0);
+    run_one_scan_loop();
+    press_key(3, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(0);
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+    // Tapping another key settles the hold, without waiting for the term
+    release_key(3, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LALT)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LALT, KC_A)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_LALT)));
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+    release_key(2, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    run_one_scan_loop();
+}
+
+TEST_F(TappingPerKey, KeysOutsideOfTheMatrixUseTappingTerm) {
+    keyevent_t event = {};
+    event.key.row = MATRIX_ROWS;
+    event.key.col = 0;
+    EXPECT_EQ(get_tapping_term(event), TAPPING_TERM);
+    event.key.row = 0;
+    event.key.col = 255;
+    EXPECT_EQ(get_tapping_term(event), TAPPING_TERM);
+}
@@ -0,0 +1,295 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scan_benchmark.hpp"
+#include "gtest/gtest.h"
+#include "test_matrix.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+extern "C" {
+#include "keyboard.h"
+#include "keycode.h"
+#include "action.h"
+#include "action_tapping.h"
+    void advance_time(uint32_t ms);
+}
+
+ScanBenchmark* ScanBenchmark::m_this = nullptr;
+
+namespace
+{
+    // Uses the time stamp counter where available, otherwise nanoseconds
+    uint64_t read_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    bool report_has_code(const report_keyboard_t* report, uint8_t code) {
+        if (IS_MOD(code)) {
+            return report->mods & MOD_BIT(code);
+        }
+        for (size_t i=0; i<KEYBOARD_REPORT_KEYS; i++) {
+            if (report->keys[i] == code) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Nearest rank percentile of a sorted vector
+    uint32_t percentile(const std::vector<uint32_t>& sorted, unsigned pct) {
+        if (sorted.empty()) {
+            return 0;
+        }
+        size_t rank = (sorted.size() * pct + 99) / 100;
+        return sorted[rank ? rank - 1 : 0];
+    }
+
+    typedef std::map<std::string, std::map<std::string, uint32_t>> Baseline;
+
+    Baseline load_baseline(const std::string& file) {
+        Baseline baseline;
+        std::ifstream in(file);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            std::istringstream fields(line);
+            std::string name, metric;
+            uint32_t value;
+            if (fields >> name >> metric >> value) {
+                baseline[name][metric] = value;
+            }
+        }
+        return baseline;
+    }
+
+    void save_baseline(const std::string& file, const Baseline& baseline) {
+        std::ofstream out(file);
+        out << "# Scan loop benchmark baseline, see docs/unit_testing.md" << std::endl;
+        out << "# <scenario> <metric> <maximum value>" << std::endl;
+        for (auto& scenario: baseline) {
+            for (auto& metric: scenario.second) {
+                out << scenario.first << " " << metric.first << " " << metric.second << std::endl;
+            }
+        }
+    }
+}
+
+KeyScript& KeyScript::press(uint32_t time, uint8_t col, uint8_t row, uint8_t code) {
+    m_events.push_back(ScriptEvent{time, col, row, true, code, true});
+    return *this;
+}
+
+KeyScript& KeyScript::release(uint32_t time, uint8_t col, uint8_t row, uint8_t code) {
+    m_events.push_back(ScriptEvent{time, col, row, false, code, false});
+    return *this;
+}
+
+KeyScript& KeyScript::tap(uint32_t time, uint32_t hold, uint8_t col, uint8_t row, uint8_t code) {
+    press(time, col, row, code);
+    return release(time + hold, col, row, code);
+}
+
+KeyScript& KeyScript::tap_on_release(uint32_t time, uint8_t col, uint8_t row, uint8_t code) {
+    m_events.push_back(ScriptEvent{time, col, row, false, code, true});
+    return *this;
+}
+
+std::vector<ScriptEvent> KeyScript::events() const {
+    std::vector<ScriptEvent> result = m_events;
+    std::stable_sort(result.begin(), result.end(),
+        [](const ScriptEvent& lhs, const ScriptEvent& rhs) { return lhs.time < rhs.time; });
+    return result;
+}
+
+uint32_t KeyScript::duration() const {
+    uint32_t result = 0;
+    for (auto& e: m_events) {
+        result = std::max(result, e.time + 1);
+    }
+    return result;
+}
+
+ScanBenchmark::ScanBenchmark()
+    : m_driver{
+        &ScanBenchmark::keyboard_leds,
+        &ScanBenchmark::send_keyboard,
+        &ScanBenchmark::send_mouse,
+        &ScanBenchmark::send_system,
+        &ScanBenchmark::send_consumer
+    },
+    m_previous_driver(host_get_driver()),
+    m_scan(0),
+    m_reports(0)
+{
+    host_set_driver(&m_driver);
+    m_this = this;
+}
+
+ScanBenchmark::~ScanBenchmark() {
+    host_set_driver(m_previous_driver);
+    m_this = nullptr;
+}
+
+BenchmarkResult ScanBenchmark::run(const std::string& name, const KeyScript& script, uint32_t repeat) {
+    const std::vector<ScriptEvent> events = script.events();
+    // Leave enough time after each repetition for all tapping keys to resolve
+    const uint32_t period = script.duration() + TAPPING_TERM + 10;
+    uint64_t cycles = 0;
+    std::chrono::steady_clock::duration elapsed{};
+    uint32_t num_events = 0;
+
+    m_scan = 0;
+    m_reports = 0;
+    m_pending.clear();
+    m_latencies.clear();
+
+    for (uint32_t r=0; r<repeat; r++) {
+        size_t next = 0;
+        for (uint32_t t=0; t<period; t++) {
+            for (; next < events.size() && events[next].time == t; next++) {
+                const ScriptEvent& e = events[next];
+                if (e.pressed) {
+                    press_key(e.col, e.row);
+                } else {
+                    release_key(e.col, e.row);
+                }
+                num_events++;
+                if (e.code) {
+                    m_pending.push_back(Pending{m_scan, e.code, e.present});
+                }
+            }
+            auto start_time = std::chrono::steady_clock::now();
+            uint64_t start_cycles = read_cycles();
+            keyboard_task();
+            cycles += read_cycles() - start_cycles;
+            elapsed += std::chrono::steady_clock::now() - start_time;
+            m_scan++;
+            advance_time(1);
+        }
+    }
+
+    std::sort(m_latencies.begin(), m_latencies.end());
+    double seconds = std::chrono::duration<double>(elapsed).count();
+
+    BenchmarkResult result;
+    result.name = name;
+    result.scans = m_scan;
+    result.events = num_events;
+    result.reports = m_reports;
+    result.unresolved = m_pending.size();
+
+    result.cycles_per_scan = m_scan ? (double)cycles / m_scan : 0;
+    result.events_per_second = seconds > 0 ? num_events / seconds : 0;
+    result.latency_p50 = percentile(m_latencies, 50);
+    result.latency_p99 = percentile(m_latencies, 99);
+    result.latency_max = m_latencies.empty() ? 0 : m_latencies.back();
+    return result;
+}
+
+void ScanBenchmark::check_baseline(const BenchmarkResult& result, const std::string& baseline_file) {
+    printf("[ BENCH    ] %s: %u scans, %u events, %u reports, %.0f cycles/scan, %.0f events/s, "
+        "latency p50 %u p99 %u max %u scans\n",
+        result.name.c_str(), result.scans, result.events, result.reports,
+        result.cycles_per_scan, result.events_per_second,
+        result.latency_p50, result.latency_p99, result.latency_max);
+
+    EXPECT_EQ(result.unresolved, 0u) << result.name << ": some key changes never reached the host";
+
+    // Only the deterministic metrics are part of the baseline, the cycle
+    // counts depend too much on the machine running the tests
+    std::map<std::string, uint32_t> measured = {
+        {"reports", result.reports},
+        {"latency_p50", result.latency_p50},
+        {"latency_p99", result.latency_p99},
+        {"latency_max", result.latency_max},
+    };
+
+    Baseline baseline = load_baseline(baseline_file);
+    const char* update = std::getenv("QMK_BENCHMARK_UPDATE_BASELINE");
+    if (update && update[0] == '1') {
+        baseline[result.name] = measured;
+        save_baseline(baseline_file, baseline);
+        return;
+    }
+
+    auto scenario = baseline.find(result.name);
+    if (scenario == baseline.end()) {
+        printf("[ BENCH    ] %s: no baseline in %s\n", result.name.c_str(), baseline_file.c_str());
+        return;
+    }
+    for (auto& metric: measured) {
+        auto expected = scenario->second.find(metric.first);
+        if (expected == scenario->second.end()) {
+            continue;
+        }
+        EXPECT_LE(metric.second, expected->second) << result.name << ": " << metric.first << " regressed";
+        if (metric.second < expected->second) {
+            printf("[ BENCH    ] %s: %s improved from %u to %u, consider updating the baseline\n",
+                result.name.c_str(), metric.first.c_str(), expected->second, metric.second);
+        }
+    }
+}
+
+std::string ScanBenchmark::baseline_next_to(const char* source_file) {
+    std::string path(source_file);
+    size_t slash = path.find_last_of('/');
+    if (slash == std::string::npos) {
+        return "baseline.txt";
+    }
+    return path.substr(0, slash + 1) + "baseline.txt";
+}
+
+uint8_t ScanBenchmark::keyboard_leds(void) {
+    return 0;
+}
+
+void ScanBenchmark::send_keyboard(report_keyboard_t* report) {
+    m_this->m_reports++;
+    auto& pending = m_this->m_pending;
+    for (auto it = pending.begin(); it != pending.end();) {
+        if (report_has_code(report, it->code) == it->present) {
+            m_this->m_latencies.push_back(m_this->m_scan - it->scan);
+            it = pending.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ScanBenchmark::send_mouse(report_mouse_t* report) {
+}
+
+void ScanBenchmark::send_system(uint16_t data) {
+}
+
+void ScanBenchmark::send_consumer(uint16_t data) {
+}
@@ -0,0 +1,107 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "host.h"
+
+// A single change of the emulated matrix.
+// The change is considered delivered when the first keyboard report is sent
+// where the presence of `code` matches `present`. Use a code of 0 for changes
+// that are not expected to produce a report on their own (layer keys, the
+// press of a dual-role key and so on).
+struct ScriptEvent {
+    uint32_t time;
+    uint8_t col;
+    uint8_t row;
+    bool pressed;
+    uint8_t code;
+    bool present;
+};
+
+class KeyScript {
+public:
+    // Press a key, expecting the code to appear in a report
+    KeyScript& press(uint32_t time, uint8_t col, uint8_t row, uint8_t code = 0);
+    // Release a key, expecting the code to disappear from the reports
+    KeyScript& release(uint32_t time, uint8_t col, uint8_t row, uint8_t code = 0);
+    // Press and release a key, expecting the code on press
+    KeyScript& tap(uint32_t time, uint32_t hold, uint8_t col, uint8_t row, uint8_t code);
+    // Release a key, expecting the code to be sent as a tap on release
+    KeyScript& tap_on_release(uint32_t time, uint8_t col, uint8_t row, uint8_t code);
+
+    // Returns the events sorted by time, stable for events in the same scan
+    std::vector<ScriptEvent> events() const;
+    uint32_t duration() const;
+private:
+    std::vector<ScriptEvent> m_events;
+};
+
+struct BenchmarkResult {
+    std::string name;
+    uint32_t scans;
+    uint32_t events;
+    uint32_t reports;
+    uint32_t unresolved;
+    double cycles_per_scan;
+    double events_per_second;
+    // Latencies are measured in scan loops, which is the same as ms in the
+    // test environment
+    uint32_t latency_p50;
+    uint32_t latency_p99;
+    uint32_t latency_max;
+};
+
+// Drives keyboard_task through a KeyScript and measures how long it takes,
+// and how many scan loops it takes for each change to reach host_keyboard_send.
+// The results can be compared against a baseline file, stored next to the
+// keymap, so that regressions are caught per keymap.
+class ScanBenchmark {
+public:
+    ScanBenchmark();
+    ~ScanBenchmark();
+
+    BenchmarkResult run(const std::string& name, const KeyScript& script, uint32_t repeat = 1);
+
+    // Prints the result and checks the deterministic metrics against the
+    // baseline. Set QMK_BENCHMARK_UPDATE_BASELINE=1 in the environment to
+    // store the result as the new baseline instead.
+    static void check_baseline(const BenchmarkResult& result, const std::string& baseline_file);
+    static std::string baseline_next_to(const char* source_file);
+private:
+    static uint8_t keyboard_leds(void);
+    static void send_keyboard(report_keyboard_t* report);
+    static void send_mouse(report_mouse_t* report);
+    static void send_system(uint16_t data);
+    static void send_consumer(uint16_t data);
+
+    struct Pending {
+        uint32_t scan;
+        uint8_t code;
+        bool present;
+    };
+
+    host_driver_t m_driver;
+    host_driver_t* m_previous_driver;
+    uint32_t m_scan;
+    uint32_t m_reports;
+    std::vector<Pending> m_pending;
+    std::vector<uint32_t> m_latencies;
+    static ScanBenchmark* m_this;
+};
@@ -0,0 +1,54 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "quantum.h"
+
+// The tests refer to keys by position, so don't rearrange them
+
+const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
+    [0] = {
+        // 0      1       2       3        4       5     6      7      8      9
+        {KC_B,    KC_E,   KC_R,   KC_S,    KC_O,   KC_L, KC_T,  KC_P,  KC_I,  KC_H},
+        {KC_2,    KC_ENT, KC_SPC, KC_BSPC, KC_ESC, KC_X, KC_NO, KC_NO, KC_NO, KC_NO},
+        {KC_NO,   KC_NO,  KC_NO,  KC_NO,   KC_NO,  KC_NO, KC_NO, KC_NO, KC_NO, KC_NO},
+        {KC_NO,   KC_NO,  KC_NO,  KC_NO,   KC_NO,  KC_NO, KC_NO, KC_NO, KC_NO, KC_NO},
+    },
+};
+
+// Sorted, so that it's searched with binary search
+const qk_ucis_symbol_t ucis_symbol_table[] = UCIS_TABLE(
+    UCIS_SYM("beer", 0x1f37a),
+    UCIS_SYM("beers", 0x1f37b),
+    UCIS_SYM("bolt", 0x26a1),
+    UCIS_SYM("h2o", 0x2082),
+    UCIS_SYM("pi", 0x03c0)
+);
+
+// Only the hex digits of the symbols are typed, so that they are easy to check
+void qk_ucis_start_user(void) {
+}
+
+void unicode_input_start(void) {
+}
+
+void unicode_input_finish(void) {
+}
+
+const macro_t *action_get_macro(keyrecord_t *record, uint8_t id, uint8_t opt) {
+    return MACRO_NONE;
+};
+
+void action_function(keyrecord_t *record, uint8_t id, uint8_t opt) {
+}
@@ -0,0 +1,149 @@
+/* Copyright 2018 QMK Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test_common.hpp"
+#include <vector>
+
+using testing::_;
+using testing::AnyNumber;
+using testing::Invoke;
+
+extern "C" {
+    void qk_ucis_start(void);
+}
+
+class Ucis : public TestFixture {
+protected:
+    // Records the keys in the order they are pressed
+    void record(TestDriver& driver) {
+        EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber())
+            .WillRepeatedly(Invoke([this](const report_keyboard_t& report) {
+                for (size_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
+                    uint8_t key = report.keys[i];
+                    if (key && !has_key(m_last, key)) {
+                        m_pressed.push_back(key);
+                    }
+                }
+                m_last = report;
+            }));
+        m_last = report_keyboard_t{};
+    }
+
+    void tap(uint8_t col, uint8_t row) {
+        press_key(col, row);
+        run_one_scan_loop();
+        release_key(col, row);
+        run_one_scan_loop();
+    }
+
+    void type(std::vector<std::pair<uint8_t, uint8_t>> keys) {
+        for (auto& key: keys) {
+            tap(key.first, key.second);
+        }
+    }
+
+    std::vector<uint8_t> m_pressed;
+private:
+    static bool has_key(const report_keyboard_t& report, uint8_t key) {
+        for (size_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
+            if (report.keys[i] == key) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    report_keyboard_t m_last;
+};
+
+#define B {0, 0}
+#define E {1, 0}
+#define R {2, 0}
+#define S {3, 0}
+#define O {4, 0}
+#define L {5, 0}
+#define T {6, 0}
+#define P {7, 0}
+#define I {8, 0}
+#define H {9, 0}
+#define TWO {0, 1}
+#define ENT {1, 1}
+#define SPC {2, 1}
+#define BSPC {3, 1}
+#define ESC {4, 1}
+#define X {5, 1}
+
+typedef std::vector<uint8_t> Keys;
+
+TEST_F(Ucis, TypesTheSymbolAndErasesItsName) {
+    TestDriver driver;
+    record(driver);
+    qk_ucis_start();
+    type({P, I, ENT});
+    EXPECT_EQ(m_pressed, (Keys{KC_P, KC_I, KC_BSPC, KC_BSPC, KC_BSPC, KC_0, KC_3, KC_C, KC_0}));
+}
+
+TEST_F(Ucis, FindsASymbolThatStartsLongerOnes) {
+    TestDriver driver;
+    record(driver);
+    qk_ucis_start();
+    type({B, E, E, R, SPC});
+    EXPECT_EQ(m_pressed, (Keys{KC_B, KC_E, KC_E, KC_R, KC_BSPC, KC_BSPC, KC_BSPC, KC_BSPC, KC_BSPC,
+        KC_1, KC_F, KC_3, KC_7, KC_A}));
+
+    m_pressed.clear();
+    qk_ucis_start();
+    type({B, E, E, R, S, ENT});
+    EXPECT_EQ(m_pressed, (Keys{KC_B, KC_E, KC_E, KC_R, KC_S, KC_BSPC, KC_BSPC, KC_BSPC, KC_BSPC,
+        KC_BSPC, KC_BSPC, KC_1, KC_F, KC_3, KC_7, KC_B}));
+}
+
+TEST_F(Ucis, SymbolsCanContainDigits) {
+    TestDriver driver;
+    record(driver);
+    qk_ucis_start();
+    type({H, TWO, O, ENT});
+    EXPECT_EQ(m_pressed, (Keys{KC_H, KC_2, KC_O, KC_BSPC, KC_BSPC, KC_BSPC, KC_BSPC, KC_2, KC_0, KC_8, KC_2}));
+}
+
+TEST_F(Ucis, AnUnknownNameIsTypedBack) {
+    TestDriver driver;
+    record(driver);
+    qk_ucis_start();
+    type({B, O, X, ENT});
+    EXPECT_EQ(m_pressed, (Keys{KC_B, KC_O, KC_X, KC_BSPC, KC_BSPC, KC_BSPC, KC_BSPC, KC_B, KC_O, KC_X}));
+}
+
+TEST_F(Ucis, ABackspaceBringsBackTheSymbols) {
+    TestDriver driver;
+    record(driver);
+    qk_ucis_start();
+    type({B, X, BSPC, O, L, T, ENT});
+    EXPECT_EQ(m_pressed, (Keys{KC_B, KC_X, KC_BSPC, KC_O, KC_L, KC_T, KC_BSPC, KC_BSPC, KC_BSPC, KC_BSPC,
+        KC_BSPC, KC_2, KC_6, KC_A, KC_1}));
+}
+
+TEST_F(Ucis, EscapeErasesTheNameOnly) {
+    TestDriver driver;
+    record(driver);
+    qk_ucis_start();
+    type({P, I, ESC});
+    EXPECT_EQ(m_pressed, (Keys{KC_P, KC_I, KC_BSPC, KC_BSPC, KC_BSPC}));
+
+    // Keys work normally again
+    m_pressed.clear();
+    type({P});
+    EXPECT_EQ(m_pressed, (Keys{KC_P}));
+}
@@ -1,4 +1,5 @@
 #include <stdint.h>
+#include <string.h>
 #include "keyboard.h"
 #include "action.h"
 #include "util.h"
@@ -11,6 +12,29 @@
 #endif
 
 
+#if !defined(NO_ACTION_LAYER) && defined(LAYER_CACHE)
+/** \brief Layer Cache
+ *
+ * The topmost non-transparent layer of each key, for the layers in
+ * layer_cache_state. A key is only looked up when it's used, and its entry is
+ * dropped whenever the layer state changes, so that switching layers doesn't
+ * walk the whole keymap.
+ */
+static uint8_t layer_cache[MATRIX_ROWS][MATRIX_COLS];
+static uint8_t layer_cache_valid[(MATRIX_ROWS * MATRIX_COLS + 7) / 8];
+static uint32_t layer_cache_state = 0;
+
+/** \brief Clear the layer cache
+ *
+ * Needs to be called if the keymap itself is changed at runtime, for example
+ * by a keymap_key_to_keycode that doesn't read the static keymaps.
+ */
+void clear_layer_cache(void)
+{
+    memset(layer_cache_valid, 0, sizeof(layer_cache_valid));
+}
+#endif
+
 /** \brief Default Layer State
  */
 uint32_t default_layer_state = 0;
@@ -286,7 +310,8 @@ action_t store_or_get_action(bool pressed, keypos_t key)
 
 /** \brief Layer switch get layer
  *
- * FIXME: Needs docs
+ * Returns the topmost non-transparent layer of the key, from the layer cache
+ * when possible.
  */
 int8_t layer_switch_get_layer(keypos_t key)
 {
@@ -295,11 +320,34 @@ int8_t layer_switch_get_layer(keypos_t key)
     action.code = ACTION_TRANSPARENT;
 
     uint32_t layers = layer_state | default_layer_state;
+#ifdef LAYER_CACHE
+    const uint16_t key_number = key.col + (key.row * MATRIX_COLS);
+    const uint8_t key_mask = 1U << (key_number % 8);
+    const bool cached = key.row < MATRIX_ROWS && key.col < MATRIX_COLS;
+    if (cached) {
+        /* the layer state can also be written directly */
+        if (layers != layer_cache_state) {
+            clear_layer_cache();
+            layer_cache_state = layers;
+        }
+        if (layer_cache_valid[key_number / 8] & key_mask) {
+            return layer_cache[key.row][key.col];
+        }
+        layer_cache_valid[key_number / 8] |= key_mask;
+        /* fall back to layer 0 */
+        layer_cache[key.row][key.col] = 0;
+    }
+#endif
     /* check top layer first */
     for (int8_t i = 31; i >= 0; i--) {
         if (layers & (1UL<<i)) {
             action = action_for_key(i, key);
             if (action.code != ACTION_TRANSPARENT) {
+#ifdef LAYER_CACHE
+                if (cached) {
+                    layer_cache[key.row][key.col] = i;
+                }
+#endif
                 return i;
             }
         }
@@ -96,6 +96,13 @@ uint8_t read_source_layers_cache(keypos_t key);
 #endif
 action_t store_or_get_action(bool pressed, keypos_t key);
 
+/* topmost non-transparent layer of each key */
+#if !defined(NO_ACTION_LAYER) && defined(LAYER_CACHE)
+void clear_layer_cache(void);
+#else
+#define clear_layer_cache()
+#endif
+
 /* return the topmost non-transparent layer currently associated with key */
 int8_t layer_switch_get_layer(keypos_t key);
 
@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "action.h"
 #include "action_util.h"
 #include "action_macro.h"
+#include "host.h"
 #include "wait.h"
 
 #ifdef DEBUG_ACTION
@@ -39,6 +40,7 @@ void action_macro_play(const macro_t *macro_p)
     uint8_t interval = 0;
 
     if (!macro_p) return;
+    host_keyboard_begin();
     while (true) {
         switch (MACRO_READ()) {
             case KEY_DOWN:
@@ -64,7 +66,9 @@ void action_macro_play(const macro_t *macro_p)
             case WAIT:
                 MACRO_READ();
                 dprintf("WAIT(%u)\n", macro);
+                host_keyboard_commit();
                 { uint8_t ms = macro; while (ms--) wait_ms(1); }
+                host_keyboard_begin();
                 break;
             case INTERVAL:
                 interval = MACRO_READ();
@@ -80,10 +84,15 @@ void action_macro_play(const macro_t *macro_p)
                 break;
             case END:
             default:
+                host_keyboard_commit();
                 return;
         }
         // interval
-        { uint8_t ms = interval; while (ms--) wait_ms(1); }
+        if (interval) {
+            host_keyboard_commit();
+            { uint8_t ms = interval; while (ms--) wait_ms(1); }
+            host_keyboard_begin();
+        }
     }
 }
 #endif
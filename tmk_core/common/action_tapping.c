@@ -5,6 +5,7 @@
 #include "action_tapping.h"
 #include "keycode.h"
 #include "timer.h"
+#include "progmem.h"
 
 #ifdef DEBUG_ACTION
 #include "debug.h"
@@ -18,8 +19,27 @@
 #define IS_TAPPING_PRESSED()    (IS_TAPPING() && tapping_key.event.pressed)
 #define IS_TAPPING_RELEASED()   (IS_TAPPING() && !tapping_key.event.pressed)
 #define IS_TAPPING_KEY(k)       (IS_TAPPING() && KEYEQ(tapping_key.event.key, (k)))
-#define WITHIN_TAPPING_TERM(e)  (TIMER_DIFF_16(e.time, tapping_key.event.time) < TAPPING_TERM)
+#ifdef TAPPING_TERM_PER_KEY
+#   define GET_TAPPING_TERM(e)  get_tapping_term(e)
+#else
+#   define GET_TAPPING_TERM(e)  TAPPING_TERM
+#endif
+#define WITHIN_TAPPING_TERM(e)  (TIMER_DIFF_16(e.time, tapping_key.event.time) < GET_TAPPING_TERM(tapping_key.event))
+
+/* Settle the tapping key as held when another key is tapped while it's down */
+#if defined(PERMISSIVE_HOLD)
+#   define IS_PERMISSIVE_HOLD() true
+#elif defined(TAPPING_TERM_PER_KEY)
+#   define IS_PERMISSIVE_HOLD() (GET_TAPPING_TERM(tapping_key.event) >= 500)
+#else
+#   define IS_PERMISSIVE_HOLD() (TAPPING_TERM >= 500)
+#endif
 
+/* The waiting buffer is a ring of WAITING_BUFFER_SIZE records. head and tail
+ * run freely and are masked on access, so all entries can be used.
+ */
+#define WAITING_BUFFER_MASK     (WAITING_BUFFER_SIZE - 1)
+#define WAITING_BUFFER_AT(i)    waiting_buffer[(i) & WAITING_BUFFER_MASK]
 
 static keyrecord_t tapping_key = {};
 static keyrecord_t waiting_buffer[WAITING_BUFFER_SIZE] = {};
@@ -28,6 +48,7 @@ static uint8_t waiting_buffer_tail = 0;
 
 static bool process_tapping(keyrecord_t *record);
 static bool waiting_buffer_enq(keyrecord_t record);
+static void waiting_buffer_process(void);
 static void waiting_buffer_clear(void);
 static bool waiting_buffer_typed(keyevent_t event);
 static bool waiting_buffer_has_anykey_pressed(void);
@@ -36,6 +57,32 @@ static void debug_tapping_key(void);
 static void debug_waiting_buffer(void);
 
 
+#ifdef TAPPING_TERM_PER_KEY
+/** \brief Tapping term of a key
+ *
+ * Looks the key up in the tapping_terms table of the keymap. Override it to
+ * decide the term some other way.
+ */
+__attribute__ ((weak))
+uint16_t get_tapping_term(keyevent_t event)
+{
+    if (event.key.row >= MATRIX_ROWS || event.key.col >= MATRIX_COLS) {
+        return TAPPING_TERM;
+    }
+    uint16_t term = pgm_read_word(&tapping_terms[event.key.row][event.key.col]);
+    return term ? term : TAPPING_TERM;
+}
+#endif
+
+/** \brief Returns true while a tapping key or the waiting buffer is pending
+ *
+ * Both are only settled by the next event, so TICK has to keep coming.
+ */
+bool action_tapping_pending(void)
+{
+    return IS_TAPPING() || waiting_buffer_head != waiting_buffer_tail;
+}
+
 /** \brief Action Tapping Process
  *
  * FIXME: Needs doc
@@ -46,8 +93,19 @@ void action_tapping_process(keyrecord_t record)
         if (!IS_NOEVENT(record.event)) {
             debug("processed: "); debug_record(record); debug("\n");
         }
-    } else {
-        if (!waiting_buffer_enq(record)) {
+    } else if (!waiting_buffer_enq(record)) {
+        bool settled = false;
+        if (IS_TAPPING_PRESSED() && tapping_key.tap.count == 0) {
+            // Too many keys were typed for a tap, so the tapping key is held.
+            // That settles the keys waiting for it, and makes room for this one.
+            debug("OVERFLOW: SETTLE TAPPING KEY AS HOLD\n");
+            process_record(&tapping_key);
+            tapping_key = (keyrecord_t){};
+            debug_tapping_key();
+            waiting_buffer_process();
+            settled = waiting_buffer_enq(record);
+        }
+        if (!settled) {
             // clear all in case of overflow.
             debug("OVERFLOW: CLEAR ALL STATES\n");
             clear_keyboard();
@@ -60,17 +118,23 @@ void action_tapping_process(keyrecord_t record)
     if (!IS_NOEVENT(record.event) && waiting_buffer_head != waiting_buffer_tail) {
         debug("---- action_exec: process waiting_buffer -----\n");
     }
-    for (; waiting_buffer_tail != waiting_buffer_head; waiting_buffer_tail = (waiting_buffer_tail + 1) % WAITING_BUFFER_SIZE) {
-        if (process_tapping(&waiting_buffer[waiting_buffer_tail])) {
-            debug("processed: waiting_buffer["); debug_dec(waiting_buffer_tail); debug("] = ");
-            debug_record(waiting_buffer[waiting_buffer_tail]); debug("\n\n");
+    waiting_buffer_process();
+    if (!IS_NOEVENT(record.event)) {
+        debug("\n");
+    }
+}
+
+/** \brief Process the waiting buffer until an event has to wait again */
+static void waiting_buffer_process(void)
+{
+    for (; waiting_buffer_tail != waiting_buffer_head; waiting_buffer_tail++) {
+        if (process_tapping(&WAITING_BUFFER_AT(waiting_buffer_tail))) {
+            debug("processed: waiting_buffer["); debug_dec(waiting_buffer_tail & WAITING_BUFFER_MASK); debug("] = ");
+            debug_record(WAITING_BUFFER_AT(waiting_buffer_tail)); debug("\n\n");
         } else {
             break;
         }
     }
-    if (!IS_NOEVENT(record.event)) {
-        debug("\n");
-    }
 }
 
 
@@ -100,12 +164,11 @@ bool process_tapping(keyrecord_t *keyp)
                     // enqueue
                     return false;
                 }
-#if TAPPING_TERM >= 500 || defined PERMISSIVE_HOLD
                 /* Process a key typed within TAPPING_TERM
                  * This can register the key before settlement of tapping,
                  * useful for long TAPPING_TERM but may prevent fast typing.
                  */
-                else if (IS_RELEASED(event) && waiting_buffer_typed(event)) {
+                else if (IS_PERMISSIVE_HOLD() && IS_RELEASED(event) && waiting_buffer_typed(event)) {
                     debug("Tapping: End. No tap. Interfered by typing key\n");
                     process_record(&tapping_key);
                     tapping_key = (keyrecord_t){};
@@ -113,7 +176,6 @@ bool process_tapping(keyrecord_t *keyp)
                     // enqueue
                     return false;
                 }
-#endif
                 /* Process release event of a key pressed before tapping starts
                  * Without this unexpected repeating will occur with having fast repeating setting
                  * https://github.com/tmk/tmk_keyboard/issues/60
@@ -138,6 +200,20 @@ bool process_tapping(keyrecord_t *keyp)
                     process_record(keyp);
                     return true;
                 }
+#ifdef HOLD_ON_OTHER_KEY_PRESS
+                /* Settle the tapping key as held as soon as another key is
+                 * pressed, instead of waiting for that key to be released or
+                 * for the tapping term to pass.
+                 */
+                else if (event.pressed) {
+                    debug("Tapping: End. No tap. Other key pressed\n");
+                    process_record(&tapping_key);
+                    tapping_key = (keyrecord_t){};
+                    debug_tapping_key();
+                    // enqueue
+                    return false;
+                }
+#endif
                 else {
                     // set interrupted flag when other key preesed during tapping
                     if (event.pressed) {
@@ -303,13 +379,13 @@ bool waiting_buffer_enq(keyrecord_t record)
         return true;
     }
 
-    if ((waiting_buffer_head + 1) % WAITING_BUFFER_SIZE == waiting_buffer_tail) {
+    if ((uint8_t)(waiting_buffer_head - waiting_buffer_tail) == WAITING_BUFFER_SIZE) {
         debug("waiting_buffer_enq: Over flow.\n");
         return false;
     }
 
-    waiting_buffer[waiting_buffer_head] = record;
-    waiting_buffer_head = (waiting_buffer_head + 1) % WAITING_BUFFER_SIZE;
+    WAITING_BUFFER_AT(waiting_buffer_head) = record;
+    waiting_buffer_head++;
 
     debug("waiting_buffer_enq: "); debug_waiting_buffer();
     return true;
@@ -331,8 +407,8 @@ void waiting_buffer_clear(void)
  */
 bool waiting_buffer_typed(keyevent_t event)
 {
-    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = (i + 1) % WAITING_BUFFER_SIZE) {
-        if (KEYEQ(event.key, waiting_buffer[i].event.key) && event.pressed !=  waiting_buffer[i].event.pressed) {
+    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i++) {
+        if (KEYEQ(event.key, WAITING_BUFFER_AT(i).event.key) && event.pressed !=  WAITING_BUFFER_AT(i).event.pressed) {
             return true;
         }
     }
@@ -346,8 +422,8 @@ bool waiting_buffer_typed(keyevent_t event)
 __attribute__((unused))
 bool waiting_buffer_has_anykey_pressed(void)
 {
-    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = (i + 1) % WAITING_BUFFER_SIZE) {
-        if (waiting_buffer[i].event.pressed) return true;
+    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i++) {
+        if (WAITING_BUFFER_AT(i).event.pressed) return true;
     }
     return false;
 }
@@ -363,15 +439,15 @@ void waiting_buffer_scan_tap(void)
     // invalid state: tapping_key released && tap.count == 0
     if (!tapping_key.event.pressed) return;
 
-    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = (i + 1) % WAITING_BUFFER_SIZE) {
-        if (IS_TAPPING_KEY(waiting_buffer[i].event.key) &&
-                !waiting_buffer[i].event.pressed &&
-                WITHIN_TAPPING_TERM(waiting_buffer[i].event)) {
+    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i++) {
+        if (IS_TAPPING_KEY(WAITING_BUFFER_AT(i).event.key) &&
+                !WAITING_BUFFER_AT(i).event.pressed &&
+                WITHIN_TAPPING_TERM(WAITING_BUFFER_AT(i).event)) {
             tapping_key.tap.count = 1;
-            waiting_buffer[i].tap.count = 1;
+            WAITING_BUFFER_AT(i).tap.count = 1;
             process_record(&tapping_key);
 
-            debug("waiting_buffer_scan_tap: found at ["); debug_dec(i); debug("]\n");
+            debug("waiting_buffer_scan_tap: found at ["); debug_dec(i & WAITING_BUFFER_MASK); debug("]\n");
             debug_waiting_buffer();
             return;
         }
@@ -395,8 +471,8 @@ static void debug_tapping_key(void)
 static void debug_waiting_buffer(void)
 {
     debug("{ ");
-    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = (i + 1) % WAITING_BUFFER_SIZE) {
-        debug("["); debug_dec(i); debug("]="); debug_record(waiting_buffer[i]); debug(" ");
+    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i++) {
+        debug("["); debug_dec(i & WAITING_BUFFER_MASK); debug("]="); debug_record(WAITING_BUFFER_AT(i)); debug(" ");
     }
     debug("}\n");
 }
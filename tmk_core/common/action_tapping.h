@@ -31,11 +31,26 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define TAPPING_TOGGLE  5
 #endif
 
+/* number of key events that can wait for a tapping key to settle, a power of two */
+#ifndef WAITING_BUFFER_SIZE
 #define WAITING_BUFFER_SIZE 8
+#endif
+
+#if WAITING_BUFFER_SIZE < 2 || WAITING_BUFFER_SIZE > 128 || (WAITING_BUFFER_SIZE & (WAITING_BUFFER_SIZE - 1))
+#error "WAITING_BUFFER_SIZE must be a power of two between 2 and 128"
+#endif
 
 
 #ifndef NO_ACTION_TAPPING
 void action_tapping_process(keyrecord_t record);
+/* true while a tapping key or the events waiting for it need TICK to settle */
+bool action_tapping_pending(void);
+
+#ifdef TAPPING_TERM_PER_KEY
+/* tapping term of a key, 0 in the table means TAPPING_TERM */
+extern const uint16_t tapping_terms[MATRIX_ROWS][MATRIX_COLS];
+uint16_t get_tapping_term(keyevent_t event);
+#endif
 #endif
 
 #endif
@@ -43,7 +43,8 @@ __asm__ __volatile__ (  \
 
 /** \brief Suspend idle
  *
- * FIXME: needs doc
+ * Sleeps until the next interrupt. The timer interrupt wakes the MCU every
+ * ms, so this never sleeps longer than `time` ms.
  */
 void suspend_idle(uint8_t time)
 {
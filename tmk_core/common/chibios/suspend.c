@@ -14,10 +14,10 @@
 
 /** \brief suspend idle
  *
- * FIXME: needs doc
+ * Sleeps for `time` ms. The main thread is suspended, so the idle thread
+ * puts the MCU to sleep until the next interrupt.
  */
 void suspend_idle(uint8_t time) {
-	// TODO: this is not used anywhere - what units is 'time' in?
 	wait_ms(time);
 }
 
@@ -36,6 +36,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "quantum.h"
 #include "version.h"
 
+#ifdef SERIAL_LINK_ENABLE
+#include "serial_link/system/serial_link.h"
+#endif
+
 #ifdef MOUSEKEY_ENABLE
 #include "mousekey.h"
 #endif
@@ -257,6 +261,10 @@ static void print_status(void)
 #   if USB_COUNT_SOF
     print_val_hex8(usbSofCount);
 #   endif
+#endif
+
+#ifdef SERIAL_LINK_ENABLE
+    serial_link_print_statistics();
 #endif
 	return;
 }
@@ -16,8 +16,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include <stdint.h>
+#include <string.h>
 //#include <avr/interrupt.h>
 #include "keycode.h"
+#include "keycode_config.h"
 #include "host.h"
 #include "util.h"
 #include "debug.h"
@@ -26,10 +28,21 @@ static host_driver_t *driver;
 static uint16_t last_system_report = 0;
 static uint16_t last_consumer_report = 0;
 
+/* the last keyboard report given to the driver */
+static report_keyboard_t last_keyboard_report;
+static bool last_keyboard_report_valid = false;
+/* the keyboard report held back by an open transaction */
+static report_keyboard_t pending_keyboard_report;
+static bool keyboard_report_pending = false;
+static uint8_t keyboard_transaction_depth = 0;
+static uint16_t suppressed_keyboard_reports = 0;
+
 
 void host_set_driver(host_driver_t *d)
 {
     driver = d;
+    // a new host doesn't know what was sent before
+    last_keyboard_report_valid = false;
 }
 
 host_driver_t *host_get_driver(void)
@@ -42,21 +55,97 @@ uint8_t host_keyboard_leds(void)
     if (!driver) return 0;
     return (*driver->keyboard_leds)();
 }
-/* send report */
-void host_keyboard_send(report_keyboard_t *report)
+static void host_keyboard_flush(void)
 {
+    if (!keyboard_report_pending) return;
+    keyboard_report_pending = false;
+
     if (!driver) return;
-    (*driver->send_keyboard)(report);
+    last_keyboard_report = pending_keyboard_report;
+    last_keyboard_report_valid = true;
+    (*driver->send_keyboard)(&last_keyboard_report);
 
     if (debug_keyboard) {
         dprint("keyboard_report: ");
         for (uint8_t i = 0; i < KEYBOARD_REPORT_SIZE; i++) {
-            dprintf("%02X ", report->raw[i]);
+            dprintf("%02X ", last_keyboard_report.raw[i]);
         }
         dprint("\n");
     }
 }
 
+/* send report
+ *
+ * Inside a transaction the report is held back, and replaces the held back
+ * one when the host wouldn't miss a change that way, see
+ * keyboard_report_mergeable. A report that is the same as the previous one is
+ * only dropped inside a transaction. Outside of one it's sent again, as the
+ * driver may have dropped the previous one, for example while the host was
+ * suspended, and resending is how clear_keyboard() gets stuck keys released.
+ */
+void host_keyboard_send(report_keyboard_t *report)
+{
+    if (keyboard_report_pending) {
+        if (memcmp(report, &pending_keyboard_report, KEYBOARD_REPORT_SIZE) == 0) {
+            suppressed_keyboard_reports++;
+            return;
+        }
+        bool nkro = false;
+#ifdef NKRO_ENABLE
+        nkro = keyboard_protocol && keymap_config.nkro;
+#endif
+        if (last_keyboard_report_valid &&
+            keyboard_report_mergeable(&last_keyboard_report, &pending_keyboard_report, report, nkro)) {
+            suppressed_keyboard_reports++;
+        } else {
+            host_keyboard_flush();
+        }
+    } else if (keyboard_transaction_depth && last_keyboard_report_valid &&
+               memcmp(report, &last_keyboard_report, KEYBOARD_REPORT_SIZE) == 0) {
+        suppressed_keyboard_reports++;
+        return;
+    }
+
+    pending_keyboard_report = *report;
+    keyboard_report_pending = true;
+    if (!keyboard_transaction_depth) {
+        host_keyboard_flush();
+    }
+}
+
+/* Start a keyboard report transaction
+ *
+ * Until the matching host_keyboard_commit(), the keyboard reports are
+ * merged where the host doesn't need to see the states in between, so bulk
+ * output like send_string sends fewer reports. Transactions can be nested.
+ */
+void host_keyboard_begin(void)
+{
+    keyboard_transaction_depth++;
+}
+
+/* Finish a keyboard report transaction, sending the held back report */
+void host_keyboard_commit(void)
+{
+    if (keyboard_transaction_depth && --keyboard_transaction_depth) return;
+    host_keyboard_flush();
+}
+
+/* Returns false while a keyboard report sent now would have to wait for the
+ * host, so bulk output can be paced to the rate the host polls the endpoint
+ */
+bool host_keyboard_ready(void)
+{
+    if (!driver || !driver->keyboard_ready) return true;
+    return (*driver->keyboard_ready)();
+}
+
+/* the number of keyboard reports that were dropped or merged */
+uint16_t host_keyboard_suppressed_reports(void)
+{
+    return suppressed_keyboard_reports;
+}
+
 void host_mouse_send(report_mouse_t *report)
 {
     if (!driver) return;
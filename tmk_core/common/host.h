@@ -46,6 +46,12 @@ void host_consumer_send(uint16_t data);
 uint16_t host_last_system_report(void);
 uint16_t host_last_consumer_report(void);
 
+/* keyboard report transactions */
+void host_keyboard_begin(void);
+void host_keyboard_commit(void);
+uint16_t host_keyboard_suppressed_reports(void);
+bool host_keyboard_ready(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -31,6 +31,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "eeconfig.h"
 #include "backlight.h"
 #include "action_layer.h"
+#include "action_tapping.h"
+#include "action_util.h"
+#ifdef IDLE_SLEEP_ENABLE
+#   include "suspend.h"
+#endif
 #ifdef BOOTMAGIC_ENABLE
 #   include "bootmagic.h"
 #else
@@ -191,6 +196,178 @@ void keyboard_init(void) {
 #endif
 }
 
+/* Maximum number of key events processed in one scan.
+ * Changes that don't fit stay in the matrix diff, and are processed in the
+ * next scan, so nothing is lost.
+ */
+#ifndef QMK_KEYS_PER_SCAN
+#   define QMK_KEYS_PER_SCAN 16
+#endif
+
+static matrix_row_t matrix_prev[MATRIX_ROWS];
+static keyevent_t event_queue[QMK_KEYS_PER_SCAN];
+
+/** \brief Collect the changed matrix bits into the event queue
+ *
+ * All the events get the same timestamp, read once per scan. Releases are
+ * queued before presses, otherwise in matrix order, so that a roll from one key
+ * to the next within the same scan is processed in the order it was typed.
+ *
+ * Returns the number of queued events.
+ */
+static uint8_t keyboard_queue_events(void)
+{
+    uint8_t num_events = 0;
+    /* time should not be 0 */
+    uint16_t time = timer_read() | 1;
+
+    for (uint8_t pressed = 0; pressed < 2; pressed++) {
+        for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+            matrix_row_t matrix_row = matrix_get_row(r);
+            matrix_row_t matrix_change = matrix_row ^ matrix_prev[r];
+            matrix_change &= pressed ? matrix_row : ~matrix_row;
+            if (!matrix_change) {
+                continue;
+            }
+#ifdef MATRIX_HAS_GHOST
+            if (has_ghost_in_row(r, matrix_row)) {
+                /* Don't update matrix_prev until un-ghosted, or the last key
+                 * would be lost.
+                 */
+                continue;
+            }
+#endif
+            for (uint8_t c = 0; c < MATRIX_COLS; c++) {
+                if (matrix_change & ((matrix_row_t)1<<c)) {
+                    if (num_events >= QMK_KEYS_PER_SCAN) {
+                        return num_events;
+                    }
+                    event_queue[num_events++] = (keyevent_t){
+                        .key = (keypos_t){ .row = r, .col = c },
+                        .pressed = pressed,
+                        .time = time
+                    };
+                    // record a queued key
+                    matrix_prev[r] ^= ((matrix_row_t)1<<c);
+                }
+            }
+        }
+    }
+    return num_events;
+}
+
+#ifdef IDLE_SLEEP_ENABLE
+/* Time in ms without any key down before the scan loop starts sleeping.
+ * It doesn't sleep either while a tapping key, a one shot key, a combo or a
+ * leader sequence waits for its timeout, see keyboard_timers_pending.
+ */
+#   ifndef IDLE_SLEEP_TIMEOUT
+#       define IDLE_SLEEP_TIMEOUT 500
+#   endif
+
+static uint32_t last_activity = 0;
+static bool matrix_idle = false;
+
+/* quantum/matrix.c implements these. A custom or split matrix has to
+ * implement them too, otherwise a key always looks pressed, and every wakeup
+ * does a full scan.
+ */
+__attribute__ ((weak)) void matrix_idle_enter(void) {}
+__attribute__ ((weak)) bool matrix_idle_key_pressed(void) { return true; }
+__attribute__ ((weak)) void matrix_idle_exit(void) {}
+
+/** \brief keyboard_idle_user
+ *
+ * Return false to keep the scan loop running at full speed, for example
+ * while an animation driven from matrix_scan_user is running.
+ */
+__attribute__ ((weak))
+bool keyboard_idle_user(void) {
+    return true;
+}
+
+/** \brief keyboard_idle_kb
+ *
+ * Keyboard level version of keyboard_idle_user.
+ */
+__attribute__ ((weak))
+bool keyboard_idle_kb(void) {
+    return keyboard_idle_user();
+}
+
+/** \brief keyboard_idle_quantum
+ *
+ * Quantum level version, quantum.c checks the combos and the leader key.
+ */
+__attribute__ ((weak))
+bool keyboard_idle_quantum(void) {
+    return keyboard_idle_kb();
+}
+
+/* The timeouts settled by TICK, which isn't sent while sleeping */
+static bool keyboard_timers_pending(void)
+{
+#ifndef NO_ACTION_TAPPING
+    if (action_tapping_pending()) {
+        return true;
+    }
+#endif
+#if !defined(NO_ACTION_ONESHOT) && defined(ONESHOT_TIMEOUT) && (ONESHOT_TIMEOUT > 0)
+    if (get_oneshot_mods() ||
+        (get_oneshot_layer_state() && !(get_oneshot_layer_state() & ONESHOT_TOGGLED))) {
+        return true;
+    }
+#endif
+    return false;
+}
+
+static bool keyboard_keys_down(void)
+{
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        if (matrix_prev[r]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** \brief Sleep until the next interrupt when the keyboard is idle
+ *
+ * When idle, the matrix selects all of its rows, so that any key press can be
+ * seen with a single read of the input pins, and the MCU sleeps until the next
+ * interrupt. That is a pin change, the host, or the timer tick at the latest.
+ *
+ * Returns true when no key is pressed after the sleep, so the scan can be
+ * skipped.
+ */
+static bool keyboard_idle_sleep(void)
+{
+    bool idle = timer_elapsed32(last_activity) >= IDLE_SLEEP_TIMEOUT &&
+        !keyboard_timers_pending() && keyboard_idle_quantum();
+
+    if (idle != matrix_idle) {
+        if (idle) {
+            matrix_idle_enter();
+        } else {
+            matrix_idle_exit();
+        }
+        matrix_idle = idle;
+    }
+    if (!idle) {
+        return false;
+    }
+
+    suspend_idle(1);
+    if (!matrix_idle_key_pressed()) {
+        return true;
+    }
+    matrix_idle_exit();
+    matrix_idle = false;
+    last_activity = timer_read32();
+    return false;
+}
+#endif
+
 /** \brief Keyboard task: Do keyboard routine jobs
  *
  * Do routine keyboard jobs:
@@ -201,70 +378,51 @@ void keyboard_init(void) {
  * * handle midi commands
  * * light LEDs
  *
+ * All the matrix changes found by the scan are processed before the other
+ * jobs run, so a chord is handled in a single call.
+ *
+ * With IDLE_SLEEP_ENABLE the call sleeps when no key has been down for
+ * IDLE_SLEEP_TIMEOUT ms, see keyboard_idle_sleep.
+ *
  * This is repeatedly called as fast as possible.
  */
 void keyboard_task(void)
 {
-    static matrix_row_t matrix_prev[MATRIX_ROWS];
-#ifdef MATRIX_HAS_GHOST
-  //  static matrix_row_t matrix_ghost[MATRIX_ROWS];
-#endif
     static uint8_t led_status = 0;
-    matrix_row_t matrix_row = 0;
-    matrix_row_t matrix_change = 0;
-#ifdef QMK_KEYS_PER_SCAN
-    uint8_t keys_processed = 0;
-#endif
+    uint8_t num_events = 0;
 
-    matrix_scan();
-    if (is_keyboard_master()) {
-        for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
-            matrix_row = matrix_get_row(r);
-            matrix_change = matrix_row ^ matrix_prev[r];
-            if (matrix_change) {
-#ifdef MATRIX_HAS_GHOST
-                if (has_ghost_in_row(r, matrix_row)) {
-                    /* Keep track of whether ghosted status has changed for
-                    * debugging. But don't update matrix_prev until un-ghosted, or
-                    * the last key would be lost.
-                    */
-                    //if (debug_matrix && matrix_ghost[r] != matrix_row) {
-                    //    matrix_print();
-                    //}
-                    //matrix_ghost[r] = matrix_row;
-                    continue;
-                }
-                //matrix_ghost[r] = matrix_row;
-#endif
-                if (debug_matrix) matrix_print();
-                for (uint8_t c = 0; c < MATRIX_COLS; c++) {
-                    if (matrix_change & ((matrix_row_t)1<<c)) {
-                        action_exec((keyevent_t){
-                            .key = (keypos_t){ .row = r, .col = c },
-                            .pressed = (matrix_row & ((matrix_row_t)1<<c)),
-                            .time = (timer_read() | 1) /* time should not be 0 */
-                        });
-                        // record a processed key
-                        matrix_prev[r] ^= ((matrix_row_t)1<<c);
-#ifdef QMK_KEYS_PER_SCAN
-                        // only jump out if we have processed "enough" keys.
-                        if (++keys_processed >= QMK_KEYS_PER_SCAN)
-#endif
-                        // process a key per task call
-                        goto MATRIX_LOOP_END;
-                    }
-                }
+#ifdef IDLE_SLEEP_ENABLE
+    bool idle = keyboard_idle_sleep();
+    if (idle) {
+        // no key is down, only run the quantum tasks
+        matrix_scan_quantum();
+    } else
+#endif
+    {
+        matrix_scan();
+        if (is_keyboard_master()) {
+            num_events = keyboard_queue_events();
+            if (num_events && debug_matrix) matrix_print();
+            for (uint8_t i = 0; i < num_events; i++) {
+                action_exec(event_queue[i]);
             }
         }
+#ifdef IDLE_SLEEP_ENABLE
+        if (num_events || keyboard_keys_down()) {
+            last_activity = timer_read32();
+        }
+#endif
     }
     // call with pseudo tick event when no real key event.
-#ifdef QMK_KEYS_PER_SCAN
-    // we can get here with some keys processed now.
-    if (!keys_processed)
+#ifdef IDLE_SLEEP_ENABLE
+    // when idle no tapping or one shot timer is pending, see
+    // keyboard_timers_pending
+    if (!num_events && !idle) {
+#else
+    if (!num_events) {
 #endif
-    action_exec(TICK);
-
-MATRIX_LOOP_END:
+        action_exec(TICK);
+    }
 
 #ifdef MOUSEKEY_ENABLE
     // mousekey repeat & acceleration
@@ -65,6 +65,10 @@ void keyboard_init(void);
 void keyboard_task(void);
 /* it runs when host LED status is updated */
 void keyboard_set_leds(uint8_t leds);
+/* it decides if the scan loop may sleep when no key is down */
+bool keyboard_idle_quantum(void);
+bool keyboard_idle_kb(void);
+bool keyboard_idle_user(void);
 
 #ifdef __cplusplus
 }
@@ -66,12 +66,21 @@ bool matrix_is_on(uint8_t row, uint8_t col);
 matrix_row_t matrix_get_row(uint8_t row);
 /* print matrix for debug */
 void matrix_print(void);
+/* wait for the selected row or col to settle before reading the pins */
+void matrix_io_delay(void);
 
 
 /* power control */
 void matrix_power_up(void);
 void matrix_power_down(void);
 
+/* idle sleep: select every row, so that a key press can be seen with a single read.
+ * Custom and split matrices have to implement these for IDLE_SLEEP_ENABLE to
+ * skip the scans. */
+void matrix_idle_enter(void);
+bool matrix_idle_key_pressed(void);
+void matrix_idle_exit(void);
+
 /* executes code for Quantum */
 void matrix_init_quantum(void);
 void matrix_scan_quantum(void);
@@ -241,3 +241,71 @@ void clear_keys_from_report(report_keyboard_t* keyboard_report)
         keyboard_report->raw[i] = 0;
     }
 }
+
+typedef struct {
+    bool changed_twice;
+    bool pressed_first;
+    bool pressed_second;
+} report_merge_t;
+
+static void merge_report_bits(report_merge_t* merge, uint8_t prev, uint8_t first, uint8_t second)
+{
+    merge->changed_twice |= ((prev ^ first) & (first ^ second)) != 0;
+    merge->pressed_first |= (first & ~prev) != 0;
+    merge->pressed_second |= (second & ~first) != 0;
+}
+
+static bool report_has_key(const report_keyboard_t* keyboard_report, uint8_t code)
+{
+    for (uint8_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
+        if (keyboard_report->keys[i] == code) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** \brief keyboard report mergeable
+ *
+ * Returns true when the report `first`, which follows `prev`, can be replaced
+ * with `second` without the host missing a change. That's not the case when:
+ *
+ * * a key or mod changes in both reports, as a tap would be lost
+ * * both reports press keys, as the order of the presses would be lost
+ * * the mods change before a key is pressed, as the key would be pressed with the old mods
+ */
+bool keyboard_report_mergeable(const report_keyboard_t* prev, const report_keyboard_t* first, const report_keyboard_t* second, bool nkro)
+{
+    report_merge_t merge = { false, false, false };
+
+#ifdef NKRO_ENABLE
+    if (nkro) {
+        for (uint8_t i = 0; i < KEYBOARD_REPORT_BITS; i++) {
+            merge_report_bits(&merge, prev->nkro.bits[i], first->nkro.bits[i], second->nkro.bits[i]);
+        }
+    } else
+#endif
+    {
+        (void)nkro;
+        const report_keyboard_t* reports[3] = { prev, first, second };
+        for (uint8_t r = 0; r < 3; r++) {
+            for (uint8_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
+                uint8_t code = reports[r]->keys[i];
+                if (code) {
+                    merge_report_bits(&merge, report_has_key(prev, code),
+                        report_has_key(first, code), report_has_key(second, code));
+                }
+            }
+        }
+    }
+    bool key_pressed_second = merge.pressed_second;
+    merge_report_bits(&merge, prev->mods, first->mods, second->mods);
+
+    if (merge.changed_twice) {
+        return false;
+    }
+    if (merge.pressed_first && merge.pressed_second) {
+        return false;
+    }
+    return !(prev->mods != first->mods && key_pressed_second);
+}
@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define REPORT_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "keycode.h"
 
 
@@ -186,6 +187,8 @@ void add_key_to_report(report_keyboard_t* keyboard_report, uint8_t key);
 void del_key_from_report(report_keyboard_t* keyboard_report, uint8_t key);
 void clear_keys_from_report(report_keyboard_t* keyboard_report);
 
+bool keyboard_report_mergeable(const report_keyboard_t* prev, const report_keyboard_t* first, const report_keyboard_t* second, bool nkro);
+
 #ifdef __cplusplus
 }
 #endif
@@ -58,6 +58,7 @@ void send_keyboard(report_keyboard_t *report);
 void send_mouse(report_mouse_t *report);
 void send_system(uint16_t data);
 void send_consumer(uint16_t data);
+bool keyboard_ready(void);
 
 /* host struct */
 host_driver_t chibios_driver = {
@@ -65,7 +66,8 @@ host_driver_t chibios_driver = {
   send_keyboard,
   send_mouse,
   send_system,
-  send_consumer
+  send_consumer,
+  keyboard_ready
 };
 
 #ifdef VIRTSER_ENABLE
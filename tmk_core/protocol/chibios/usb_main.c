@@ -56,6 +56,7 @@ uint16_t keyboard_led_stats __attribute__((aligned(2))) = 0;
 volatile uint16_t keyboard_idle_count = 0;
 static virtual_timer_t keyboard_idle_timer;
 static void keyboard_idle_timer_cb(void *arg);
+static void kbd_queue_reset_i(void);
 
 report_keyboard_t keyboard_report_sent = {{0}};
 #ifdef MOUSE_ENABLE
@@ -308,6 +309,8 @@ static void usb_event_cb(USBDriver *usbp, usbevent_t event) {
 
   case USB_EVENT_CONFIGURED:
     osalSysLockFromISR();
+    /* Drop the reports queued for the old configuration */
+    kbd_queue_reset_i();
     /* Enable the endpoints specified into the configuration. */
     usbInitEndpointI(usbp, KEYBOARD_IN_EPNUM, &kbd_ep_config);
 #ifdef MOUSE_ENABLE
@@ -590,19 +593,99 @@ void init_usb_driver(USBDriver *usbp) {
  *                  Keyboard functions
  * ---------------------------------------------------------
  */
+
+/* Keyboard reports waiting to go IN
+ * send_keyboard() only adds the report to the queue, and the queue is
+ * drained from the IN callbacks, so the main loop never waits for the host.
+ * The first entry is the one being transmitted when kbd_queue_busy is set.
+ * All the queue variables are accessed in the locked state. */
+#ifndef KEYBOARD_REPORT_QUEUE_SIZE
+  #define KEYBOARD_REPORT_QUEUE_SIZE 4
+#endif
+#if KEYBOARD_REPORT_QUEUE_SIZE < 2
+  #error "KEYBOARD_REPORT_QUEUE_SIZE must be at least 2"
+#endif
+
+typedef struct {
+  report_keyboard_t report;
+  usbep_t ep;
+  size_t size;
+} kbd_queue_entry_t;
+
+static kbd_queue_entry_t kbd_queue[KEYBOARD_REPORT_QUEUE_SIZE];
+static uint8_t kbd_queue_head = 0;
+static uint8_t kbd_queue_count = 0;
+static bool kbd_queue_busy = false;
+/* the last report that made it IN */
+static report_keyboard_t kbd_queue_last = {{0}};
+
+static void kbd_queue_reset_i(void) {
+  kbd_queue_head = 0;
+  kbd_queue_count = 0;
+  kbd_queue_busy = false;
+}
+
+/* Queue a report, replacing the last queued one when nothing is lost
+ * Returns false when the queue is full and the report can't be merged */
+static bool kbd_queue_push_i(const report_keyboard_t *report, usbep_t ep, size_t size) {
+  uint8_t waiting = kbd_queue_count - (kbd_queue_busy ? 1 : 0);
+
+  if(waiting > 0) {
+    kbd_queue_entry_t *last = &kbd_queue[(kbd_queue_head + kbd_queue_count - 1) % KEYBOARD_REPORT_QUEUE_SIZE];
+    const report_keyboard_t *prev = &kbd_queue_last;
+    if(kbd_queue_count > 1) {
+      prev = &kbd_queue[(kbd_queue_head + kbd_queue_count - 2) % KEYBOARD_REPORT_QUEUE_SIZE].report;
+    }
+    if(last->ep == ep && keyboard_report_mergeable(prev, &last->report, report, ep != KEYBOARD_IN_EPNUM)) {
+      last->report = *report;
+      last->ep = ep;
+      last->size = size;
+      return true;
+    }
+  }
+  if(kbd_queue_count == KEYBOARD_REPORT_QUEUE_SIZE) {
+    return false;
+  }
+
+  kbd_queue_entry_t *entry = &kbd_queue[(kbd_queue_head + kbd_queue_count) % KEYBOARD_REPORT_QUEUE_SIZE];
+  entry->report = *report;
+  entry->ep = ep;
+  entry->size = size;
+  kbd_queue_count++;
+  return true;
+}
+
+/* Start transmitting the first queued report, unless the endpoint is busy */
+static void kbd_queue_start_i(USBDriver *usbp) {
+  if(kbd_queue_busy || kbd_queue_count == 0) {
+    return;
+  }
+  kbd_queue_entry_t *entry = &kbd_queue[kbd_queue_head];
+  /* the idle timer can be sending the current report, retry once that's IN */
+  if(usbGetTransmitStatusI(usbp, entry->ep)) {
+    return;
+  }
+  usbStartTransmitI(usbp, entry->ep, (uint8_t *)&entry->report, entry->size);
+  kbd_queue_busy = true;
+}
+
 /* keyboard IN callback hander (a kbd report has made it IN) */
 void kbd_in_cb(USBDriver *usbp, usbep_t ep) {
-  /* STUB */
-  (void)usbp;
-  (void)ep;
+  osalSysLockFromISR();
+  if(kbd_queue_busy && kbd_queue[kbd_queue_head].ep == ep) {
+    kbd_queue_last = kbd_queue[kbd_queue_head].report;
+    kbd_queue_head = (kbd_queue_head + 1) % KEYBOARD_REPORT_QUEUE_SIZE;
+    kbd_queue_count--;
+    kbd_queue_busy = false;
+  }
+  kbd_queue_start_i(usbp);
+  osalSysUnlockFromISR();
 }
 
 #ifdef NKRO_ENABLE
 /* nkro IN callback hander (a nkro report has made it IN) */
 void nkro_in_cb(USBDriver *usbp, usbep_t ep) {
-  /* STUB */
-  (void)usbp;
-  (void)ep;
+  kbd_in_cb(usbp, ep);
 }
 #endif /* NKRO_ENABLE */
 
@@ -633,8 +716,10 @@ static void keyboard_idle_timer_cb(void *arg) {
   if(keyboard_idle) {
 #endif /* NKRO_ENABLE */
     /* TODO: are we sure we want the KBD_ENDPOINT? */
-    if(!usbGetTransmitStatusI(usbp, KEYBOARD_IN_EPNUM)) {
-      usbStartTransmitI(usbp, KEYBOARD_IN_EPNUM, (uint8_t *)&keyboard_report_sent, KEYBOARD_EPSIZE);
+    /* the queued reports are newer than the last one that made it IN, and
+     * they're sent anyway, so only repeat the report when nothing is queued */
+    if(kbd_queue_count == 0 && !usbGetTransmitStatusI(usbp, KEYBOARD_IN_EPNUM)) {
+      usbStartTransmitI(usbp, KEYBOARD_IN_EPNUM, (uint8_t *)&kbd_queue_last, KEYBOARD_EPSIZE);
     }
     /* rearm the timer */
     chVTSetI(&keyboard_idle_timer, 4*MS2ST(keyboard_idle), keyboard_idle_timer_cb, (void *)usbp);
@@ -650,49 +735,49 @@ uint8_t keyboard_leds(void) {
   return (uint8_t)(keyboard_led_stats & 0xFF);
 }
 
-/* prepare and start sending a report IN
- * not callable from ISR or locked state */
-void send_keyboard(report_keyboard_t *report) {
+/* false while a report is queued behind the one being transmitted,
+ * so a new report would only be merged into the queue */
+bool keyboard_ready(void) {
+  bool ready;
   osalSysLock();
-  if(usbGetDriverStateI(&USB_DRIVER) != USB_ACTIVE) {
-    osalSysUnlock();
-    return;
-  }
+  ready = usbGetDriverStateI(&USB_DRIVER) != USB_ACTIVE ||
+          kbd_queue_count == (kbd_queue_busy ? 1 : 0);
   osalSysUnlock();
+  return ready;
+}
+
+/* prepare and start sending a report IN
+ * not callable from ISR or locked state
+ * the report is queued if the endpoint is busy, and only waits for the host
+ * when the queue is full and the report can't be merged into it */
+void send_keyboard(report_keyboard_t *report) {
+  usbep_t ep = KEYBOARD_IN_EPNUM;
+  size_t size = KEYBOARD_EPSIZE;
 
 #ifdef NKRO_ENABLE
   if(keymap_config.nkro) {  /* NKRO protocol */
-    /* need to wait until the previous packet has made it through */
-    /* can rewrite this using the synchronous API, then would wait
-     * until *after* the packet has been transmitted. I think
-     * this is more efficient */
-    /* busy wait, should be short and not very common */
-    osalSysLock();
-    if(usbGetTransmitStatusI(&USB_DRIVER, NKRO_IN_EPNUM)) {
-      /* Need to either suspend, or loop and call unlock/lock during
-       * every iteration - otherwise the system will remain locked,
-       * no interrupts served, so USB not going through as well.
-       * Note: for suspend, need USB_USE_WAIT == TRUE in halconf.h */
-      osalThreadSuspendS(&(&USB_DRIVER)->epc[NKRO_IN_EPNUM]->in_state->thread);
-    }
-    usbStartTransmitI(&USB_DRIVER, NKRO_IN_EPNUM, (uint8_t *)report, sizeof(report_keyboard_t));
-    osalSysUnlock();
-  } else
+    ep = NKRO_IN_EPNUM;
+    size = sizeof(report_keyboard_t);
+  }
 #endif /* NKRO_ENABLE */
-  { /* boot protocol */
-    /* need to wait until the previous packet has made it through */
-    /* busy wait, should be short and not very common */
-    osalSysLock();
-    if(usbGetTransmitStatusI(&USB_DRIVER, KEYBOARD_IN_EPNUM)) {
-      /* Need to either suspend, or loop and call unlock/lock during
-       * every iteration - otherwise the system will remain locked,
-       * no interrupts served, so USB not going through as well.
-       * Note: for suspend, need USB_USE_WAIT == TRUE in halconf.h */
-      osalThreadSuspendS(&(&USB_DRIVER)->epc[KEYBOARD_IN_EPNUM]->in_state->thread);
+
+  osalSysLock();
+  while(true) {
+    if(usbGetDriverStateI(&USB_DRIVER) != USB_ACTIVE) {
+      osalSysUnlock();
+      return;
     }
-    usbStartTransmitI(&USB_DRIVER, KEYBOARD_IN_EPNUM, (uint8_t *)report, KEYBOARD_EPSIZE);
-    osalSysUnlock();
+    if(kbd_queue_push_i(report, ep, size)) {
+      kbd_queue_start_i(&USB_DRIVER);
+      break;
+    }
+    /* Wait until the report being transmitted has made it IN, which frees
+     * an entry. The timeout rechecks the driver state, as nothing goes IN
+     * once the bus is suspended.
+     * Note: for suspend, need USB_USE_WAIT == TRUE in halconf.h */
+    osalThreadSuspendTimeoutS(&(&USB_DRIVER)->epc[kbd_queue[kbd_queue_head].ep]->in_state->thread, MS2ST(10));
   }
+  osalSysUnlock();
   keyboard_report_sent = *report;
 }
 
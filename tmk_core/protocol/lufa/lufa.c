@@ -103,12 +103,14 @@ static void send_keyboard(report_keyboard_t *report);
 static void send_mouse(report_mouse_t *report);
 static void send_system(uint16_t data);
 static void send_consumer(uint16_t data);
+static bool keyboard_ready(void);
 host_driver_t lufa_driver = {
     keyboard_leds,
     send_keyboard,
     send_mouse,
     send_system,
     send_consumer,
+    keyboard_ready,
 };
 
 #ifdef VIRTSER_ENABLE
@@ -662,7 +664,37 @@ static void send_keyboard(report_keyboard_t *report)
 
     keyboard_report_sent = *report;
 }
- 
+
+/** \brief Keyboard Ready
+ *
+ * Returns false while the keyboard endpoint still holds a report the host
+ * hasn't polled, so send_keyboard() would have to wait for it.
+ */
+static bool keyboard_ready(void)
+{
+    uint8_t where = where_to_send();
+    if (where != OUTPUT_USB && where != OUTPUT_USB_AND_BT) {
+        return true;
+    }
+    if (USB_DeviceState != DEVICE_STATE_Configured) {
+        return true;
+    }
+
+    uint8_t ep = Endpoint_GetCurrentEndpoint();
+#ifdef NKRO_ENABLE
+    if (keyboard_protocol && keymap_config.nkro) {
+        Endpoint_SelectEndpoint(NKRO_IN_EPNUM);
+    }
+    else
+#endif
+    {
+        Endpoint_SelectEndpoint(KEYBOARD_IN_EPNUM);
+    }
+    bool ready = Endpoint_IsReadWriteAllowed();
+    Endpoint_SelectEndpoint(ep);
+    return ready;
+}
+
 /** \brief Send Mouse
  *
  * FIXME: Needs doc